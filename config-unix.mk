@@ -28,6 +28,7 @@ CPPFLAGS += -D_LARGEFILE_SOURCE
 CPPFLAGS += -D_FILE_OFFSET_BITS=64
 
 OBJS += src/unix/core.o
+OBJS += src/unix/channel.o
 OBJS += src/unix/dl.o
 OBJS += src/unix/fs.o
 OBJS += src/unix/cares.o
@@ -39,6 +40,10 @@ OBJS += src/unix/tcp.o
 OBJS += src/unix/pipe.o
 OBJS += src/unix/tty.o
 OBJS += src/unix/stream.o
+OBJS += src/unix/splice.o
+OBJS += src/unix/timer-wheel.o
+OBJS += src/unix/metrics.o
+OBJS += src/unix/threadpool.o
 
 ifeq (SunOS,$(uname_S))
 EV_CONFIG=config_sunos.h
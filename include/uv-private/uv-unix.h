@@ -51,6 +51,18 @@ typedef pthread_t uv_thread_t;
 typedef pthread_mutex_t uv_mutex_t;
 typedef pthread_rwlock_t uv_rwlock_t;
 
+/* Unit of work for the thread pool, embedded in the request that owns it. */
+struct uv__work {
+  void (*work)(struct uv__work *w);
+  /* status is 0 or UV_ECANCELED */
+  void (*done)(struct uv__work *w, int status);
+  struct uv_loop_s* loop;
+  /* Worker whose queue holds the request, NULL once it's been taken. */
+  struct uv__worker* worker;
+  int lane;
+  ngx_queue_t wq;
+};
+
 /* Platform-specific definitions for uv_dlopen support. */
 typedef void* uv_lib_t;
 #define UV_DYNAMIC /* empty */
@@ -65,7 +77,47 @@ typedef void* uv_lib_t;
   ev_timer timer; \
   /* Poll result queue */ \
   eio_channel uv_eio_channel; \
-  struct ev_loop* ev;
+  struct ev_loop* ev; \
+  /* NULL unless the loop was created with UV_LOOP_TIMER_WHEEL. */ \
+  struct uv__timer_wheel* timer_wheel; \
+  /* -1 unless the loop was created with UV_LOOP_EPOLL. */ \
+  int epoll_fd; \
+  ev_io epoll_watcher; \
+  /* Zero-copy notifications, -1 until a stream turns them on. */ \
+  int zerocopy_fd; \
+  ev_io zerocopy_watcher; \
+  /* Given up when accept() runs out of descriptors, -1 until uv_listen(). */ \
+  int emfile_fd; \
+  /* \
+   * NULL unless the loop was created with UV_LOOP_IO_URING and the kernel \
+   * supports it. \
+   */ \
+  struct uv__iou* iou; \
+  /* NULL until the read pool is set up or first used. */ \
+  struct uv__read_pool* read_pool; \
+  /* NULL until the first fs, work or getaddrinfo request. */ \
+  struct uv_threadpool_s* threadpool; \
+  /* Worker that gets the next request, round-robin. */ \
+  unsigned int wq_next; \
+  /* Lane of the requests that are submitted next. */ \
+  int wq_lane; \
+  /* Finished thread pool work, filled by the worker threads. */ \
+  ngx_queue_t wq; \
+  uv_mutex_t wq_mutex; \
+  ev_async wq_async; \
+  /* \
+   * Signalled uv_async_t handles. uv_async_send() pushes onto async_pending \
+   * from any thread, the loop moves them to async_queue, oldest first. \
+   */ \
+  ev_async async_watcher; \
+  uv_async_t* async_pending; \
+  uv_async_t* async_queue; \
+  /* Odd while the loop updates the metrics, see uv_loop_metrics(). */ \
+  unsigned int metrics_seq; \
+  uv_loop_metrics_t metrics; \
+  uint64_t metrics_poll_start; \
+  uint64_t metrics_run_start; \
+  uint64_t metrics_iter_events;
 
 #define UV_REQ_BUFSML_SIZE (4)
 
@@ -77,10 +129,34 @@ typedef void* uv_lib_t;
   uv_buf_t* bufs; \
   int bufcnt; \
   int error; \
+  /* uv_write_file() requests, file is -1 for the others. */ \
+  uv_file file; \
+  off_t file_offset; \
+  size_t file_length; \
+  /* How much of the file from file_offset on is known to be cached. */ \
+  size_t file_cached; \
+  struct uv__write_file_work* file_work; \
+  /* MSG_ZEROCOPY sends made for the request and those not yet released. */ \
+  unsigned int zerocopy_first; \
+  unsigned int zerocopy_sends; \
+  unsigned int zerocopy_pending; \
   uv_buf_t bufsml[UV_REQ_BUFSML_SIZE];
 
 #define UV_SHUTDOWN_PRIVATE_FIELDS /* empty */
 
+#define UV_SPLICE_PRIVATE_FIELDS \
+  ev_io read_watcher; \
+  ev_io write_watcher; \
+  /* The pipe that the data goes through, -1 without splice(2). */ \
+  int fds[2]; \
+  size_t pipesize; \
+  /* Copy buffer for when splice(2) can't be used. */ \
+  char* buf; \
+  size_t off; \
+  /* Bytes read from src but not yet written to dst. */ \
+  size_t pending; \
+  int flags;
+
 #define UV_CONNECT_PRIVATE_FIELDS \
   ngx_queue_t queue;
 
@@ -114,7 +190,20 @@ typedef void* uv_lib_t;
   int delayed_error; \
   uv_connection_cb connection_cb; \
   int accepted_fd; \
-  int blocking;
+  /* Connections accepted per wakeup, 0 for no limit. */ \
+  unsigned int accept_batch; \
+  int blocking; \
+  /* NULL unless the stream's I/O goes through the loop's io_uring. */ \
+  struct uv__iou_stream* iou; \
+  /* Linked into the read pool's wait queue while UV_READ_PARKED. */ \
+  ngx_queue_t read_pool_queue; \
+  /* What alloc_cb is asked for, follows the size of the reads. */ \
+  size_t read_size; \
+  /* The splices that read from and write to the stream. */ \
+  struct uv_splice_s* splice_from; \
+  struct uv_splice_s* splice_to; \
+  /* NULL until uv_tcp_zerocopy() is called. */ \
+  struct uv__zerocopy* zerocopy;
 
 
 /* UV_TCP */
@@ -129,6 +218,7 @@ typedef void* uv_lib_t;
   ev_io write_watcher;                \
   ngx_queue_t write_queue;            \
   ngx_queue_t write_completed_queue;  \
+  unsigned int recv_nmsgs;            \
 
 
 /* UV_NAMED_PIPE */
@@ -156,14 +246,28 @@ typedef void* uv_lib_t;
 
 /* UV_ASYNC */
 #define UV_ASYNC_PRIVATE_FIELDS \
+  uv_async_cb async_cb; \
+  /* Next on the loop's pending list while async_sent is set. */ \
+  uv_async_t* async_next; \
+  int async_sent;
+
+
+/* UV_CHANNEL */
+#define UV_CHANNEL_PRIVATE_FIELDS \
   ev_async async_watcher; \
-  uv_async_cb async_cb;
+  uv_channel_cb channel_cb; \
+  /* Newest first, pushed to by the senders. */ \
+  uv_channel_msg_t* channel_head;
 
 
 /* UV_TIMER */
 #define UV_TIMER_PRIVATE_FIELDS \
   ev_timer timer_watcher; \
-  uv_timer_cb timer_cb;
+  uv_timer_cb timer_cb; \
+  /* Only used when the loop runs a timer wheel. */ \
+  ngx_queue_t timer_queue; \
+  int64_t timer_due; \
+  int64_t timer_repeat;
 
 #define UV_ARES_TASK_PRIVATE_FIELDS \
   int sock; \
@@ -176,17 +280,33 @@ typedef void* uv_lib_t;
   char* hostname; \
   char* service; \
   struct addrinfo* res; \
-  int retcode;
+  int retcode; \
+  struct uv__work work_req;
 
 #define UV_PROCESS_PRIVATE_FIELDS \
   ev_child child_watcher;
 
 #define UV_FS_PRIVATE_FIELDS \
   struct stat statbuf; \
-  eio_req* eio;
+  uv_file file; \
+  uv_file in_file; \
+  int flags; \
+  int mode; \
+  void* buf; \
+  size_t len; \
+  off_t off; \
+  char* new_path; \
+  double atime; \
+  double mtime; \
+  int uid; \
+  int gid; \
+  ssize_t work_result; \
+  int work_errno; \
+  void* work_ptr; \
+  struct uv__work work_req;
 
 #define UV_WORK_PRIVATE_FIELDS \
-  eio_req* eio;
+  struct uv__work work_req;
 
 #define UV_TTY_PRIVATE_FIELDS \
   struct termios orig_termios; \
@@ -238,6 +238,9 @@ RB_HEAD(uv_timer_tree_s, uv_timer_s);
 #define UV_SHUTDOWN_PRIVATE_FIELDS        \
   /* empty */
 
+#define UV_SPLICE_PRIVATE_FIELDS          \
+  /* empty */
+
 #define UV_UDP_SEND_PRIVATE_FIELDS        \
   /* empty */
 
@@ -265,7 +268,9 @@ RB_HEAD(uv_timer_tree_s, uv_timer_s);
 
 #define uv_stream_connection_fields       \
   unsigned int write_reqs_pending;        \
-  uv_shutdown_t* shutdown_req;
+  uv_shutdown_t* shutdown_req;            \
+  /* The read_cb of uv_read_start_pool(). */ \
+  uv_read_cb pool_read_cb;
 
 #define uv_stream_server_fields           \
   uv_connection_cb connection_cb;
@@ -368,6 +373,9 @@ RB_HEAD(uv_timer_tree_s, uv_timer_s);
   /* char to avoid alignment issues */    \
   char volatile async_sent;
 
+#define UV_CHANNEL_PRIVATE_FIELDS         \
+  uv_channel_cb channel_cb;
+
 #define UV_PREPARE_PRIVATE_FIELDS         \
   uv_prepare_t* prepare_prev;             \
   uv_prepare_t* prepare_next;             \
@@ -115,7 +115,8 @@ typedef intptr_t ssize_t;
   XX( 45, EAISOCKTYPE, "") \
   XX( 46, ESHUTDOWN, "") \
   XX( 47, EEXIST, "file already exists") \
-  XX( 48, ESRCH, "no such process")
+  XX( 48, ESRCH, "no such process") \
+  XX( 49, ECANCELED, "operation canceled")
 
 
 #define UV_ERRNO_GEN(val, name, s) UV_##name = val,
@@ -140,7 +141,8 @@ typedef enum {
   UV_ARES_TASK,
   UV_ARES_EVENT,
   UV_PROCESS,
-  UV_FS_EVENT
+  UV_FS_EVENT,
+  UV_CHANNEL
 } uv_handle_type;
 
 typedef enum {
@@ -155,6 +157,7 @@ typedef enum {
   UV_FS,
   UV_WORK,
   UV_GETADDRINFO,
+  UV_SPLICE,
   UV_REQ_TYPE_PRIVATE
 } uv_req_type;
 
@@ -174,9 +177,12 @@ typedef struct uv_prepare_s uv_prepare_t;
 typedef struct uv_check_s uv_check_t;
 typedef struct uv_idle_s uv_idle_t;
 typedef struct uv_async_s uv_async_t;
+typedef struct uv_channel_s uv_channel_t;
+typedef struct uv_channel_msg_s uv_channel_msg_t;
 typedef struct uv_getaddrinfo_s uv_getaddrinfo_t;
 typedef struct uv_process_s uv_process_t;
 typedef struct uv_counters_s uv_counters_t;
+typedef struct uv_loop_metrics_s uv_loop_metrics_t;
 typedef struct uv_cpu_info_s uv_cpu_info_t;
 typedef struct uv_interface_address_s uv_interface_address_t;
 /* Request types */
@@ -189,6 +195,9 @@ typedef struct uv_fs_s uv_fs_t;
 /* uv_fs_event_t is a subclass of uv_handle_t. */
 typedef struct uv_fs_event_s uv_fs_event_t;
 typedef struct uv_work_s uv_work_t;
+typedef struct uv_splice_s uv_splice_t;
+/* Thread pools are opaque. */
+typedef struct uv_threadpool_s uv_threadpool_t;
 
 
 /*
@@ -202,6 +211,49 @@ typedef struct uv_work_s uv_work_t;
 UV_EXTERN uv_loop_t* uv_loop_new(void);
 UV_EXTERN void uv_loop_delete(uv_loop_t*);
 
+/*
+ * Flags for uv_loop_new2(). They are hints, a platform that doesn't
+ * implement a feature silently ignores its flag.
+ */
+enum uv_loop_flags {
+  /*
+   * Keep uv_timer_t timers in a hierarchical timing wheel with millisecond
+   * resolution instead of a binary heap. Starting and stopping a timer is
+   * O(1) which pays off with large numbers of timers that are frequently
+   * restarted, like idle timeouts.
+   */
+  UV_LOOP_TIMER_WHEEL = 1,
+  /*
+   * Linux only. Poll streams through an epoll set that's owned by libuv,
+   * with a single registration per file descriptor that covers both
+   * reading and writing, instead of through libev's watchers.
+   */
+  UV_LOOP_EPOLL = 2,
+  /*
+   * Linux only. Submit async open, close, read, write, stat and fsync
+   * requests through an io_uring that's owned by the loop instead of
+   * running them on the thread pool. Requests that the ring can't take
+   * still go to the thread pool, as do all requests when the kernel
+   * doesn't support io_uring.
+   */
+  UV_LOOP_IO_URING = 4,
+  /*
+   * Linux only. Do TCP and pipe stream I/O through an io_uring that's
+   * owned by the loop: reads and accepts are multishot operations that
+   * complete with the data or the new connection, and writes that can't
+   * go out right away are finished by the kernel instead of waiting for
+   * the socket to become writable. IPC pipes, pipe servers and TTYs stay
+   * on the regular code path. Needs Linux 6.0 or newer, the flag is
+   * ignored on older kernels and together with UV_LOOP_EPOLL.
+   */
+  UV_LOOP_IO_URING_NET = 8
+};
+
+/*
+ * Like uv_loop_new() but takes one or more OR'ed UV_LOOP_* flags.
+ */
+UV_EXTERN uv_loop_t* uv_loop_new2(unsigned int flags);
+
 /* This is a debugging tool. It's NOT part of the official API. */
 UV_EXTERN int uv_loop_refcount(const uv_loop_t*);
 
@@ -240,6 +292,12 @@ UV_EXTERN int64_t uv_now(uv_loop_t*);
  *
  * In the case of uv_read_cb the uv_buf_t returned should be freed by the
  * user.
+ *
+ * The suggested_size of uv_alloc_cb is an estimate of how much data is
+ * about to be read. It follows the sizes of a stream's recent reads. For
+ * udp handles that don't receive in batches it's the size of the first
+ * datagram read after the socket becomes readable and 64 KB for the ones
+ * that follow it.
  */
 typedef uv_buf_t (*uv_alloc_cb)(uv_handle_t* handle, size_t suggested_size);
 typedef void (*uv_read_cb)(uv_stream_t* stream, ssize_t nread, uv_buf_t buf);
@@ -251,6 +309,7 @@ typedef void (*uv_read_cb)(uv_stream_t* stream, ssize_t nread, uv_buf_t buf);
 typedef void (*uv_read2_cb)(uv_pipe_t* pipe, ssize_t nread, uv_buf_t buf,
     uv_handle_type pending);
 typedef void (*uv_write_cb)(uv_write_t* req, int status);
+typedef void (*uv_watermark_cb)(uv_stream_t* stream, int above);
 typedef void (*uv_connect_cb)(uv_connect_t* req, int status);
 typedef void (*uv_shutdown_cb)(uv_shutdown_t* req, int status);
 typedef void (*uv_connection_cb)(uv_stream_t* server, int status);
@@ -258,6 +317,8 @@ typedef void (*uv_close_cb)(uv_handle_t* handle);
 typedef void (*uv_timer_cb)(uv_timer_t* handle, int status);
 /* TODO: do these really need a status argument? */
 typedef void (*uv_async_cb)(uv_async_t* handle, int status);
+typedef void (*uv_channel_cb)(uv_channel_t* handle, uv_channel_msg_t* msgs,
+    int count);
 typedef void (*uv_prepare_cb)(uv_prepare_t* handle, int status);
 typedef void (*uv_check_cb)(uv_check_t* handle, int status);
 typedef void (*uv_idle_cb)(uv_idle_t* handle, int status);
@@ -267,6 +328,7 @@ typedef void (*uv_exit_cb)(uv_process_t*, int exit_status, int term_signal);
 typedef void (*uv_fs_cb)(uv_fs_t* req);
 typedef void (*uv_work_cb)(uv_work_t* req);
 typedef void (*uv_after_work_cb)(uv_work_t* req);
+typedef void (*uv_splice_cb)(uv_splice_t* req, int status);
 
 /*
 * This will be called repeatedly after the uv_fs_event_t is initialized.
@@ -401,6 +463,10 @@ UV_EXTERN size_t uv_strlcat(char* dst, const char* src, size_t size);
   uv_read_cb read_cb; \
   uv_read2_cb read2_cb; \
   /* private */ \
+  uv_watermark_cb watermark_cb; \
+  size_t write_low_watermark; \
+  size_t write_high_watermark; \
+  int write_above_high; \
   UV_STREAM_PRIVATE_FIELDS
 
 /*
@@ -431,6 +497,16 @@ UV_EXTERN int uv_listen(uv_stream_t* stream, int backlog, uv_connection_cb cb);
  */
 UV_EXTERN int uv_accept(uv_stream_t* server, uv_stream_t* client);
 
+/*
+ * Limits the number of connections that a listening stream accepts in one
+ * go. Connections beyond the limit are accepted on the next loop
+ * iteration, after other I/O has had its turn. The default is 0, which
+ * accepts until the backlog is empty or until connection_cb doesn't call
+ * uv_accept(). No-op on Windows, which has its accepts posted up front.
+ */
+UV_EXTERN int uv_stream_set_accept_batch(uv_stream_t* server,
+    unsigned int n);
+
 /*
  * Read data from an incoming stream. The callback will be made several
  * several times until there is no more data to read or uv_read_stop is
@@ -453,6 +529,33 @@ UV_EXTERN int uv_read_stop(uv_stream_t*);
 UV_EXTERN int uv_read2_start(uv_stream_t*, uv_alloc_cb alloc_cb,
     uv_read2_cb read_cb);
 
+/*
+ * Like uv_read_start() but reads into a pool of buffers that is owned by
+ * the loop, there is no alloc callback. uv_read_start() and
+ * uv_read2_start() still need one, they fail with UV_EINVAL without it. A buffer is only taken from the
+ * pool when data arrived: read_cb gets it with nread > 0 and owns it until
+ * it is handed back with uv_read_release(), buf.len is the size of the
+ * buffer. When nread <= 0, buf is empty and needn't be released.
+ *
+ * Pooled streams stop reading while the pool is empty and pick up again
+ * when a buffer is released, memory for reads never exceeds the pool.
+ * Buffers must be released before the loop is deleted.
+ *
+ * On loops with UV_LOOP_IO_URING_NET, the buffers are the ones the kernel
+ * received into and aren't copied.
+ */
+UV_EXTERN int uv_read_start_pool(uv_stream_t*, uv_read_cb read_cb);
+UV_EXTERN void uv_read_release(uv_loop_t*, uv_buf_t buf);
+
+/*
+ * Sets the number and size of the buffers in the loop's read pool. The
+ * default is 256 buffers of 64 KB. Can only be changed while no pooled
+ * buffers are handed out. Windows allocates pooled buffers on demand and
+ * ignores the setting.
+ */
+UV_EXTERN int uv_loop_set_read_pool(uv_loop_t*, unsigned int nbufs,
+    size_t size);
+
 
 /*
  * Write data to stream. Buffers are written in order. Example:
@@ -478,6 +581,44 @@ UV_EXTERN int uv_write(uv_write_t* req, uv_stream_t* handle,
 UV_EXTERN int uv_write2(uv_write_t* req, uv_stream_t* handle, uv_buf_t bufs[],
     int bufcnt, uv_stream_t* send_handle, uv_write_cb cb);
 
+/*
+ * Writes length bytes of file, starting at offset, to the stream. The
+ * request is queued with the other writes and goes out in order.
+ *
+ * The data is sent with sendfile(2) from the loop whenever the stream is
+ * writable. Only parts of the file that aren't in the page cache are read
+ * in on the thread pool first, the loop doesn't wait for the disk.
+ *
+ * The callback gets status -1 and UV_EINVAL if the file ends before
+ * offset + length. The file must stay open until the callback is made.
+ *
+ * Not supported on Windows (UV_ENOSYS).
+ */
+UV_EXTERN int uv_write_file(uv_write_t* req, uv_stream_t* handle,
+    uv_file file, off_t offset, size_t length, uv_write_cb cb);
+
+/*
+ * Writes the data right away, without a request and without a callback.
+ * Returns the number of bytes written, which can be less than the total
+ * size of `bufs`; pass the rest to uv_write() if needed. Fails with
+ * UV_EAGAIN if the data can't be written without blocking or if earlier
+ * writes are still queued. On Windows it always fails with UV_EAGAIN.
+ */
+UV_EXTERN int uv_try_write(uv_stream_t* handle, uv_buf_t bufs[], int bufcnt);
+
+/*
+ * Reports when stream->write_queue_size goes above `high` bytes, with
+ * `above` set to 1, and when it drops back to `low` bytes or less, with
+ * `above` set to 0. Producers can pause and resume on these instead of
+ * checking write_queue_size after each write.
+ *
+ * If the queue is already above `high`, only the drop is reported. Pass a
+ * NULL callback to turn the reports off. Fails with UV_EINVAL if `low` is
+ * greater than `high`.
+ */
+UV_EXTERN int uv_stream_set_watermarks(uv_stream_t* stream, size_t low,
+    size_t high, uv_watermark_cb cb);
+
 /* uv_write_t is a subclass of uv_req_t */
 struct uv_write_s {
   UV_REQ_FIELDS
@@ -488,6 +629,38 @@ struct uv_write_s {
 };
 
 
+/*
+ * Moves everything that arrives on src to dst, for proxies. On Linux the
+ * data goes through a pipe with splice(2) and never enters user space.
+ *
+ * The callback is made once: with status 0 after src reached EOF and all
+ * of its data was handed to dst, or with status -1 on a read or write
+ * error, or when either stream is closed (UV_ECANCELED). dst isn't shut
+ * down, that's up to the callback. nbytes counts the bytes moved.
+ *
+ * src must not be reading, uv_read_start() on src fails with UV_EBUSY until
+ * the splice completes. dst can be written to in the meantime: the data
+ * keeps the order of the calls. Writes that are queued on dst go out before
+ * the data that src sends next, a uv_write() that is made while spliced
+ * bytes wait to go out is sent after them. uv_try_write() on dst fails
+ * with UV_EAGAIN. src is only read while dst keeps up.
+ *
+ * Not supported on Windows (UV_ENOSYS).
+ */
+UV_EXTERN int uv_stream_splice(uv_splice_t* req, uv_stream_t* src,
+    uv_stream_t* dst, uv_splice_cb cb);
+
+/* uv_splice_t is a subclass of uv_req_t */
+struct uv_splice_s {
+  UV_REQ_FIELDS
+  uv_stream_t* src;
+  uv_stream_t* dst;
+  uv_splice_cb cb;
+  size_t nbytes;
+  UV_SPLICE_PRIVATE_FIELDS
+};
+
+
 
 /*
  * uv_tcp_t is a subclass of uv_stream_t
@@ -512,6 +685,38 @@ UV_EXTERN int uv_tcp_nodelay(uv_tcp_t* handle, int enable);
 UV_EXTERN int uv_tcp_keepalive(uv_tcp_t* handle, int enable,
     unsigned int delay);
 
+/*
+ * Enable/disable zero-copy transmission (MSG_ZEROCOPY) for writes of at
+ * least `threshold` bytes, 0 picks a default of 16 KB. The kernel sends
+ * straight from the write's buffers, so the write callback is only made
+ * once the kernel has released them, which is after the peer acknowledged
+ * the data. Smaller writes are copied as usual.
+ *
+ * When the handle is closed before the kernel released a write's buffers,
+ * its callback gets status -1 and UV_ECANCELED. The kernel may still send
+ * from the buffers after that. Freeing them is safe, but whatever is
+ * written to that memory afterwards may be what goes out.
+ *
+ * Pays off for large writes only. When the kernel has to copy the data
+ * anyway (loopback connections, some NICs) the handle goes back to
+ * regular writes.
+ *
+ * Linux only, fails with UV_ENOTSUP elsewhere.
+ */
+UV_EXTERN int uv_tcp_zerocopy(uv_tcp_t* handle, int enable,
+    size_t threshold);
+
+/*
+ * Enable/disable SO_REUSEPORT. Must be called before uv_tcp_bind(). Handles
+ * that have it turned on, usually each on a loop of its own, can bind and
+ * listen on the same address and port. The kernel spreads new connections
+ * over the listeners, so there are no thundering-herd wakeups.
+ *
+ * Fails with UV_ENOTSUP on platforms without SO_REUSEPORT. Only Linux
+ * and FreeBSD balance connections across the listeners.
+ */
+UV_EXTERN int uv_tcp_reuseport(uv_tcp_t* handle, int enable);
+
 /*
  * This setting applies to Windows only.
  * Enable/disable simultaneous asynchronous accept requests that are
@@ -560,7 +765,18 @@ enum uv_udp_flags {
    * Indicates message was truncated because read buffer was too small. The
    * remainder was discarded by the OS. Used in uv_udp_recv_cb.
    */
-  UV_UDP_PARTIAL = 2
+  UV_UDP_PARTIAL = 2,
+  /*
+   * Indicates that the datagram is one of several that were received in
+   * a single batch, see uv_udp_recv_start_batch(). buf points into the
+   * buffer returned by alloc_cb; do not free it. Used in uv_udp_recv_cb.
+   */
+  UV_UDP_MMSG_CHUNK = 4,
+  /*
+   * Lets other sockets bind the same address and port, see
+   * uv_tcp_reuseport(). Used with uv_udp_bind() and uv_udp_bind6().
+   */
+  UV_UDP_REUSEPORT = 8
 };
 
 /*
@@ -581,7 +797,7 @@ typedef void (*uv_udp_send_cb)(uv_udp_send_t* req, int status);
  *  addr    struct sockaddr_in or struct sockaddr_in6.
  *          Valid for the duration of the callback only.
  *  flags   One or more OR'ed UV_UDP_* constants.
- *          Right now only UV_UDP_PARTIAL is used.
+ *          Right now only UV_UDP_PARTIAL and UV_UDP_MMSG_CHUNK are used.
  */
 typedef void (*uv_udp_recv_cb)(uv_udp_t* handle, ssize_t nread, uv_buf_t buf,
     struct sockaddr* addr, unsigned flags);
@@ -612,7 +828,7 @@ UV_EXTERN int uv_udp_init(uv_loop_t*, uv_udp_t* handle);
  * Arguments:
  *  handle    UDP handle. Should have been initialized with `uv_udp_init`.
  *  addr      struct sockaddr_in with the address and port to bind to.
- *  flags     Unused.
+ *  flags     Should be 0 or UV_UDP_REUSEPORT.
  *
  * Returns:
  *  0 on success, -1 on error.
@@ -626,7 +842,8 @@ UV_EXTERN int uv_udp_bind(uv_udp_t* handle, struct sockaddr_in addr,
  * Arguments:
  *  handle    UDP handle. Should have been initialized with `uv_udp_init`.
  *  addr      struct sockaddr_in with the address and port to bind to.
- *  flags     Should be 0 or UV_UDP_IPV6ONLY.
+ *  flags     Should be 0 or one or more OR'ed UV_UDP_IPV6ONLY and
+ *            UV_UDP_REUSEPORT.
  *
  * Returns:
  *  0 on success, -1 on error.
@@ -692,6 +909,21 @@ UV_EXTERN int uv_udp_send6(uv_udp_send_t* req, uv_udp_t* handle,
     uv_buf_t bufs[], int bufcnt, struct sockaddr_in6 addr,
     uv_udp_send_cb send_cb);
 
+/*
+ * Like uv_udp_send() but sends the datagram right away, without a request
+ * and without a callback. Returns the number of bytes sent. Fails with
+ * UV_EAGAIN if the datagram can't be sent without blocking or if earlier
+ * sends are still queued. On Windows it always fails with UV_EAGAIN.
+ */
+UV_EXTERN int uv_udp_try_send(uv_udp_t* handle, uv_buf_t bufs[], int bufcnt,
+    struct sockaddr_in addr);
+
+/*
+ * Like uv_udp_try_send() but for IPv6 peers.
+ */
+UV_EXTERN int uv_udp_try_send6(uv_udp_t* handle, uv_buf_t bufs[], int bufcnt,
+    struct sockaddr_in6 addr);
+
 /*
  * Receive data. If the socket has not previously been bound with `uv_udp_bind`
  * or `uv_udp_bind6`, it is bound to 0.0.0.0 (the "all interfaces" address)
@@ -708,6 +940,30 @@ UV_EXTERN int uv_udp_send6(uv_udp_send_t* req, uv_udp_t* handle,
 UV_EXTERN int uv_udp_recv_start(uv_udp_t* handle, uv_alloc_cb alloc_cb,
     uv_udp_recv_cb recv_cb);
 
+/*
+ * Like uv_udp_recv_start() but reads up to `nmsgs` datagrams per system call
+ * where the platform supports it (recvmmsg() on Linux). Elsewhere it behaves
+ * exactly like uv_udp_recv_start().
+ *
+ * alloc_cb is asked for one buffer large enough to hold `nmsgs` datagrams.
+ * Each datagram is passed to recv_cb with the UV_UDP_MMSG_CHUNK flag set and
+ * buf pointing into that buffer. Once the batch has been delivered, recv_cb
+ * is called one last time with nread == 0 and the whole buffer so it can be
+ * released or reused.
+ *
+ * Arguments:
+ *  handle    UDP handle. Should have been initialized with `uv_udp_init`.
+ *  alloc_cb  Callback to invoke when temporary storage is needed.
+ *  recv_cb   Callback to invoke with received data.
+ *  nmsgs     Maximum number of datagrams to read per system call. Values
+ *            above the platform limit are clamped.
+ *
+ * Returns:
+ *  0 on success, -1 on error.
+ */
+UV_EXTERN int uv_udp_recv_start_batch(uv_udp_t* handle, uv_alloc_cb alloc_cb,
+    uv_udp_recv_cb recv_cb, unsigned int nmsgs);
+
 /*
  * Stop listening for incoming datagrams.
  *
@@ -865,12 +1121,15 @@ UV_EXTERN int uv_idle_stop(uv_idle_t* idle);
 /*
  * uv_async_t is a subclass of uv_handle_t.
  *
- * libev wrapper. uv_async_send wakes up the event
- * loop and calls the async handle's callback There is no guarantee that
- * every uv_async_send call leads to exactly one invocation of the callback;
- * The only guarantee is that the callback function is  called at least once
- * after the call to async_send. Unlike all other libuv functions,
- * uv_async_send can be called from another thread.
+ * uv_async_send wakes up the event loop and calls the async handle's
+ * callback. There is no guarantee that every uv_async_send call leads to
+ * exactly one invocation of the callback; The only guarantee is that the
+ * callback function is called at least once after the call to async_send.
+ * Unlike all other libuv functions, uv_async_send can be called from another
+ * thread.
+ *
+ * A wakeup only runs the callbacks of the handles that were sent to, it
+ * doesn't get slower with the number of async handles on the loop.
  */
 struct uv_async_s {
   UV_HANDLE_FIELDS
@@ -888,6 +1147,45 @@ UV_EXTERN int uv_async_init(uv_loop_t*, uv_async_t* async,
 UV_EXTERN int uv_async_send(uv_async_t* async);
 
 
+/*
+ * uv_channel_t is a subclass of uv_handle_t.
+ *
+ * Carries messages from any number of threads to the loop thread. Like
+ * uv_async_send(), uv_channel_send() can be called from any thread. It
+ * doesn't take locks or allocate memory: the message is pushed onto a
+ * lock-free queue and only a send to an empty queue wakes up the loop.
+ *
+ * The callback gets every message that was sent since its last invocation
+ * in one batch, `count` messages linked through `next` and oldest first.
+ * Messages from one thread arrive in the order they were sent. Once
+ * delivered a message belongs to the loop thread again; read `next` before
+ * freeing or reusing it.
+ *
+ * Messages that are still queued when the handle is closed are delivered
+ * right before the close callback. Don't send to a channel after
+ * uv_close().
+ *
+ * Like uv_async_t, an open channel keeps the loop alive whether or not
+ * messages are queued. uv_run() doesn't return until it's closed, unless
+ * the reference is dropped with uv_unref().
+ *
+ * Windows isn't supported yet, uv_channel_init() fails with UV_ENOTSUP.
+ */
+struct uv_channel_msg_s {
+  uv_channel_msg_t* next;
+  void* data;
+};
+
+struct uv_channel_s {
+  UV_HANDLE_FIELDS
+  UV_CHANNEL_PRIVATE_FIELDS
+};
+
+UV_EXTERN int uv_channel_init(uv_loop_t*, uv_channel_t* channel,
+    uv_channel_cb cb);
+UV_EXTERN int uv_channel_send(uv_channel_t* channel, uv_channel_msg_t* msg);
+
+
 /*
  * uv_timer_t is a subclass of uv_handle_t.
  *
@@ -1040,6 +1338,74 @@ struct uv_work_s {
 UV_EXTERN int uv_queue_work(uv_loop_t* loop, uv_work_t* req,
     uv_work_cb work_cb, uv_after_work_cb after_work_cb);
 
+/*
+ * Thread pools run the fs, work and getaddrinfo requests of the loops that
+ * are attached to them. A loop that isn't explicitly attached to a pool
+ * uses a default pool of four threads that is shared by all such loops.
+ *
+ * uv_threadpool_new() starts a pool with `nthreads` worker threads. Returns
+ * NULL on error.
+ *
+ * uv_threadpool_new2() is like uv_threadpool_new() but also sets how many
+ * bulk lane requests can run at the same time (see uv_loop_set_lane()).
+ * uv_threadpool_new() allows half of the threads, rounded up.
+ *
+ * uv_threadpool_delete() stops and joins the worker threads. All loops that
+ * use the pool must have been deleted first.
+ *
+ * uv_loop_set_threadpool() attaches `loop` to `pool`. Several loops can
+ * share a pool. Completed requests are only ever delivered to the loop that
+ * submitted them. Must be called before the loop queues its first request,
+ * fails with UV_EBUSY otherwise.
+ *
+ * On Windows, requests always run on the system thread pool; the pool is
+ * a placeholder there.
+ */
+UV_EXTERN uv_threadpool_t* uv_threadpool_new(unsigned int nthreads);
+UV_EXTERN uv_threadpool_t* uv_threadpool_new2(unsigned int nthreads,
+    unsigned int max_bulk);
+UV_EXTERN void uv_threadpool_delete(uv_threadpool_t* pool);
+UV_EXTERN int uv_loop_set_threadpool(uv_loop_t* loop, uv_threadpool_t* pool);
+
+typedef enum {
+  UV_LANE_INTERACTIVE = 0,
+  UV_LANE_BULK
+} uv_lane_t;
+
+/*
+ * Selects the lane for the fs, work and getaddrinfo requests that `loop`
+ * submits from now on. The default is UV_LANE_INTERACTIVE.
+ *
+ * The pool always starts interactive requests before bulk ones and runs
+ * no more than its max_bulk bulk requests at a time. An interactive
+ * request therefore never waits for more than max_bulk bulk requests.
+ * Bulk requests can be held back for as long as interactive work keeps
+ * all threads busy.
+ *
+ *   uv_loop_set_lane(loop, UV_LANE_BULK);
+ *   uv_fs_read(loop, &req, fd, buf, len, offset, read_cb);
+ *   uv_loop_set_lane(loop, UV_LANE_INTERACTIVE);
+ *
+ * Lanes are ignored on Windows.
+ */
+UV_EXTERN void uv_loop_set_lane(uv_loop_t* loop, uv_lane_t lane);
+
+/*
+ * Cancels a fs, work or getaddrinfo request that's still waiting for a
+ * thread. Its callback runs on the next loop iteration with
+ * uv_last_error() set to UV_ECANCELED. An fs request gets result -1 and
+ * errorno UV_ECANCELED. A getaddrinfo callback gets status UV_ECANCELED.
+ * The work_cb of a cancelled work request is never called.
+ *
+ * Returns 0 on success and -1 on error. The error is UV_EBUSY if the
+ * request is already running or done and UV_EINVAL for other request
+ * types, which can't be cancelled.
+ *
+ * Not supported on Windows, where fs, work and getaddrinfo requests fail
+ * with UV_ENOSYS.
+ */
+UV_EXTERN int uv_cancel(uv_req_t* req);
+
 
 struct uv_cpu_info_s {
   char* model;
@@ -1353,6 +1719,35 @@ UV_EXTERN int uv_thread_create(uv_thread_t *tid,
     void (*entry)(void *arg), void *arg);
 UV_EXTERN int uv_thread_join(uv_thread_t *tid);
 
+/*
+ * A TCP listener that runs on a loop and thread of its own. Several shards
+ * listen on the same address with uv_tcp_reuseport() turned on, the kernel
+ * hands each new connection to one of them.
+ *
+ * uv_tcp_shards_start() creates `count` shards and starts listening. The
+ * connection callback runs on the shard's thread; `server->data` points to
+ * the uv_tcp_shard_t. Handles created there belong to `shard->loop` and
+ * must only be touched from that thread. Set `data` before starting.
+ *
+ * uv_tcp_shards_stop() closes the listeners and joins the threads. A thread
+ * exits once its loop has no more active handles, so close the accepted
+ * connections first or make sure they close on their own.
+ */
+typedef struct uv_tcp_shard_s uv_tcp_shard_t;
+
+struct uv_tcp_shard_s {
+  uv_loop_t* loop;
+  uv_tcp_t server;
+  void* data;
+  /* private */
+  uv_async_t stop_async;
+  uv_thread_t thread;
+};
+
+UV_EXTERN uv_err_t uv_tcp_shards_start(uv_tcp_shard_t* shards, int count,
+    struct sockaddr_in addr, int backlog, uv_connection_cb cb);
+UV_EXTERN void uv_tcp_shards_stop(uv_tcp_shard_t* shards, int count);
+
 /* the presence of these unions force similar struct layout */
 union uv_any_handle {
   uv_tcp_t tcp;
@@ -1378,6 +1773,7 @@ union uv_any_req {
 
 struct uv_counters_s {
   uint64_t eio_init;
+  uint64_t threadpool_init;
   uint64_t req_init;
   uint64_t handle_init;
   uint64_t stream_init;
@@ -1389,11 +1785,73 @@ struct uv_counters_s {
   uint64_t check_init;
   uint64_t idle_init;
   uint64_t async_init;
+  uint64_t channel_init;
   uint64_t timer_init;
   uint64_t process_init;
   uint64_t fs_event_init;
+  uint64_t accept;
+  uint64_t accept_error;
+  uint64_t accept_dropped;
+  /*
+   * I/O on the hot paths, unix only. The byte counts include streams
+   * (uv_write_file() and io_uring sends too), udp handles, uv_splice() and
+   * fs requests. read_syscalls and write_syscalls count every read(),
+   * recvmsg(), write(), sendmsg(), sendfile() and splice() call that the
+   * loop thread makes on those handles, retries and fallbacks included.
+   * Size probes with ioctl() and ops submitted to an io_uring aren't
+   * counted. eagain counts the calls that found the fd not ready and
+   * partial_writes the stream writes that the kernel took only part of.
+   */
+  uint64_t read_bytes;
+  uint64_t write_bytes;
+  uint64_t read_syscalls;
+  uint64_t write_syscalls;
+  uint64_t eagain;
+  uint64_t partial_writes;
+  /*
+   * Thread pool requests that were submitted but whose callbacks have not
+   * run yet, and the highest that number has been.
+   */
+  uint64_t work_pending;
+  uint64_t work_pending_max;
+};
+
+
+/*
+ * Runtime metrics of a loop, times are in nanoseconds.
+ *
+ * An iteration starts when the loop comes back from polling for events and
+ * ends when it polls again, or when uv_run() or uv_run_once() returns; the
+ * time between two runs isn't counted. Its run time is the loop lag: how
+ * long an event that arrives right after the poll has to wait before the
+ * loop looks at it. lag_hist[0] counts the iterations that took less than 1 us,
+ * lag_hist[i] those that took 2^(i-1) us up to 2^i us and the last bucket
+ * everything longer than that.
+ *
+ * libev runs the pending callbacks of an iteration in batches, usually
+ * two. max_callback_time is the longest batch, an upper bound for the
+ * slowest callback.
+ */
+#define UV_LOOP_LAG_BUCKETS 24
+
+struct uv_loop_metrics_s {
+  uint64_t iterations;
+  uint64_t events;        /* Callbacks run. */
+  uint64_t max_events;    /* Most callbacks run in one iteration. */
+  uint64_t poll_time;     /* Blocked waiting for events. */
+  uint64_t run_time;      /* Running callbacks, the sum of the loop lag. */
+  uint64_t max_callback_time;
+  uint64_t lag_hist[UV_LOOP_LAG_BUCKETS];
 };
 
+/*
+ * Copies the metrics of `loop` into `metrics`. It's cheap and can be
+ * called from any thread, the loop never waits for it.
+ *
+ * Windows doesn't collect metrics yet, they're all zero there.
+ */
+UV_EXTERN void uv_loop_metrics(uv_loop_t* loop, uv_loop_metrics_t* metrics);
+
 
 struct uv_loop_s {
   UV_LOOP_PRIVATE_FIELDS
@@ -1421,6 +1879,7 @@ struct uv_loop_s {
 #undef UV_CHECK_PRIVATE_FIELDS
 #undef UV_IDLE_PRIVATE_FIELDS
 #undef UV_ASYNC_PRIVATE_FIELDS
+#undef UV_CHANNEL_PRIVATE_FIELDS
 #undef UV_TIMER_PRIVATE_FIELDS
 #undef UV_GETADDRINFO_PRIVATE_FIELDS
 #undef UV_FS_REQ_PRIVATE_FIELDS
@@ -0,0 +1,131 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Multi-producer, single-consumer message channel.
+ *
+ * Senders push onto a lock-free stack with a compare-and-swap on its head.
+ * The loop thread takes the whole stack at once with an atomic exchange
+ * and reverses it, so the batch comes out oldest first. There's no ABA
+ * problem: the consumer never pops single messages, it only swaps in NULL.
+ *
+ * Only the send that finds the stack empty wakes up the loop. Later sends
+ * ride along with that wakeup until the loop has taken the batch.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+
+
+static uv_channel_msg_t* uv__channel_take(uv_channel_t* channel, int* count) {
+  uv_channel_msg_t* msg;
+  uv_channel_msg_t* next;
+  uv_channel_msg_t* head;
+  int n;
+
+  msg = __atomic_exchange_n(&channel->channel_head, NULL, __ATOMIC_ACQUIRE);
+
+  /* Reverse into send order. */
+  head = NULL;
+  for (n = 0; msg != NULL; n++) {
+    next = msg->next;
+    msg->next = head;
+    head = msg;
+    msg = next;
+  }
+
+  *count = n;
+  return head;
+}
+
+
+static void uv__channel_deliver(uv_channel_t* channel) {
+  uv_channel_msg_t* msgs;
+  int count;
+
+  msgs = uv__channel_take(channel, &count);
+
+  if (count > 0 && channel->channel_cb)
+    channel->channel_cb(channel, msgs, count);
+}
+
+
+static void uv__channel_async(EV_P_ ev_async* w, int revents) {
+  uv__channel_deliver(w->data);
+}
+
+
+int uv_channel_init(uv_loop_t* loop, uv_channel_t* channel,
+    uv_channel_cb channel_cb) {
+  uv__handle_init(loop, (uv_handle_t*)channel, UV_CHANNEL);
+  loop->counters.channel_init++;
+
+  ev_async_init(&channel->async_watcher, uv__channel_async);
+  channel->async_watcher.data = channel;
+
+  channel->channel_cb = channel_cb;
+  channel->channel_head = NULL;
+
+  /* The ref that uv__handle_init() took keeps the loop alive until the
+   * handle is closed, like with uv_async_t. The active watcher would take
+   * a second one, drop it. uv__channel_close() gives it back before
+   * stopping the watcher.
+   */
+  ev_async_start(loop->ev, &channel->async_watcher);
+  ev_unref(loop->ev);
+
+  return 0;
+}
+
+
+int uv_channel_send(uv_channel_t* channel, uv_channel_msg_t* msg) {
+  uv_channel_msg_t* head;
+
+  head = __atomic_load_n(&channel->channel_head, __ATOMIC_RELAXED);
+
+  do
+    msg->next = head;
+  while (!__atomic_compare_exchange_n(&channel->channel_head,
+                                      &head,
+                                      msg,
+                                      1,
+                                      __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED));
+
+  if (head == NULL)
+    ev_async_send(channel->loop->ev, &channel->async_watcher);
+
+  return 0;
+}
+
+
+void uv__channel_close(uv_channel_t* channel) {
+  ev_async_stop(channel->loop->ev, &channel->async_watcher);
+  ev_ref(channel->loop->ev);
+}
+
+
+void uv__channel_finish_close(uv_channel_t* channel) {
+  assert(!ev_is_active(&channel->async_watcher));
+  uv__channel_deliver(channel);
+}
@@ -61,11 +61,11 @@ static uv_loop_t* default_loop_ptr;
 
 void uv__next(EV_P_ ev_idle* watcher, int revents);
 static void uv__finish_close(uv_handle_t* handle);
+static void uv__async_close(uv_async_t* async);
 
 
 void uv_close(uv_handle_t* handle, uv_close_cb close_cb) {
   uv_udp_t* udp;
-  uv_async_t* async;
   uv_timer_t* timer;
   uv_stream_t* stream;
   uv_process_t* process;
@@ -82,7 +82,20 @@ void uv_close(uv_handle_t* handle, uv_close_cb close_cb) {
       stream = (uv_stream_t*)handle;
 
       uv_read_stop(stream);
-      ev_io_stop(stream->loop->ev, &stream->write_watcher);
+      uv__stream_watcher_stop(stream, &stream->write_watcher);
+
+      if (stream->splice_from || stream->splice_to)
+        uv__splice_close(stream);
+
+#if HAVE_SYS_IO_URING
+      if (stream->iou)
+        uv__iou_stream_close(stream);
+#endif
+
+#if HAVE_MSG_ZEROCOPY
+      if (stream->zerocopy)
+        uv__zerocopy_close(stream);
+#endif
 
       uv__close(stream->fd);
       stream->fd = -1;
@@ -117,17 +130,12 @@ void uv_close(uv_handle_t* handle, uv_close_cb close_cb) {
       break;
 
     case UV_ASYNC:
-      async = (uv_async_t*)handle;
-      ev_async_stop(async->loop->ev, &async->async_watcher);
-      ev_ref(async->loop->ev);
+      uv__async_close((uv_async_t*)handle);
       break;
 
     case UV_TIMER:
       timer = (uv_timer_t*)handle;
-      if (ev_is_active(&timer->timer_watcher)) {
-        ev_ref(timer->loop->ev);
-      }
-      ev_timer_stop(timer->loop->ev, &timer->timer_watcher);
+      uv_timer_stop(timer);
       break;
 
     case UV_PROCESS:
@@ -139,6 +147,10 @@ void uv_close(uv_handle_t* handle, uv_close_cb close_cb) {
       uv__fs_event_destroy((uv_fs_event_t*)handle);
       break;
 
+    case UV_CHANNEL:
+      uv__channel_close((uv_channel_t*)handle);
+      break;
+
     default:
       assert(0);
   }
@@ -161,7 +173,18 @@ static int uv__loop_init(uv_loop_t* loop,
   loop->ev = ev_loop_new(EVFLAG_AUTO);
 #endif
   ev_set_userdata(loop->ev, loop);
+  uv__metrics_loop_init(loop);
   eio_channel_init(&loop->uv_eio_channel, loop);
+  loop->epoll_fd = -1;
+  loop->zerocopy_fd = -1;
+  loop->emfile_fd = -1;
+  uv__async_loop_init(loop);
+
+  if (uv__threadpool_loop_init(loop)) {
+    ev_loop_destroy(loop->ev);
+    return -1;
+  }
+
   return 0;
 }
 
@@ -181,8 +204,70 @@ uv_loop_t* uv_loop_new(void) {
 }
 
 
+uv_loop_t* uv_loop_new2(unsigned int flags) {
+  uv_loop_t* loop;
+
+  if ((loop = uv_loop_new()) == NULL)
+    return NULL;
+
+  if (flags & UV_LOOP_TIMER_WHEEL) {
+    if (uv__timer_wheel_init(loop)) {
+      uv_loop_delete(loop);
+      return NULL;
+    }
+  }
+
+#if HAVE_EPOLL
+  if (flags & UV_LOOP_EPOLL) {
+    if (uv__epoll_init(loop)) {
+      uv_loop_delete(loop);
+      return NULL;
+    }
+  }
+#endif
+
+#if HAVE_SYS_IO_URING
+  /* Not fatal, everything runs on the regular code paths without a ring. */
+  if (flags & (UV_LOOP_IO_URING | UV_LOOP_IO_URING_NET)) {
+    uv__iou_init(loop,
+                 flags & UV_LOOP_IO_URING,
+                 (flags & UV_LOOP_IO_URING_NET) && loop->epoll_fd == -1);
+  }
+#endif
+
+  return loop;
+}
+
+
 void uv_loop_delete(uv_loop_t* loop) {
   uv_ares_destroy(loop, loop->channel);
+
+  if (loop->timer_wheel)
+    uv__timer_wheel_destroy(loop);
+
+#if HAVE_EPOLL
+  if (loop->epoll_fd != -1)
+    uv__epoll_destroy(loop);
+#endif
+
+#if HAVE_SYS_IO_URING
+  if (loop->iou)
+    uv__iou_destroy(loop);
+#endif
+
+#if HAVE_MSG_ZEROCOPY
+  if (loop->zerocopy_fd != -1)
+    uv__zerocopy_loop_delete(loop);
+#endif
+
+  if (loop->read_pool)
+    uv__read_pool_destroy(loop);
+
+  if (loop->emfile_fd != -1)
+    uv__close(loop->emfile_fd);
+
+  uv__threadpool_loop_delete(loop);
+  uv__async_loop_delete(loop);
   ev_loop_destroy(loop->ev);
 
 #ifndef NDEBUG
@@ -215,12 +300,14 @@ uv_loop_t* uv_default_loop(void) {
 
 int uv_run(uv_loop_t* loop) {
   ev_run(loop->ev, 0);
+  uv__metrics_run_end(loop);
   return 0;
 }
 
 
 int uv_run_once(uv_loop_t* loop) {
   ev_run(loop->ev, EVRUN_ONCE);
+  uv__metrics_run_end(loop);
   return 0;
 }
 
@@ -262,11 +349,10 @@ void uv__finish_close(uv_handle_t* handle) {
       break;
 
     case UV_ASYNC:
-      assert(!ev_is_active(&((uv_async_t*)handle)->async_watcher));
       break;
 
     case UV_TIMER:
-      assert(!ev_is_active(&((uv_timer_t*)handle)->timer_watcher));
+      assert(!uv_is_active(handle));
       break;
 
     case UV_NAMED_PIPE:
@@ -292,6 +378,10 @@ void uv__finish_close(uv_handle_t* handle) {
     case UV_FS_EVENT:
       break;
 
+    case UV_CHANNEL:
+      uv__channel_finish_close((uv_channel_t*)handle);
+      break;
+
     default:
       assert(0);
       break;
@@ -316,6 +406,18 @@ void uv__next(EV_P_ ev_idle* watcher, int revents) {
    * put more stuff here later.
    */
   assert(handle->flags & UV_CLOSING);
+
+#if HAVE_SYS_IO_URING
+  /* The kernel may still be reading from the buffers of a write. Wait for
+   * the send to complete, uv__stream_iou_sent() feeds the watcher again.
+   */
+  if ((handle->type == UV_TCP || handle->type == UV_NAMED_PIPE) &&
+      uv__iou_sending((uv_stream_t*) handle)) {
+    ev_idle_stop(handle->loop->ev, watcher);
+    return;
+  }
+#endif
+
   uv__finish_close(handle);
 }
 
@@ -499,6 +601,8 @@ int uv_idle_stop(uv_idle_t* idle) {
 int uv_is_active(uv_handle_t* handle) {
   switch (handle->type) {
     case UV_TIMER:
+      if (handle->loop->timer_wheel)
+        return (handle->flags & UV_TIMER_ACTIVE) != 0;
       return ev_is_active(&((uv_timer_t*)handle)->timer_watcher);
 
     case UV_PREPARE:
@@ -516,11 +620,90 @@ int uv_is_active(uv_handle_t* handle) {
 }
 
 
-static void uv__async(EV_P_ ev_async* w, int revents) {
-  uv_async_t* async = w->data;
+/*
+ * All uv_async_t handles of a loop share the loop's async_watcher. A send
+ * pushes the handle onto a lock-free stack, unless it's pending already,
+ * and only the send that finds the stack empty wakes up the loop. The loop
+ * runs the callbacks of the handles on the stack and no others, so a
+ * wakeup costs the same with ten or ten thousand handles.
+ */
+
+/* Moves the signalled handles to the end of loop->async_queue. */
+static void uv__async_take(uv_loop_t* loop) {
+  uv_async_t* async;
+  uv_async_t* next;
+  uv_async_t* head;
+  uv_async_t** tail;
+
+  async = __atomic_exchange_n(&loop->async_pending, NULL, __ATOMIC_ACQUIRE);
+
+  /* The stack is newest first. */
+  head = NULL;
+  while (async != NULL) {
+    next = async->async_next;
+    async->async_next = head;
+    head = async;
+    async = next;
+  }
+
+  tail = &loop->async_queue;
+  while (*tail != NULL)
+    tail = &(*tail)->async_next;
+
+  *tail = head;
+}
+
+
+static void uv__async_io(EV_P_ ev_async* w, int revents) {
+  uv_loop_t* uv_loop;
+  uv_async_t* async;
+
+  uv_loop = w->data;
+  uv__async_take(uv_loop);
+
+  while ((async = uv_loop->async_queue) != NULL) {
+    uv_loop->async_queue = async->async_next;
+
+    /* Sends from here on queue the handle again. */
+    __atomic_store_n(&async->async_sent, 0, __ATOMIC_SEQ_CST);
+
+    if (async->async_cb) {
+      async->async_cb(async, 0);
+    }
+  }
+}
+
+
+void uv__async_loop_init(uv_loop_t* loop) {
+  ev_async_init(&loop->async_watcher, uv__async_io);
+  loop->async_watcher.data = loop;
+  ev_async_start(loop->ev, &loop->async_watcher);
+  /* The handles keep the loop alive, the watcher itself doesn't. */
+  ev_unref(loop->ev);
+}
+
+
+void uv__async_loop_delete(uv_loop_t* loop) {
+  ev_ref(loop->ev);
+  ev_async_stop(loop->ev, &loop->async_watcher);
+}
+
+
+static void uv__async_close(uv_async_t* async) {
+  uv_loop_t* loop = async->loop;
+  uv_async_t** p;
+
+  if (!__atomic_load_n(&async->async_sent, __ATOMIC_ACQUIRE))
+    return;
 
-  if (async->async_cb) {
-    async->async_cb(async, 0);
+  /* It can't be taken off the stack, take the whole stack instead. */
+  uv__async_take(loop);
+
+  for (p = &loop->async_queue; *p != NULL; p = &(*p)->async_next) {
+    if (*p == async) {
+      *p = async->async_next;
+      break;
+    }
   }
 }
 
@@ -529,21 +712,35 @@ int uv_async_init(uv_loop_t* loop, uv_async_t* async, uv_async_cb async_cb) {
   uv__handle_init(loop, (uv_handle_t*)async, UV_ASYNC);
   loop->counters.async_init++;
 
-  ev_async_init(&async->async_watcher, uv__async);
-  async->async_watcher.data = async;
-
   async->async_cb = async_cb;
-
-  /* Note: This does not have symmetry with the other libev wrappers. */
-  ev_async_start(loop->ev, &async->async_watcher);
-  ev_unref(loop->ev);
+  async->async_next = NULL;
+  async->async_sent = 0;
 
   return 0;
 }
 
 
 int uv_async_send(uv_async_t* async) {
-  ev_async_send(async->loop->ev, &async->async_watcher);
+  uv_loop_t* loop = async->loop;
+  uv_async_t* head;
+
+  if (__atomic_exchange_n(&async->async_sent, 1, __ATOMIC_ACQ_REL))
+    return 0; /* Pending already. */
+
+  head = __atomic_load_n(&loop->async_pending, __ATOMIC_RELAXED);
+
+  do
+    async->async_next = head;
+  while (!__atomic_compare_exchange_n(&loop->async_pending,
+                                      &head,
+                                      async,
+                                      1,
+                                      __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED));
+
+  if (head == NULL)
+    ev_async_send(loop->ev, &loop->async_watcher);
+
   return 0;
 }
 
@@ -574,11 +771,18 @@ int uv_timer_init(uv_loop_t* loop, uv_timer_t* timer) {
 
 int uv_timer_start(uv_timer_t* timer, uv_timer_cb cb, int64_t timeout,
     int64_t repeat) {
-  if (ev_is_active(&timer->timer_watcher)) {
+  if (uv_is_active((uv_handle_t*)timer)) {
     return -1;
   }
 
   timer->timer_cb = cb;
+
+  if (timer->loop->timer_wheel) {
+    timer->timer_repeat = repeat > 0 ? repeat : 0;
+    uv__timer_wheel_start(timer, timeout);
+    return 0;
+  }
+
   ev_timer_set(&timer->timer_watcher, timeout / 1000.0, repeat / 1000.0);
   ev_timer_start(timer->loop->ev, &timer->timer_watcher);
   ev_unref(timer->loop->ev);
@@ -587,6 +791,11 @@ int uv_timer_start(uv_timer_t* timer, uv_timer_cb cb, int64_t timeout,
 
 
 int uv_timer_stop(uv_timer_t* timer) {
+  if (timer->loop->timer_wheel) {
+    uv__timer_wheel_stop(timer);
+    return 0;
+  }
+
   if (ev_is_active(&timer->timer_watcher)) {
     ev_ref(timer->loop->ev);
   }
@@ -597,11 +806,18 @@ int uv_timer_stop(uv_timer_t* timer) {
 
 
 int uv_timer_again(uv_timer_t* timer) {
-  if (!ev_is_active(&timer->timer_watcher)) {
+  if (!uv_is_active((uv_handle_t*)timer)) {
     uv__set_sys_error(timer->loop, EINVAL);
     return -1;
   }
 
+  if (timer->loop->timer_wheel) {
+    uv__timer_wheel_stop(timer);
+    if (timer->timer_repeat)
+      uv__timer_wheel_start(timer, timer->timer_repeat);
+    return 0;
+  }
+
   ev_timer_again(timer->loop->ev, &timer->timer_watcher);
   return 0;
 }
@@ -609,16 +825,21 @@ int uv_timer_again(uv_timer_t* timer) {
 void uv_timer_set_repeat(uv_timer_t* timer, int64_t repeat) {
   assert(timer->type == UV_TIMER);
   timer->timer_watcher.repeat = repeat / 1000.0;
+  timer->timer_repeat = repeat > 0 ? repeat : 0;
 }
 
 int64_t uv_timer_get_repeat(uv_timer_t* timer) {
   assert(timer->type == UV_TIMER);
+
+  if (timer->loop->timer_wheel)
+    return timer->timer_repeat;
+
   return (int64_t)(1000 * timer->timer_watcher.repeat);
 }
 
 
-static int uv_getaddrinfo_done(eio_req* req) {
-  uv_getaddrinfo_t* handle = req->data;
+static void uv__getaddrinfo_done(struct uv__work* w, int status) {
+  uv_getaddrinfo_t* handle = container_of(w, uv_getaddrinfo_t, work_req);
   struct addrinfo *res = handle->res;
 #if __sun
   size_t hostlen = strlen(handle->hostname);
@@ -632,6 +853,13 @@ static int uv_getaddrinfo_done(eio_req* req) {
   free(handle->service);
   free(handle->hostname);
 
+  if (status == UV_ECANCELED) {
+    assert(res == NULL);
+    uv__set_artificial_error(handle->loop, UV_ECANCELED);
+    handle->cb(handle, UV_ECANCELED, NULL);
+    return;
+  }
+
   if (handle->retcode == 0) {
     /* OK */
 #if EAI_NODATA /* FreeBSD deprecated EAI_NODATA */
@@ -650,13 +878,11 @@ static int uv_getaddrinfo_done(eio_req* req) {
   }
 
   handle->cb(handle, handle->retcode, res);
-
-  return 0;
 }
 
 
-static void getaddrinfo_thread_proc(eio_req *req) {
-  uv_getaddrinfo_t* handle = req->data;
+static void uv__getaddrinfo_work(struct uv__work* w) {
+  uv_getaddrinfo_t* handle = container_of(w, uv_getaddrinfo_t, work_req);
 
   handle->retcode = getaddrinfo(handle->hostname,
                                 handle->service,
@@ -672,9 +898,6 @@ int uv_getaddrinfo(uv_loop_t* loop,
                    const char* hostname,
                    const char* service,
                    const struct addrinfo* hints) {
-  eio_req* req;
-  uv_eio_init(loop);
-
   if (handle == NULL || cb == NULL ||
       (hostname == NULL && service == NULL)) {
     uv__set_artificial_error(loop, UV_EINVAL);
@@ -706,13 +929,15 @@ int uv_getaddrinfo(uv_loop_t* loop,
   /* TODO check handle->hostname == NULL */
   /* TODO check handle->service == NULL */
 
-  uv_ref(loop);
-
-  req = eio_custom(getaddrinfo_thread_proc, EIO_PRI_DEFAULT,
-      uv_getaddrinfo_done, handle, &loop->uv_eio_channel);
-  assert(req);
-  assert(req->data == handle);
+  if (uv__work_submit(loop, &handle->work_req, uv__getaddrinfo_work,
+      uv__getaddrinfo_done)) {
+    free(handle->hints);
+    free(handle->service);
+    free(handle->hostname);
+    return -1;
+  }
 
+  uv_ref(loop);
   return 0;
 }
 
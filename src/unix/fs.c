@@ -35,37 +35,27 @@
 #include <sys/time.h>
 
 
-#define ARGS1(a)       (a)
-#define ARGS2(a,b)     (a), (b)
-#define ARGS3(a,b,c)   (a), (b), (c)
-#define ARGS4(a,b,c,d) (a), (b), (c), (d)
-
-#define WRAP_EIO(type, eiofunc, func, args) \
-  uv_fs_req_init(loop, req, type, path, cb); \
-  if (cb) { \
-    /* async */ \
-    req->eio = eiofunc(args, EIO_PRI_DEFAULT, uv__fs_after, req, &loop->uv_eio_channel); \
-    if (!req->eio) { \
-      uv__set_sys_error(loop, ENOMEM); \
-      return -1; \
-    } \
-    uv_ref(loop); \
-  } else { \
-    /* sync */ \
-    req->result = func(args); \
-    if (req->result) { \
-      uv__set_sys_error(loop, errno); \
-    }  \
-    return req->result; \
-  } \
-  return 0;
+#define POST                                                                  \
+  do {                                                                        \
+    if (cb) {                                                                 \
+      /* async */                                                             \
+      if (uv__fs_submit(loop, req))                                           \
+        return -1;                                                            \
+      uv_ref(loop);                                                           \
+      return 0;                                                               \
+    }                                                                         \
+    else {                                                                    \
+      /* sync */                                                              \
+      uv__fs_work(&req->work_req);                                            \
+      uv__fs_finish(req);                                                     \
+      return req->result < 0 ? -1 : req->result;                              \
+    }                                                                         \
+  }                                                                           \
+  while (0)
 
 
 static void uv_fs_req_init(uv_loop_t* loop, uv_fs_t* req, uv_fs_type fs_type,
     const char* path, uv_fs_cb cb) {
-  /* Make sure the thread pool is initialized. */
-  uv_eio_init(loop);
-
   uv__req_init(loop, (uv_req_t*)req);
   req->type = UV_FS;
   req->loop = loop;
@@ -74,8 +64,9 @@ static void uv_fs_req_init(uv_loop_t* loop, uv_fs_t* req, uv_fs_type fs_type,
   req->result = 0;
   req->ptr = NULL;
   req->path = path ? strdup(path) : NULL;
+  req->new_path = NULL;
   req->errorno = 0;
-  req->eio = NULL;
+  req->work_req.worker = NULL;
 }
 
 
@@ -83,6 +74,9 @@ void uv_fs_req_cleanup(uv_fs_t* req) {
   free(req->path);
   req->path = NULL;
 
+  free(req->new_path);
+  req->new_path = NULL;
+
   switch (req->fs_type) {
     case UV_FS_READDIR:
       assert(req->result > 0 ? (req->ptr != NULL) : (req->ptr == NULL));
@@ -101,429 +95,504 @@ void uv_fs_req_cleanup(uv_fs_t* req) {
 }
 
 
-static int uv__fs_after(eio_req* eio) {
-  char* name;
-  int namelen;
-  int buflen = 0;
-  uv_fs_t* req = eio->data;
-  int i;
-
-  assert(req->cb);
-
-  req->result = req->eio->result;
-  req->errorno = uv_translate_sys_error(req->eio->errorno);
-
-  switch (req->fs_type) {
-    case UV_FS_READDIR:
-      /*
-       * XXX This is pretty bad.
-       * We alloc and copy the large null terminated string list from libeio.
-       * This is done because libeio is going to free eio->ptr2 after this
-       * callback. We must keep it until uv_fs_req_cleanup. If we get rid of
-       * libeio this can be avoided.
-       */
-      buflen = 0;
-      name = req->eio->ptr2;
-
-      for (i = 0; i < req->result; i++) {
-        namelen = strlen(name);
-        buflen += namelen + 1;
-        name += namelen;
-        assert(*name == '\0');
-        name++;
-      }
-
-      if (buflen) {
-        if ((req->ptr = malloc(buflen)))
-          memcpy(req->ptr, req->eio->ptr2, buflen);
-        else
-          uv__set_sys_error(req->loop, ENOMEM);
-      }
-      break;
-
-    case UV_FS_STAT:
-    case UV_FS_LSTAT:
-    case UV_FS_FSTAT:
-      req->ptr = req->eio->ptr2;
-      break;
+static ssize_t uv__fs_open(uv_fs_t* req) {
+  int fd;
 
-    case UV_FS_READLINK:
-      if (req->result == -1) {
-        req->ptr = NULL;
-        break;
-      }
-      assert(req->result > 0);
-
-      /* Make zero-terminated copy of req->eio->ptr2 */
-      if ((req->ptr = name = malloc(req->result + 1))) {
-        memcpy(name, req->eio->ptr2, req->result);
-        name[req->result] = '\0';
-        req->result = 0;
-      }
-      else {
-        req->errorno = ENOMEM;
-        req->result = -1;
-      }
-      break;
+  fd = open(req->path, req->flags, req->mode);
 
-    default:
-      break;
-  }
+  if (fd != -1)
+    uv__cloexec(fd, 1);
 
-  uv_unref(req->loop);
-  req->eio = NULL; /* Freed by libeio */
-
-  req->cb(req);
-  return 0;
+  return fd;
 }
 
 
-int uv_fs_close(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
-  char* path = NULL;
-  WRAP_EIO(UV_FS_CLOSE, eio_close, close, ARGS1(file));
-}
+static ssize_t uv__fs_readdir(uv_fs_t* req) {
+  struct dirent* entry;
+  size_t size = 0;
+  size_t d_namlen = 0;
+  ssize_t nentries;
+  DIR* dir;
+  char* names;
+  char* buf;
 
+  dir = opendir(req->path);
+  if (!dir)
+    return -1;
 
-int uv_fs_open(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags,
-    int mode, uv_fs_cb cb) {
-  uv_fs_req_init(loop, req, UV_FS_OPEN, path, cb);
+  /* req->result stores number of entries */
+  names = NULL;
+  nentries = 0;
 
-  if (cb) {
-    /* async */
-    uv_ref(loop);
-    req->eio = eio_open(path, flags, mode, EIO_PRI_DEFAULT, uv__fs_after, req, &loop->uv_eio_channel);
-    if (!req->eio) {
-      uv__set_sys_error(loop, ENOMEM);
-      return -1;
+  while ((entry = readdir(dir))) {
+    d_namlen = strlen(entry->d_name);
+
+    /* Skip . and .. */
+    if ((d_namlen == 1 && entry->d_name[0] == '.') ||
+        (d_namlen == 2 && entry->d_name[0] == '.' &&
+         entry->d_name[1] == '.')) {
+      continue;
     }
 
-  } else {
-    /* sync */
-    req->result = open(path, flags, mode);
-    if (req->result < 0) {
-      uv__set_sys_error(loop, errno);
+    buf = realloc(names, size + d_namlen + 1);
+    if (buf == NULL) {
+      closedir(dir);
+      free(names);
+      errno = ENOMEM;
       return -1;
     }
 
-    uv__cloexec(req->result, 1);
+    names = buf;
+    memcpy(names + size, entry->d_name, d_namlen);
+    size += d_namlen;
+    names[size] = '\0';
+    size++;
+    nentries++;
+  }
 
-    return req->result;
+  if (closedir(dir)) {
+    free(names);
+    return -1;
   }
 
-  return 0;
+  req->work_ptr = names;
+  return nentries;
 }
 
 
-int uv_fs_read(uv_loop_t* loop, uv_fs_t* req, uv_file fd, void* buf,
-    size_t length, off_t offset, uv_fs_cb cb) {
-  uv_fs_req_init(loop, req, UV_FS_READ, NULL, cb);
+static ssize_t uv__fs_stat(uv_fs_t* req) {
+  char* pathdup;
+  int pathlen;
+  int r;
 
-  if (cb) {
-    /* async */
-    uv_ref(loop);
-    req->eio = eio_read(fd, buf, length, offset, EIO_PRI_DEFAULT,
-        uv__fs_after, req,  &loop->uv_eio_channel);
+  /* TODO do this without duplicating the string. */
+  /* TODO security */
+  pathdup = strdup(req->path);
+  if (pathdup == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
 
-    if (!req->eio) {
-      uv__set_sys_error(loop, ENOMEM);
-      return -1;
-    }
+  pathlen = strlen(pathdup);
 
-  } else {
-    /* sync */
-    req->result = offset < 0 ?
-      read(fd, buf, length) :
-      pread(fd, buf, length, offset);
+  if (pathlen > 0 && pathdup[pathlen - 1] == '\\') {
+    pathdup[pathlen - 1] = '\0';
+  }
 
-    if (req->result < 0) {
-      uv__set_sys_error(loop, errno);
-      return -1;
-    }
+  if (req->fs_type == UV_FS_LSTAT)
+    r = lstat(pathdup, &req->statbuf);
+  else
+    r = stat(pathdup, &req->statbuf);
+
+  free(pathdup);
+
+  if (r == 0)
+    req->work_ptr = &req->statbuf;
 
-    return req->result;
+  return r;
+}
+
+
+static ssize_t uv__fs_readlink(uv_fs_t* req) {
+  ssize_t size;
+  char* buf;
+
+  /* pathconf(_PC_PATH_MAX) may return -1 to signify that path
+   * lengths have no upper limit or aren't suitable for malloc'ing.
+   */
+  if ((size = pathconf(req->path, _PC_PATH_MAX)) == -1) {
+#if defined(PATH_MAX)
+    size = PATH_MAX;
+#else
+    size = 4096;
+#endif
+  }
+
+  if ((buf = malloc(size + 1)) == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  if ((size = readlink(req->path, buf, size)) == -1) {
+    free(buf);
+    return -1;
   }
 
+  /* Cannot conceivably fail since it shrinks the buffer. */
+  buf = realloc(buf, size + 1);
+  buf[size] = '\0';
+  req->work_ptr = buf;
+
   return 0;
 }
 
 
-int uv_fs_unlink(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
-  WRAP_EIO(UV_FS_UNLINK, eio_unlink, unlink, ARGS1(path))
+static int _utime(const char* path, double atime, double mtime) {
+  struct utimbuf buf;
+  buf.actime = atime;
+  buf.modtime = mtime;
+  return utime(path, &buf);
 }
 
 
-int uv_fs_write(uv_loop_t* loop, uv_fs_t* req, uv_file file, void* buf,
-    size_t length, off_t offset, uv_fs_cb cb) {
-  uv_fs_req_init(loop, req, UV_FS_WRITE, NULL, cb);
+#if HAVE_FUTIMES
+static int _futime(const uv_file file, double atime, double mtime) {
+  struct timeval tv[2];
 
-  if (cb) {
-    /* async */
-    uv_ref(loop);
-    req->eio = eio_write(file, buf, length, offset, EIO_PRI_DEFAULT,
-        uv__fs_after, req,  &loop->uv_eio_channel);
-    if (!req->eio) {
-      uv__set_sys_error(loop, ENOMEM);
-      return -1;
-    }
+  /* FIXME possible loss of precision in floating-point arithmetic? */
+  tv[0].tv_sec = atime;
+  tv[0].tv_usec = (unsigned long)(atime * 1000000) % 1000000;
 
-  } else {
-    /* sync */
-    req->result = offset < 0 ?
-        write(file, buf, length) :
-        pwrite(file, buf, length, offset);
+  tv[1].tv_sec = mtime;
+  tv[1].tv_usec = (unsigned long)(mtime * 1000000) % 1000000;
 
-    if (req->result < 0) {
-      uv__set_sys_error(loop, errno);
-      return -1;
-    }
+#ifdef __sun
+  return futimesat(file, NULL, tv);
+#else
+  return futimes(file, tv);
+#endif
+}
+#endif
+
+
+/*
+ * Runs the request. Called from a thread pool thread for async requests
+ * and straight from the uv_fs_* function for sync ones.
+ */
+static void uv__fs_work(struct uv__work* w) {
+  uv_fs_t* req;
+  ssize_t r;
+
+  req = container_of(w, uv_fs_t, work_req);
+  req->work_ptr = NULL;
+
+  switch (req->fs_type) {
+    case UV_FS_CLOSE:
+      r = close(req->file);
+      break;
+
+    case UV_FS_OPEN:
+      r = uv__fs_open(req);
+      break;
+
+    case UV_FS_READ:
+      r = req->off < 0 ?
+        read(req->file, req->buf, req->len) :
+        pread(req->file, req->buf, req->len, req->off);
+      break;
+
+    case UV_FS_WRITE:
+      r = req->off < 0 ?
+        write(req->file, req->buf, req->len) :
+        pwrite(req->file, req->buf, req->len, req->off);
+      break;
+
+    case UV_FS_SENDFILE:
+      r = eio_sendfile_sync(req->file, req->in_file, req->off, req->len);
+      break;
+
+    case UV_FS_STAT:
+    case UV_FS_LSTAT:
+      r = uv__fs_stat(req);
+      break;
+
+    case UV_FS_FSTAT:
+      r = fstat(req->file, &req->statbuf);
+      if (r == 0)
+        req->work_ptr = &req->statbuf;
+      break;
+
+    case UV_FS_FTRUNCATE:
+      r = ftruncate(req->file, req->off);
+      break;
+
+    case UV_FS_UTIME:
+      r = _utime(req->path, req->atime, req->mtime);
+      break;
+
+    case UV_FS_FUTIME:
+#if HAVE_FUTIMES
+      r = _futime(req->file, req->atime, req->mtime);
+#else
+      errno = ENOSYS;
+      r = -1;
+#endif
+      break;
+
+    case UV_FS_CHMOD:
+      r = chmod(req->path, req->mode);
+      break;
+
+    case UV_FS_FCHMOD:
+      r = fchmod(req->file, req->mode);
+      break;
+
+    case UV_FS_FSYNC:
+      r = fsync(req->file);
+      break;
+
+    case UV_FS_FDATASYNC:
+#if defined(__FreeBSD__) \
+  || (__ENVIRONMENT_MAC_OS_X_VERSION_MIN_REQUIRED__ < 1060)
+      /* freebsd and pre-10.6 darwin don't have fdatasync,
+       * do a full fsync instead.
+       */
+      r = fsync(req->file);
+#else
+      r = fdatasync(req->file);
+#endif
+      break;
+
+    case UV_FS_UNLINK:
+      r = unlink(req->path);
+      break;
+
+    case UV_FS_RMDIR:
+      r = rmdir(req->path);
+      break;
+
+    case UV_FS_MKDIR:
+      r = mkdir(req->path, req->mode);
+      break;
+
+    case UV_FS_RENAME:
+      r = rename(req->path, req->new_path);
+      break;
+
+    case UV_FS_READDIR:
+      r = uv__fs_readdir(req);
+      break;
+
+    case UV_FS_LINK:
+      r = link(req->path, req->new_path);
+      break;
+
+    case UV_FS_SYMLINK:
+      r = symlink(req->path, req->new_path);
+      break;
+
+    case UV_FS_READLINK:
+      r = uv__fs_readlink(req);
+      break;
+
+    case UV_FS_CHOWN:
+      r = chown(req->path, req->uid, req->gid);
+      break;
+
+    case UV_FS_FCHOWN:
+      r = fchown(req->file, req->uid, req->gid);
+      break;
 
-    return req->result;
+    default:
+      assert(0 && "unhandled fs_type");
+      errno = ENOSYS;
+      r = -1;
+      break;
   }
 
-  return 0;
+  /*
+   * Don't touch the public fields here, the user may be looking at them
+   * from the loop thread while an async request is running.
+   */
+  req->work_result = r;
+  req->work_errno = r < 0 ? errno : 0;
 }
 
 
-int uv_fs_mkdir(uv_loop_t* loop, uv_fs_t* req, const char* path, int mode,
-    uv_fs_cb cb) {
-  WRAP_EIO(UV_FS_MKDIR, eio_mkdir, mkdir, ARGS2(path, mode))
-}
+/* Publishes the outcome of uv__fs_work(). Runs on the loop thread. */
+static void uv__fs_finish(uv_fs_t* req) {
+  req->result = req->work_result;
+  req->ptr = req->work_ptr;
 
+  if (req->result < 0) {
+    uv__set_sys_error(req->loop, req->work_errno);
+    req->errorno = uv_translate_sys_error(req->work_errno);
+    return;
+  }
 
-int uv_fs_rmdir(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
-  WRAP_EIO(UV_FS_RMDIR, eio_rmdir, rmdir, ARGS1(path))
+  if (req->fs_type == UV_FS_READ)
+    req->loop->counters.read_bytes += req->result;
+  else if (req->fs_type == UV_FS_WRITE || req->fs_type == UV_FS_SENDFILE)
+    req->loop->counters.write_bytes += req->result;
 }
 
 
-int uv_fs_readdir(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags,
-    uv_fs_cb cb) {
-  int r;
-  struct dirent* entry;
-  size_t size = 0;
-  size_t d_namlen = 0;
+static void uv__fs_done(struct uv__work* w, int status) {
+  uv_fs_t* req;
 
-  uv_fs_req_init(loop, req, UV_FS_READDIR, path, cb);
+  req = container_of(w, uv_fs_t, work_req);
+  assert(req->cb);
 
-  if (cb) {
-    /* async */
-    uv_ref(loop);
-    req->eio = eio_readdir(path, flags, EIO_PRI_DEFAULT, uv__fs_after, req,  &loop->uv_eio_channel);
-    if (!req->eio) {
-      uv__set_sys_error(loop, ENOMEM);
-      return -1;
-    }
+  uv_unref(req->loop);
 
+  if (status == UV_ECANCELED) {
+    req->result = -1;
+    req->errorno = UV_ECANCELED;
+    uv__set_artificial_error(req->loop, UV_ECANCELED);
   } else {
-    /* sync */
-    DIR* dir = opendir(path);
-    if (!dir) {
-      uv__set_sys_error(loop, errno);
-      req->result = -1;
-      return -1;
-    }
+    uv__fs_finish(req);
+  }
 
-    /* req->result stores number of entries */
-    req->result = 0;
-
-    while ((entry = readdir(dir))) {
-      d_namlen = strlen(entry->d_name);
-
-      /* Skip . and .. */
-      if ((d_namlen == 1 && entry->d_name[0] == '.') ||
-          (d_namlen == 2 && entry->d_name[0] == '.' &&
-           entry->d_name[1] == '.')) {
-        continue;
-      }
-
-      req->ptr = realloc(req->ptr, size + d_namlen + 1);
-      /* TODO check ENOMEM */
-      memcpy((char*)req->ptr + size, entry->d_name, d_namlen);
-      size += d_namlen;
-      ((char*)req->ptr)[size] = '\0';
-      size++;
-      req->result++;
-    }
+  req->cb(req);
+}
 
-    r = closedir(dir);
-    if (r) {
-      uv__set_sys_error(loop, errno);
-      req->result = -1;
-      return -1;
-    }
 
-    return req->result;
-  }
+static int uv__fs_submit(uv_loop_t* loop, uv_fs_t* req) {
+#if HAVE_SYS_IO_URING
+  if (loop->iou && uv__iou_fs_submit(loop, req, uv__fs_done) == 0)
+    return 0;
+#endif
 
-  return 0;
+  return uv__work_submit(loop, &req->work_req, uv__fs_work, uv__fs_done);
 }
 
 
-int uv_fs_stat(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
-  char* pathdup;
-  int pathlen;
-
-  uv_fs_req_init(loop, req, UV_FS_STAT, path, cb);
+int uv_fs_close(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
+  uv_fs_req_init(loop, req, UV_FS_CLOSE, NULL, cb);
+  req->file = file;
+  POST;
+}
 
-  /* TODO do this without duplicating the string. */
-  /* TODO security */
-  pathdup = strdup(path);
-  pathlen = strlen(path);
 
-  if (pathlen > 0 && path[pathlen - 1] == '\\') {
-    /* TODO do not modify input string */
-    pathdup[pathlen - 1] = '\0';
-  }
+int uv_fs_open(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags,
+    int mode, uv_fs_cb cb) {
+  uv_fs_req_init(loop, req, UV_FS_OPEN, path, cb);
+  req->flags = flags;
+  req->mode = mode;
+  POST;
+}
 
-  if (cb) {
-    /* async */
-    uv_ref(loop);
-    req->eio = eio_stat(pathdup, EIO_PRI_DEFAULT, uv__fs_after, req,  &loop->uv_eio_channel);
 
-    free(pathdup);
+int uv_fs_read(uv_loop_t* loop, uv_fs_t* req, uv_file fd, void* buf,
+    size_t length, off_t offset, uv_fs_cb cb) {
+  uv_fs_req_init(loop, req, UV_FS_READ, NULL, cb);
+  req->file = fd;
+  req->buf = buf;
+  req->len = length;
+  req->off = offset;
+  POST;
+}
 
-    if (!req->eio) {
-      uv__set_sys_error(loop, ENOMEM);
-      return -1;
-    }
 
-  } else {
-    /* sync */
-    req->result = stat(pathdup, &req->statbuf);
+int uv_fs_unlink(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
+  uv_fs_req_init(loop, req, UV_FS_UNLINK, path, cb);
+  POST;
+}
 
-    free(pathdup);
 
-    if (req->result < 0) {
-      uv__set_sys_error(loop, errno);
-      return -1;
-    }
+int uv_fs_write(uv_loop_t* loop, uv_fs_t* req, uv_file file, void* buf,
+    size_t length, off_t offset, uv_fs_cb cb) {
+  uv_fs_req_init(loop, req, UV_FS_WRITE, NULL, cb);
+  req->file = file;
+  req->buf = buf;
+  req->len = length;
+  req->off = offset;
+  POST;
+}
 
-    req->ptr = &req->statbuf;
-    return req->result;
-  }
 
-  return 0;
+int uv_fs_mkdir(uv_loop_t* loop, uv_fs_t* req, const char* path, int mode,
+    uv_fs_cb cb) {
+  uv_fs_req_init(loop, req, UV_FS_MKDIR, path, cb);
+  req->mode = mode;
+  POST;
 }
 
 
-int uv_fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
-  uv_fs_req_init(loop, req, UV_FS_FSTAT, NULL, cb);
+int uv_fs_rmdir(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
+  uv_fs_req_init(loop, req, UV_FS_RMDIR, path, cb);
+  POST;
+}
 
-  if (cb) {
-    /* async */
-    uv_ref(loop);
-    req->eio = eio_fstat(file, EIO_PRI_DEFAULT, uv__fs_after, req,  &loop->uv_eio_channel);
 
-    if (!req->eio) {
-      uv__set_sys_error(loop, ENOMEM);
-      return -1;
-    }
+int uv_fs_readdir(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags,
+    uv_fs_cb cb) {
+  uv_fs_req_init(loop, req, UV_FS_READDIR, path, cb);
+  req->flags = flags;
+  POST;
+}
 
-  } else {
-    /* sync */
-    req->result = fstat(file, &req->statbuf);
 
-    if (req->result < 0) {
-      uv__set_sys_error(loop, errno);
-      return -1;
-    }
+int uv_fs_stat(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
+  uv_fs_req_init(loop, req, UV_FS_STAT, path, cb);
+  POST;
+}
 
-    req->ptr = &req->statbuf;
-    return req->result;
-  }
 
-  return 0;
+int uv_fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
+  uv_fs_req_init(loop, req, UV_FS_FSTAT, NULL, cb);
+  req->file = file;
+  POST;
 }
 
 
 int uv_fs_rename(uv_loop_t* loop, uv_fs_t* req, const char* path, const char* new_path,
     uv_fs_cb cb) {
-  WRAP_EIO(UV_FS_RENAME, eio_rename, rename, ARGS2(path, new_path))
+  uv_fs_req_init(loop, req, UV_FS_RENAME, path, cb);
+  req->new_path = strdup(new_path);
+  POST;
 }
 
 
 int uv_fs_fsync(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
-  char* path = NULL;
-  WRAP_EIO(UV_FS_FSYNC, eio_fsync, fsync, ARGS1(file))
+  uv_fs_req_init(loop, req, UV_FS_FSYNC, NULL, cb);
+  req->file = file;
+  POST;
 }
 
 
 int uv_fs_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
-  char* path = NULL;
-#if defined(__FreeBSD__) \
-  || (__ENVIRONMENT_MAC_OS_X_VERSION_MIN_REQUIRED__ < 1060)
-  /* freebsd and pre-10.6 darwin don't have fdatasync,
-   * do a full fsync instead.
-   */
-  WRAP_EIO(UV_FS_FDATASYNC, eio_fdatasync, fsync, ARGS1(file))
-#else
-  WRAP_EIO(UV_FS_FDATASYNC, eio_fdatasync, fdatasync, ARGS1(file))
-#endif
+  uv_fs_req_init(loop, req, UV_FS_FDATASYNC, NULL, cb);
+  req->file = file;
+  POST;
 }
 
 
 int uv_fs_ftruncate(uv_loop_t* loop, uv_fs_t* req, uv_file file, off_t offset,
     uv_fs_cb cb) {
-  char* path = NULL;
-  WRAP_EIO(UV_FS_FTRUNCATE, eio_ftruncate, ftruncate, ARGS2(file, offset))
+  uv_fs_req_init(loop, req, UV_FS_FTRUNCATE, NULL, cb);
+  req->file = file;
+  req->off = offset;
+  POST;
 }
 
 
 int uv_fs_sendfile(uv_loop_t* loop, uv_fs_t* req, uv_file out_fd, uv_file in_fd,
     off_t in_offset, size_t length, uv_fs_cb cb) {
-  char* path = NULL;
-  WRAP_EIO(UV_FS_SENDFILE, eio_sendfile, eio_sendfile_sync,
-      ARGS4(out_fd, in_fd, in_offset, length))
+  uv_fs_req_init(loop, req, UV_FS_SENDFILE, NULL, cb);
+  req->file = out_fd;
+  req->in_file = in_fd;
+  req->off = in_offset;
+  req->len = length;
+  POST;
 }
 
 
 int uv_fs_chmod(uv_loop_t* loop, uv_fs_t* req, const char* path, int mode,
     uv_fs_cb cb) {
-  WRAP_EIO(UV_FS_CHMOD, eio_chmod, chmod, ARGS2(path, mode))
-}
-
-
-static int _utime(const char* path, double atime, double mtime) {
-  struct utimbuf buf;
-  buf.actime = atime;
-  buf.modtime = mtime;
-  return utime(path, &buf);
+  uv_fs_req_init(loop, req, UV_FS_CHMOD, path, cb);
+  req->mode = mode;
+  POST;
 }
 
 
 int uv_fs_utime(uv_loop_t* loop, uv_fs_t* req, const char* path, double atime,
     double mtime, uv_fs_cb cb) {
-  WRAP_EIO(UV_FS_UTIME, eio_utime, _utime, ARGS3(path, atime, mtime))
+  uv_fs_req_init(loop, req, UV_FS_UTIME, path, cb);
+  req->atime = atime;
+  req->mtime = mtime;
+  POST;
 }
 
 
-#if HAVE_FUTIMES
-static int _futime(const uv_file file, double atime, double mtime) {
-  struct timeval tv[2];
-
-  /* FIXME possible loss of precision in floating-point arithmetic? */
-  tv[0].tv_sec = atime;
-  tv[0].tv_usec = (unsigned long)(atime * 1000000) % 1000000;
-
-  tv[1].tv_sec = mtime;
-  tv[1].tv_usec = (unsigned long)(mtime * 1000000) % 1000000;
-
-#ifdef __sun
-  return futimesat(file, NULL, tv);
-#else
-  return futimes(file, tv);
-#endif
-}
-#endif
-
-
 int uv_fs_futime(uv_loop_t* loop, uv_fs_t* req, uv_file file, double atime,
     double mtime, uv_fs_cb cb) {
-  const char* path = NULL;
-
-  uv_fs_req_init(loop, req, UV_FS_FUTIME, path, cb);
-
+  uv_fs_req_init(loop, req, UV_FS_FUTIME, NULL, cb);
 #if HAVE_FUTIMES
-  WRAP_EIO(UV_FS_FUTIME, eio_futime, _futime, ARGS3(file, atime, mtime))
+  req->file = file;
+  req->atime = atime;
+  req->mtime = mtime;
+  POST;
 #else
   uv__set_sys_error(loop, ENOSYS);
   return -1;
@@ -532,150 +601,80 @@ int uv_fs_futime(uv_loop_t* loop, uv_fs_t* req, uv_file file, double atime,
 
 
 int uv_fs_lstat(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
-  char* pathdup;
-  int pathlen;
-
   uv_fs_req_init(loop, req, UV_FS_LSTAT, path, cb);
-
-  /* TODO do this without duplicating the string. */
-  /* TODO security */
-  pathdup = strdup(path);
-  pathlen = strlen(path);
-
-  if (pathlen > 0 && path[pathlen - 1] == '\\') {
-    /* TODO do not modify input string */
-    pathdup[pathlen - 1] = '\0';
-  }
-
-  if (cb) {
-    /* async */
-    uv_ref(loop);
-    req->eio = eio_lstat(pathdup, EIO_PRI_DEFAULT, uv__fs_after, req,  &loop->uv_eio_channel);
-
-    free(pathdup);
-
-    if (!req->eio) {
-      uv__set_sys_error(loop, ENOMEM);
-      return -1;
-    }
-
-  } else {
-    /* sync */
-    req->result = lstat(pathdup, &req->statbuf);
-
-    free(pathdup);
-
-    if (req->result < 0) {
-      uv__set_sys_error(loop, errno);
-      return -1;
-    }
-
-    req->ptr = &req->statbuf;
-    return req->result;
-  }
-
-  return 0;
+  POST;
 }
 
 
 int uv_fs_link(uv_loop_t* loop, uv_fs_t* req, const char* path,
     const char* new_path, uv_fs_cb cb) {
-  WRAP_EIO(UV_FS_LINK, eio_link, link, ARGS2(path, new_path))
+  uv_fs_req_init(loop, req, UV_FS_LINK, path, cb);
+  req->new_path = strdup(new_path);
+  POST;
 }
 
 
 int uv_fs_symlink(uv_loop_t* loop, uv_fs_t* req, const char* path,
     const char* new_path, int flags, uv_fs_cb cb) {
-  WRAP_EIO(UV_FS_SYMLINK, eio_symlink, symlink, ARGS2(path, new_path))
+  uv_fs_req_init(loop, req, UV_FS_SYMLINK, path, cb);
+  req->new_path = strdup(new_path);
+  req->flags = flags;
+  POST;
 }
 
 
 int uv_fs_readlink(uv_loop_t* loop, uv_fs_t* req, const char* path,
     uv_fs_cb cb) {
-  ssize_t size;
-  char* buf;
-
   uv_fs_req_init(loop, req, UV_FS_READLINK, path, cb);
-
-  if (cb) {
-    if ((req->eio = eio_readlink(path, EIO_PRI_DEFAULT, uv__fs_after, req,  &loop->uv_eio_channel))) {
-      uv_ref(loop);
-      return 0;
-    } else {
-      uv__set_sys_error(loop, ENOMEM);
-      return -1;
-    }
-  } else {
-    /* pathconf(_PC_PATH_MAX) may return -1 to signify that path
-     * lengths have no upper limit or aren't suitable for malloc'ing.
-     */
-    if ((size = pathconf(path, _PC_PATH_MAX)) == -1) {
-#if defined(PATH_MAX)
-      size = PATH_MAX;
-#else
-      size = 4096;
-#endif
-    }
-
-    if ((buf = malloc(size + 1)) == NULL) {
-      uv__set_sys_error(loop, ENOMEM);
-      return -1;
-    }
-
-    if ((size = readlink(path, buf, size)) == -1) {
-      req->errorno = errno;
-      req->result = -1;
-      free(buf);
-    } else {
-      /* Cannot conceivably fail since it shrinks the buffer. */
-      buf = realloc(buf, size + 1);
-      buf[size] = '\0';
-      req->result = 0;
-      req->ptr = buf;
-    }
-
-    return req->result;
-  }
-
-  assert(0 && "unreachable");
+  POST;
 }
 
 
 int uv_fs_fchmod(uv_loop_t* loop, uv_fs_t* req, uv_file file, int mode,
     uv_fs_cb cb) {
-  char* path = NULL;
-  WRAP_EIO(UV_FS_FCHMOD, eio_fchmod, fchmod, ARGS2(file, mode))
+  uv_fs_req_init(loop, req, UV_FS_FCHMOD, NULL, cb);
+  req->file = file;
+  req->mode = mode;
+  POST;
 }
 
 
 int uv_fs_chown(uv_loop_t* loop, uv_fs_t* req, const char* path, int uid,
     int gid, uv_fs_cb cb) {
-  WRAP_EIO(UV_FS_CHOWN, eio_chown, chown, ARGS3(path, uid, gid))
+  uv_fs_req_init(loop, req, UV_FS_CHOWN, path, cb);
+  req->uid = uid;
+  req->gid = gid;
+  POST;
 }
 
 
 int uv_fs_fchown(uv_loop_t* loop, uv_fs_t* req, uv_file file, int uid, int gid,
     uv_fs_cb cb) {
-  char* path = NULL;
-  WRAP_EIO(UV_FS_FCHOWN, eio_fchown, fchown, ARGS3(file, uid, gid))
+  uv_fs_req_init(loop, req, UV_FS_FCHOWN, NULL, cb);
+  req->file = file;
+  req->uid = uid;
+  req->gid = gid;
+  POST;
 }
 
 
-static void uv__work(eio_req* eio) {
-  uv_work_t* req = eio->data;
+static void uv__work(struct uv__work* w) {
+  uv_work_t* req = container_of(w, uv_work_t, work_req);
   if (req->work_cb) {
     req->work_cb(req);
   }
 }
 
 
-static int uv__after_work(eio_req *eio) {
-  uv_work_t* req = eio->data;
+static void uv__after_work(struct uv__work* w, int status) {
+  uv_work_t* req = container_of(w, uv_work_t, work_req);
   uv_unref(req->loop);
+  if (status == UV_ECANCELED) {
+    uv__set_artificial_error(req->loop, UV_ECANCELED);
+  }
   if (req->after_work_cb) {
     req->after_work_cb(req);
   }
-  return 0;
 }
 
 
@@ -683,21 +682,16 @@ int uv_queue_work(uv_loop_t* loop, uv_work_t* req, uv_work_cb work_cb,
     uv_after_work_cb after_work_cb) {
   void* data = req->data;
 
-  uv_eio_init(loop);
-
   uv__req_init(loop, (uv_req_t*)req);
-  uv_ref(loop);
+  req->type = UV_WORK;
   req->loop = loop;
   req->data = data;
   req->work_cb = work_cb;
   req->after_work_cb = after_work_cb;
 
-  req->eio = eio_custom(uv__work, EIO_PRI_DEFAULT, uv__after_work, req,  &loop->uv_eio_channel);
-
-  if (!req->eio) {
-    uv__set_sys_error(loop, ENOMEM);
+  if (uv__work_submit(loop, &req->work_req, uv__work, uv__after_work))
     return -1;
-  }
 
+  uv_ref(loop);
   return 0;
 }
@@ -33,6 +33,7 @@
 
 #undef HAVE_FUTIMES
 #undef HAVE_KQUEUE
+#undef HAVE_EPOLL
 #undef HAVE_PORTS_FS
 
 #if defined(__linux__)
@@ -40,6 +41,11 @@
 # undef HAVE_SYS_UTIMESAT
 # undef HAVE_SYS_PIPE2
 # undef HAVE_SYS_ACCEPT4
+# undef HAVE_SYS_RECVMMSG
+# undef HAVE_SYS_SENDMMSG
+# undef HAVE_SYS_IO_URING
+# undef HAVE_SYS_SPLICE
+# undef HAVE_MSG_ZEROCOPY
 
 # undef _GNU_SOURCE
 # define _GNU_SOURCE
@@ -58,6 +64,22 @@
 # if __NR_accept4
 #  define HAVE_SYS_ACCEPT4 1
 # endif
+# if __NR_epoll_ctl
+#  define HAVE_EPOLL 1
+#  define HAVE_MSG_ZEROCOPY 1
+# endif
+# if __NR_recvmmsg
+#  define HAVE_SYS_RECVMMSG 1
+# endif
+# if __NR_sendmmsg
+#  define HAVE_SYS_SENDMMSG 1
+# endif
+# if __NR_io_uring_setup
+#  define HAVE_SYS_IO_URING 1
+# endif
+# if __NR_splice
+#  define HAVE_SYS_SPLICE 1
+# endif
 
 # ifndef O_CLOEXEC
 #  define O_CLOEXEC 02000000
@@ -108,6 +130,77 @@ inline static int sys_accept4(int fd,
 }
 # endif /* HAVE_SYS_ACCEPT4 */
 
+# if HAVE_SYS_RECVMMSG || HAVE_SYS_SENDMMSG
+#  include <sys/socket.h>
+
+/* Same layout as the kernel's struct mmsghdr, older libcs don't have it. */
+struct uv__mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int msg_len;
+};
+# endif
+
+# if HAVE_SYS_RECVMMSG
+inline static int sys_recvmmsg(int fd,
+                               struct uv__mmsghdr* mmsg,
+                               unsigned int vlen,
+                               unsigned int flags,
+                               struct timespec* timeout)
+{
+  return syscall(__NR_recvmmsg, fd, mmsg, vlen, flags, timeout);
+}
+# endif /* HAVE_SYS_RECVMMSG */
+
+# if HAVE_SYS_SENDMMSG
+inline static int sys_sendmmsg(int fd,
+                               struct uv__mmsghdr* mmsg,
+                               unsigned int vlen,
+                               unsigned int flags)
+{
+  return syscall(__NR_sendmmsg, fd, mmsg, vlen, flags);
+}
+# endif /* HAVE_SYS_SENDMMSG */
+
+# if HAVE_SYS_SPLICE
+#  define UV__SPLICE_F_MOVE      1
+#  define UV__SPLICE_F_NONBLOCK  2
+
+inline static ssize_t sys_splice(int fd_in,
+                                 int fd_out,
+                                 size_t len,
+                                 unsigned int flags)
+{
+  return syscall(__NR_splice, fd_in, NULL, fd_out, NULL, len, flags);
+}
+# endif /* HAVE_SYS_SPLICE */
+
+# if HAVE_SYS_IO_URING
+struct uv__io_uring_params;
+
+inline static int sys_io_uring_setup(unsigned int entries,
+                                     struct uv__io_uring_params* params)
+{
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+inline static int sys_io_uring_enter(int fd,
+                                     unsigned int to_submit,
+                                     unsigned int min_complete,
+                                     unsigned int flags)
+{
+  return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                 NULL, 0L);
+}
+
+inline static int sys_io_uring_register(int fd,
+                                        unsigned int opcode,
+                                        void* arg,
+                                        unsigned int nargs)
+{
+  return syscall(__NR_io_uring_register, fd, opcode, arg, nargs);
+}
+# endif /* HAVE_SYS_IO_URING */
+
 #endif /* __linux__ */
 
 #if defined(__sun)
@@ -151,9 +244,33 @@ enum {
   UV_READABLE      = 0x20,   /* The stream is readable */
   UV_WRITABLE      = 0x40,   /* The stream is writable */
   UV_TCP_NODELAY   = 0x080,  /* Disable Nagle. */
-  UV_TCP_KEEPALIVE = 0x100   /* Turn on keep-alive. */
+  UV_TCP_KEEPALIVE = 0x100,  /* Turn on keep-alive. */
+  UV_TIMER_ACTIVE  = 0x200,  /* Timer is queued in the loop's timer wheel. */
+  UV_READ_POOL     = 0x400,  /* uv_read_start_pool() called. */
+  UV_READ_PARKED   = 0x800,  /* Pooled read waits for a free buffer. */
+  UV_READ_SHORT    = 0x1000, /* Last read used under half of read_size. */
+  UV_ACCEPTED      = 0x2000, /* Opened by uv_accept(). */
+  UV_TCP_REUSEPORT = 0x4000, /* Share the port with other sockets. */
+  UV_EPOLL_REFUSED = 0x8000  /* Not pollable, libev watches the fd. */
 };
 
+/* FreeBSD's SO_REUSEPORT doesn't spread connections over the sockets,
+ * SO_REUSEPORT_LB does.
+ */
+#if defined(SO_REUSEPORT_LB)
+# define UV__SO_REUSEPORT SO_REUSEPORT_LB
+#elif defined(SO_REUSEPORT)
+# define UV__SO_REUSEPORT SO_REUSEPORT
+#endif
+
+/* Sockets returned by accept() start out with the listener's TCP_NODELAY
+ * and SO_KEEPALIVE settings.
+ */
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) || \
+    defined(__NetBSD__) || defined(__OpenBSD__)
+# define HAVE_ACCEPT_INHERIT 1
+#endif
+
 int uv__close(int fd);
 void uv__handle_init(uv_loop_t* loop, uv_handle_t* handle, uv_handle_type type);
 
@@ -162,6 +279,67 @@ int uv__nonblock(int fd, int set) __attribute__((unused));
 int uv__cloexec(int fd, int set) __attribute__((unused));
 int uv__socket(int domain, int type, int protocol);
 
+/* epoll */
+#if HAVE_EPOLL
+int uv__epoll_init(uv_loop_t* loop);
+void uv__epoll_destroy(uv_loop_t* loop);
+int uv__epoll_update(uv_loop_t* loop, uv_stream_t* stream, int fd,
+    int old_events, int new_events);
+#endif
+
+/* io_uring */
+#if HAVE_SYS_IO_URING
+int uv__iou_init(uv_loop_t* loop, int fs, int net);
+void uv__iou_destroy(uv_loop_t* loop);
+int uv__iou_fs_submit(uv_loop_t* loop, uv_fs_t* req,
+    void (*done)(struct uv__work* w, int status));
+int uv__iou_stream_init(uv_stream_t* stream);
+void uv__iou_stream_update(uv_stream_t* stream);
+void uv__iou_stream_close(uv_stream_t* stream);
+ssize_t uv__iou_read(uv_stream_t* stream, char* buf, size_t len);
+ssize_t uv__iou_read_buf(uv_stream_t* stream, uv_buf_t* buf);
+int uv__iou_buf_release(uv_loop_t* loop, char* base);
+int uv__iou_accept(uv_stream_t* stream);
+int uv__iou_readable(uv_stream_t* stream);
+int uv__iou_sending(uv_stream_t* stream);
+int uv__iou_sendmsg(uv_stream_t* stream, struct iovec* iov, int iovcnt);
+void uv__stream_iou_sent(uv_stream_t* stream, int res);
+#endif
+
+/* zero-copy writes */
+#if HAVE_MSG_ZEROCOPY
+int uv__zerocopy_set(uv_stream_t* stream, int enable, size_t threshold);
+int uv__zerocopy_open(uv_stream_t* stream);
+void uv__zerocopy_close(uv_stream_t* stream);
+void uv__zerocopy_destroy(uv_stream_t* stream);
+void uv__zerocopy_loop_delete(uv_loop_t* loop);
+int uv__zerocopy_wanted(uv_stream_t* stream, size_t size);
+ssize_t uv__zerocopy_send(uv_stream_t* stream, uv_write_t* req,
+    struct iovec* iov, int iovcnt);
+int uv__zerocopy_hold(uv_stream_t* stream, uv_write_t* req);
+#endif
+
+/* timer wheel */
+int uv__timer_wheel_init(uv_loop_t* loop);
+void uv__timer_wheel_destroy(uv_loop_t* loop);
+void uv__timer_wheel_start(uv_timer_t* timer, int64_t timeout);
+void uv__timer_wheel_stop(uv_timer_t* timer);
+
+/* metrics */
+void uv__metrics_loop_init(uv_loop_t* loop);
+void uv__metrics_run_end(uv_loop_t* loop);
+
+/* async */
+void uv__async_loop_init(uv_loop_t* loop);
+void uv__async_loop_delete(uv_loop_t* loop);
+
+/* thread pool */
+int uv__threadpool_loop_init(uv_loop_t* loop);
+void uv__threadpool_loop_delete(uv_loop_t* loop);
+int uv__work_submit(uv_loop_t* loop, struct uv__work* w,
+    void (*work)(struct uv__work* w),
+    void (*done)(struct uv__work* w, int status));
+
 /* error */
 uv_err_code uv_translate_sys_error(int sys_errno);
 void uv_fatal_error(const int errorno, const char* syscall);
@@ -174,8 +352,15 @@ void uv__stream_init(uv_loop_t* loop, uv_stream_t* stream,
     uv_handle_type type);
 int uv__stream_open(uv_stream_t*, int fd, int flags);
 void uv__stream_destroy(uv_stream_t* stream);
+void uv__stream_watcher_start(uv_stream_t* stream, ev_io* w);
+void uv__stream_watcher_stop(uv_stream_t* stream, ev_io* w);
 void uv__stream_io(EV_P_ ev_io* watcher, int revents);
 void uv__server_io(EV_P_ ev_io* watcher, int revents);
+void uv__read_pool_destroy(uv_loop_t* loop);
+
+/* splice */
+void uv__splice_close(uv_stream_t* stream);
+void uv__splice_drained(uv_splice_t* req);
 int uv__accept(int sockfd, struct sockaddr* saddr, socklen_t len);
 int uv__connect(uv_connect_t* req, uv_stream_t* stream, struct sockaddr* addr,
     socklen_t addrlen, uv_connect_cb cb);
@@ -197,6 +382,10 @@ void uv__udp_watcher_stop(uv_udp_t* handle, ev_io* w);
 /* fs */
 void uv__fs_event_destroy(uv_fs_event_t* handle);
 
+/* channel */
+void uv__channel_close(uv_channel_t* channel);
+void uv__channel_finish_close(uv_channel_t* channel);
+
 #define UV__F_IPC        (1 << 0)
 #define UV__F_NONBLOCK   (1 << 1)
 int uv__make_socketpair(int fds[2], int flags);
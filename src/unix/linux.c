@@ -30,8 +30,15 @@
 
 #include <ifaddrs.h>
 #include <net/if.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/sysinfo.h>
+#include <sys/sysmacros.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <time.h>
@@ -684,3 +691,1766 @@ void uv__fs_event_destroy(uv_fs_event_t* handle) {
 }
 
 #endif /* HAVE_INOTIFY_INIT || HAVE_INOTIFY_INIT1 */
+
+
+#if HAVE_EPOLL
+
+/* Streams on a UV_LOOP_EPOLL loop are registered in an epoll set of their
+ * own, one registration per file descriptor with the combined read/write
+ * interest mask. libev only watches the epoll fd itself. When it becomes
+ * readable, the ready events are read in bulk and dispatched straight to
+ * the stream's read and write callbacks.
+ *
+ * epoll refuses fds that can't be polled, regular files for one. Those
+ * streams are handed back to libev, which treats them as always ready.
+ */
+
+#define UV__EPOLL_EVENTS 1024
+
+
+static void uv__epoll_io(EV_P_ ev_io* w, int revents) {
+  struct epoll_event events[UV__EPOLL_EVENTS];
+  uv_stream_t* stream;
+  uv_loop_t* uv_loop;
+  int nfds;
+  int i;
+
+  uv_loop = w->data;
+  assert(w == &uv_loop->epoll_watcher);
+
+  do {
+    nfds = epoll_wait(uv_loop->epoll_fd, events, UV__EPOLL_EVENTS, 0);
+
+    if (nfds == -1) {
+      if (errno == EINTR)
+        continue;
+      uv_fatal_error(errno, "epoll_wait");
+    }
+
+    for (i = 0; i < nfds; i++) {
+      stream = events[i].data.ptr;
+
+      /* Callbacks may stop the watchers of streams that are still in
+       * the events array, check for that before each dispatch.
+       */
+      if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) &&
+          ev_is_active(&stream->read_watcher)) {
+        ev_cb(&stream->read_watcher)(EV_A, &stream->read_watcher, EV_READ);
+      }
+
+      if ((events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) &&
+          ev_is_active(&stream->write_watcher)) {
+        ev_cb(&stream->write_watcher)(EV_A, &stream->write_watcher, EV_WRITE);
+      }
+    }
+  }
+  while (nfds == UV__EPOLL_EVENTS);
+}
+
+
+int uv__epoll_init(uv_loop_t* loop) {
+  int fd;
+
+  fd = epoll_create(UV__EPOLL_EVENTS);
+  if (fd == -1)
+    return -1;
+
+  if (uv__cloexec(fd, 1)) {
+    uv__close(fd);
+    return -1;
+  }
+
+  loop->epoll_fd = fd;
+
+  ev_io_init(&loop->epoll_watcher, uv__epoll_io, fd, EV_READ);
+  loop->epoll_watcher.data = loop;
+  ev_io_start(loop->ev, &loop->epoll_watcher);
+  /* The streams keep the loop alive, not the epoll fd. */
+  ev_unref(loop->ev);
+
+  return 0;
+}
+
+
+void uv__epoll_destroy(uv_loop_t* loop) {
+  ev_ref(loop->ev);
+  ev_io_stop(loop->ev, &loop->epoll_watcher);
+  uv__close(loop->epoll_fd);
+  loop->epoll_fd = -1;
+}
+
+
+/* Returns -1 with errno set to EPERM when the fd can't be polled. */
+int uv__epoll_update(uv_loop_t* loop,
+                     uv_stream_t* stream,
+                     int fd,
+                     int old_events,
+                     int new_events) {
+  struct epoll_event e;
+  int op;
+
+  if (old_events == new_events)
+    return 0;
+
+  if (new_events == 0)
+    op = EPOLL_CTL_DEL;
+  else if (old_events == 0)
+    op = EPOLL_CTL_ADD;
+  else
+    op = EPOLL_CTL_MOD;
+
+  e.events = ((new_events & EV_READ) ? EPOLLIN : 0) |
+             ((new_events & EV_WRITE) ? EPOLLOUT : 0);
+  e.data.ptr = stream;
+
+  if (epoll_ctl(loop->epoll_fd, op, fd, &e) == 0)
+    return 0;
+
+  if (errno == EPERM && op == EPOLL_CTL_ADD)
+    return -1;
+
+  /* The fd was closed and reused or closed outright behind our back,
+   * fix up the registration.
+   */
+  if (errno == EEXIST && op == EPOLL_CTL_ADD) {
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &e) == 0)
+      return 0;
+  }
+  else if (errno == ENOENT && op == EPOLL_CTL_MOD) {
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &e) == 0)
+      return 0;
+  }
+  else if (op == EPOLL_CTL_DEL && (errno == ENOENT || errno == EBADF)) {
+    return 0;
+  }
+
+  uv_fatal_error(errno, "epoll_ctl");
+  return -1;
+}
+
+#endif /* HAVE_EPOLL */
+
+
+#if HAVE_MSG_ZEROCOPY
+
+/* Streams that called uv_tcp_zerocopy() send large writes with
+ * MSG_ZEROCOPY. The kernel numbers those sends and reports them on the
+ * socket's error queue once it no longer needs the buffers, the write
+ * callbacks are held back until then.
+ *
+ * The loop's zerocopy_fd is an epoll set that holds the sockets with
+ * EPOLLET and no other events, so it only wakes up the loop when a
+ * socket's error queue grows. libev watches the set like it watches the
+ * UV_LOOP_EPOLL one.
+ */
+
+#ifndef SO_ZEROCOPY
+# define SO_ZEROCOPY 60
+#endif
+
+#ifndef MSG_ZEROCOPY
+# define MSG_ZEROCOPY 0x4000000
+#endif
+
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+# define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+# define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+#define UV__ZEROCOPY_THRESHOLD (16 * 1024)
+#define UV__ZEROCOPY_EVENTS 64
+
+struct uv__zerocopy {
+  size_t threshold;       /* 0 when turned off. */
+  unsigned int next;      /* Number of the next MSG_ZEROCOPY send. */
+  int copied;             /* The kernel copied the data regardless. */
+  int registered;         /* In the loop's zerocopy_fd. */
+  ngx_queue_t queue;      /* Written requests held until released. */
+};
+
+
+/* Gives the pending count of each request in the queue a cut of the range
+ * of released sends. The numbers wrap around.
+ */
+static void uv__zerocopy_release_queue(ngx_queue_t* queue,
+                                       unsigned int lo,
+                                       unsigned int hi) {
+  unsigned int first;
+  unsigned int last;
+  ngx_queue_t* q;
+  uv_write_t* req;
+
+  ngx_queue_foreach(q, queue) {
+    req = ngx_queue_data(q, uv_write_t, queue);
+
+    if (req->zerocopy_pending == 0)
+      continue;
+
+    first = req->zerocopy_first;
+    last = first + req->zerocopy_sends - 1;
+
+    if ((int) (lo - first) > 0)
+      first = lo;
+    if ((int) (hi - last) < 0)
+      last = hi;
+
+    if ((int) (last - first) >= 0)
+      req->zerocopy_pending -= last - first + 1;
+  }
+}
+
+
+/* The request that's still being written may have sends released too. */
+static void uv__zerocopy_release(uv_stream_t* stream,
+                                 unsigned int lo,
+                                 unsigned int hi) {
+  uv__zerocopy_release_queue(&stream->zerocopy->queue, lo, hi);
+  uv__zerocopy_release_queue(&stream->write_queue, lo, hi);
+}
+
+
+/* Reads the notifications off the error queue. */
+static void uv__zerocopy_recverr(uv_stream_t* stream) {
+  struct uv__zerocopy* zc = stream->zerocopy;
+  struct sock_extended_err* serr;
+  struct cmsghdr* cmsg;
+  struct msghdr msg;
+  char control[128];
+  ssize_t n;
+
+  for (;;) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    do
+      n = recvmsg(stream->fd, &msg, MSG_ERRQUEUE);
+    while (n == -1 && errno == EINTR);
+
+    if (n == -1)
+      break;
+
+    for (cmsg = CMSG_FIRSTHDR(&msg);
+         cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+        continue;
+
+      serr = (struct sock_extended_err*) CMSG_DATA(cmsg);
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
+
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        zc->copied = 1;
+
+      uv__zerocopy_release(stream, serr->ee_info, serr->ee_data);
+    }
+  }
+}
+
+
+/* Completes the held requests at the front of the queue that have nothing
+ * pending anymore.
+ */
+static void uv__zerocopy_reap(uv_stream_t* stream) {
+  struct uv__zerocopy* zc = stream->zerocopy;
+  uv_write_t* req;
+  ngx_queue_t* q;
+
+  uv__zerocopy_recverr(stream);
+
+  while (!ngx_queue_empty(&zc->queue)) {
+    q = ngx_queue_head(&zc->queue);
+    req = ngx_queue_data(q, uv_write_t, queue);
+
+    if (req->zerocopy_pending != 0)
+      break;
+
+    ngx_queue_remove(q);
+    ngx_queue_insert_tail(&stream->write_completed_queue, q);
+    ev_feed_event(stream->loop->ev, &stream->write_watcher, EV_WRITE);
+
+    if (ngx_queue_empty(&zc->queue))
+      ev_unref(stream->loop->ev);
+  }
+}
+
+
+static void uv__zerocopy_io(EV_P_ ev_io* w, int revents) {
+  struct epoll_event events[UV__ZEROCOPY_EVENTS];
+  uv_stream_t* stream;
+  uv_loop_t* uv_loop;
+  int nfds;
+  int i;
+
+  uv_loop = w->data;
+  assert(w == &uv_loop->zerocopy_watcher);
+
+  do {
+    nfds = epoll_wait(uv_loop->zerocopy_fd, events, UV__ZEROCOPY_EVENTS, 0);
+
+    if (nfds == -1) {
+      if (errno == EINTR)
+        continue;
+      uv_fatal_error(errno, "epoll_wait");
+    }
+
+    for (i = 0; i < nfds; i++) {
+      stream = events[i].data.ptr;
+
+      if (!(stream->flags & UV_CLOSING))
+        uv__zerocopy_reap(stream);
+    }
+  }
+  while (nfds == UV__ZEROCOPY_EVENTS);
+}
+
+
+static int uv__zerocopy_loop_init(uv_loop_t* loop) {
+  int fd;
+
+  fd = epoll_create(UV__ZEROCOPY_EVENTS);
+  if (fd == -1)
+    return -1;
+
+  if (uv__cloexec(fd, 1)) {
+    uv__close(fd);
+    return -1;
+  }
+
+  loop->zerocopy_fd = fd;
+
+  ev_io_init(&loop->zerocopy_watcher, uv__zerocopy_io, fd, EV_READ);
+  loop->zerocopy_watcher.data = loop;
+  ev_io_start(loop->ev, &loop->zerocopy_watcher);
+  /* Held write requests keep the loop alive, not the epoll fd. */
+  ev_unref(loop->ev);
+
+  return 0;
+}
+
+
+void uv__zerocopy_loop_delete(uv_loop_t* loop) {
+  ev_ref(loop->ev);
+  ev_io_stop(loop->ev, &loop->zerocopy_watcher);
+  uv__close(loop->zerocopy_fd);
+  loop->zerocopy_fd = -1;
+}
+
+
+/* Turns on SO_ZEROCOPY for the stream's socket and adds it to the loop's
+ * zerocopy_fd. Called once the stream has a socket.
+ */
+int uv__zerocopy_open(uv_stream_t* stream) {
+  struct uv__zerocopy* zc = stream->zerocopy;
+  uv_loop_t* loop = stream->loop;
+  struct epoll_event e;
+  int yes;
+
+  assert(stream->fd != -1);
+
+  if (zc->registered)
+    return 0;
+
+  yes = 1;
+  if (setsockopt(stream->fd, SOL_SOCKET, SO_ZEROCOPY, &yes, sizeof yes)) {
+    if (errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+      uv__set_artificial_error(loop, UV_ENOTSUP);
+    else
+      uv__set_sys_error(loop, errno);
+    return -1;
+  }
+
+  if (loop->zerocopy_fd == -1 && uv__zerocopy_loop_init(loop)) {
+    uv__set_sys_error(loop, errno);
+    return -1;
+  }
+
+  e.events = EPOLLET;
+  e.data.ptr = stream;
+
+  if (epoll_ctl(loop->zerocopy_fd, EPOLL_CTL_ADD, stream->fd, &e)) {
+    uv__set_sys_error(loop, errno);
+    return -1;
+  }
+
+  zc->registered = 1;
+  return 0;
+}
+
+
+int uv__zerocopy_set(uv_stream_t* stream, int enable, size_t threshold) {
+  struct uv__zerocopy* zc = stream->zerocopy;
+
+  if (!enable) {
+    if (zc != NULL)
+      zc->threshold = 0;
+    return 0;
+  }
+
+  if (zc == NULL) {
+    zc = malloc(sizeof(*zc));
+    if (zc == NULL) {
+      uv__set_sys_error(stream->loop, ENOMEM);
+      return -1;
+    }
+
+    zc->threshold = 0;
+    zc->next = 0;
+    zc->copied = 0;
+    zc->registered = 0;
+    ngx_queue_init(&zc->queue);
+    stream->zerocopy = zc;
+  }
+
+  if (stream->fd != -1 && uv__zerocopy_open(stream))
+    return -1;
+
+  zc->threshold = threshold ? threshold : UV__ZEROCOPY_THRESHOLD;
+  return 0;
+}
+
+
+/* Before the socket is closed. Picks up the notifications that arrived
+ * since the last wakeup, they can't be read once the socket is gone.
+ */
+void uv__zerocopy_close(uv_stream_t* stream) {
+  struct uv__zerocopy* zc = stream->zerocopy;
+
+  if (zc->registered) {
+    uv__zerocopy_recverr(stream);
+    epoll_ctl(stream->loop->zerocopy_fd, EPOLL_CTL_DEL, stream->fd, NULL);
+    zc->registered = 0;
+  }
+}
+
+
+/* The notifications for the held requests won't come anymore, complete
+ * them. Requests the kernel may still be sending from fail with
+ * UV_ECANCELED, it holds on to their pages but sends whatever is in them.
+ */
+void uv__zerocopy_destroy(uv_stream_t* stream) {
+  struct uv__zerocopy* zc = stream->zerocopy;
+  uv_write_t* req;
+  ngx_queue_t* q;
+
+  ngx_queue_foreach(q, &zc->queue) {
+    req = ngx_queue_data(q, uv_write_t, queue);
+    if (req->zerocopy_pending != 0 && req->error == 0)
+      req->error = ECANCELED;
+  }
+
+  if (!ngx_queue_empty(&zc->queue)) {
+    ngx_queue_add(&stream->write_completed_queue, &zc->queue);
+    ngx_queue_init(&zc->queue);
+    ev_unref(stream->loop->ev);
+  }
+
+  free(zc);
+  stream->zerocopy = NULL;
+}
+
+
+int uv__zerocopy_wanted(uv_stream_t* stream, size_t size) {
+  struct uv__zerocopy* zc = stream->zerocopy;
+  return zc->registered &&
+         !zc->copied &&
+         zc->threshold != 0 &&
+         size >= zc->threshold;
+}
+
+
+ssize_t uv__zerocopy_send(uv_stream_t* stream,
+                          uv_write_t* req,
+                          struct iovec* iov,
+                          int iovcnt) {
+  struct uv__zerocopy* zc = stream->zerocopy;
+  struct msghdr msg;
+  ssize_t n;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+
+  do {
+    stream->loop->counters.write_syscalls++;
+    n = sendmsg(stream->fd, &msg, MSG_ZEROCOPY);
+  }
+  while (n == -1 && errno == EINTR);
+
+  /* Out of option memory for the notification, copy this one. */
+  if (n == -1 && errno == ENOBUFS) {
+    do {
+      stream->loop->counters.write_syscalls++;
+      n = writev(stream->fd, iov, iovcnt);
+    }
+    while (n == -1 && errno == EINTR);
+    return n;
+  }
+
+  if (n == -1)
+    return n;
+
+  if (req->zerocopy_sends == 0)
+    req->zerocopy_first = zc->next;
+
+  req->zerocopy_sends++;
+  req->zerocopy_pending++;
+  zc->next++;
+
+  return n;
+}
+
+
+/* Called for each finished request. Requests that still have their
+ * buffers lent to the kernel, and the ones behind them to keep the
+ * callbacks in order, wait in the stream's zero-copy queue.
+ */
+int uv__zerocopy_hold(uv_stream_t* stream, uv_write_t* req) {
+  struct uv__zerocopy* zc = stream->zerocopy;
+
+  if (req->zerocopy_pending == 0 && ngx_queue_empty(&zc->queue))
+    return 0;
+
+  if (ngx_queue_empty(&zc->queue))
+    ev_ref(stream->loop->ev);
+
+  ngx_queue_insert_tail(&zc->queue, &req->queue);
+  return 1;
+}
+
+#endif /* HAVE_MSG_ZEROCOPY */
+
+
+#if HAVE_SYS_IO_URING
+
+/* Loops created with UV_LOOP_IO_URING or UV_LOOP_IO_URING_NET own an
+ * io_uring. New entries are queued in the submission ring and handed to the
+ * kernel in one io_uring_enter() call right before the loop blocks, or
+ * earlier when the ring fills up. libev watches the ring fd, it becomes
+ * readable when there are completions to reap.
+ *
+ * Async fs requests complete straight from the reaper. Streams get a
+ * multishot recv or accept that stays armed while the stream's read watcher
+ * is active. Received data lands in a ring of buffers that's provided to the
+ * kernel by the loop; the completions are stashed per stream and the read
+ * watcher is fed an event so that uv__read() and uv__server_io() pick them
+ * up through uv__iou_read() and uv__iou_accept(). Writes that don't go out
+ * right away are finished with a sendmsg op instead of waiting for the
+ * socket to become writable.
+ *
+ * The structs and constants below mirror <linux/io_uring.h>, which isn't
+ * available everywhere that the syscalls are.
+ */
+
+#define UV__IOU_ENTRIES 256
+
+#define UV__IOU_NBUFS   256   /* Power of two. */
+#define UV__IOU_BUFSIZE 16384
+
+/* Low bits of the user_data of stream ops, fs requests have them clear. */
+#define UV__IOU_OP_RECV 1
+#define UV__IOU_OP_SEND 2
+#define UV__IOU_OP_MASK 7
+
+#define UV__IORING_OP_FSYNC        3
+#define UV__IORING_OP_SENDMSG      9
+#define UV__IORING_OP_ACCEPT       13
+#define UV__IORING_OP_ASYNC_CANCEL 14
+#define UV__IORING_OP_OPENAT       18
+#define UV__IORING_OP_CLOSE        19
+#define UV__IORING_OP_STATX        21
+#define UV__IORING_OP_READ         22
+#define UV__IORING_OP_WRITE        23
+#define UV__IORING_OP_RECV         27
+
+#define UV__IOSQE_BUFFER_SELECT 32
+
+#define UV__IORING_FSYNC_DATASYNC   1
+#define UV__IORING_ACCEPT_MULTISHOT 1
+#define UV__IORING_RECV_MULTISHOT   2
+
+#define UV__IORING_CQE_F_BUFFER 1
+#define UV__IORING_CQE_F_MORE   2
+
+#define UV__IORING_SQ_CQ_OVERFLOW 2
+
+#define UV__IORING_ENTER_GETEVENTS 1
+
+#define UV__IORING_REGISTER_PBUF_RING 22
+
+#define UV__IORING_FEAT_SINGLE_MMAP 1
+#define UV__IORING_FEAT_NODROP      2
+#define UV__IORING_FEAT_RW_CUR_POS  8
+#define UV__IORING_FEAT_LINKED_FILE 4096
+
+#define UV__IORING_OFF_SQ_RING 0
+#define UV__IORING_OFF_SQES    0x10000000
+
+#define UV__STATX_BASIC_STATS 0x7ff
+
+
+struct uv__io_sqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t flags;
+  uint32_t dropped;
+  uint32_t array;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+
+struct uv__io_cqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t overflow;
+  uint32_t cqes;
+  uint32_t flags;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+
+struct uv__io_uring_params {
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+  uint32_t wq_fd;
+  uint32_t reserved[3];
+  struct uv__io_sqring_offsets sq_off;
+  struct uv__io_cqring_offsets cq_off;
+};
+
+
+struct uv__io_uring_sqe {
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;   /* Also the multishot flags. */
+  int32_t fd;
+  uint64_t off;      /* Also the statx buffer. */
+  uint64_t addr;
+  uint32_t len;
+  uint32_t rw_flags; /* Also the open, fsync, statx, accept and msg flags. */
+  uint64_t user_data;
+  uint16_t buf_group;
+  uint16_t personality;
+  int32_t splice_fd_in;
+  uint64_t reserved[2];
+};
+
+
+struct uv__io_uring_cqe {
+  uint64_t user_data;
+  int32_t res;
+  uint32_t flags;
+};
+
+
+struct uv__io_uring_buf {
+  uint64_t addr;
+  uint32_t len;
+  uint16_t bid;
+  uint16_t tail; /* Only used in the first entry, it's the ring's tail. */
+};
+
+
+struct uv__io_uring_buf_reg {
+  uint64_t ring_addr;
+  uint32_t ring_entries;
+  uint16_t bgid;
+  uint16_t flags;
+  uint64_t reserved[3];
+};
+
+
+struct uv__statx_timestamp {
+  int64_t tv_sec;
+  uint32_t tv_nsec;
+  int32_t reserved;
+};
+
+
+struct uv__statx {
+  uint32_t stx_mask;
+  uint32_t stx_blksize;
+  uint64_t stx_attributes;
+  uint32_t stx_nlink;
+  uint32_t stx_uid;
+  uint32_t stx_gid;
+  uint16_t stx_mode;
+  uint16_t reserved0;
+  uint64_t stx_ino;
+  uint64_t stx_size;
+  uint64_t stx_blocks;
+  uint64_t stx_attributes_mask;
+  struct uv__statx_timestamp stx_atime;
+  struct uv__statx_timestamp stx_btime;
+  struct uv__statx_timestamp stx_ctime;
+  struct uv__statx_timestamp stx_mtime;
+  uint32_t stx_rdev_major;
+  uint32_t stx_rdev_minor;
+  uint32_t stx_dev_major;
+  uint32_t stx_dev_minor;
+  uint64_t reserved1[14];
+};
+
+
+struct uv__iou {
+  int fd;
+  int fs;  /* Submit fs requests. */
+  int net; /* Submit stream I/O. */
+  void* ring;
+  size_t ringsize;
+  struct uv__io_uring_sqe* sqes;
+  size_t sqessize;
+  uint32_t* sqtail;
+  uint32_t* sqflags;
+  uint32_t sqmask;
+  uint32_t* cqhead;
+  uint32_t* cqtail;
+  uint32_t cqmask;
+  struct uv__io_uring_cqe* cqes;
+  unsigned int entries;
+  unsigned int npending; /* Queued but not yet handed to the kernel. */
+  struct uv__io_uring_buf* bufring;
+  char* bufs;
+  uint16_t buftail;
+  ngx_queue_t streams; /* All uv__iou_stream structs. */
+  ngx_queue_t retry;   /* Streams that couldn't get a submission entry. */
+  ngx_queue_t starved; /* Streams whose recv ran out of buffers. */
+  ev_io io_watcher;
+  ev_prepare submit_watcher;
+};
+
+
+/* A received buffer (res > 0), an accepted fd (res >= 0), EOF (res == 0)
+ * or an error (res < 0) that hasn't been handed to the user yet.
+ */
+struct uv__iou_item {
+  int res;
+  int bid;
+};
+
+
+/*
+ * Ring state of a stream. It outlives the stream when ops are still in
+ * flight at close time and is freed when the last one completes.
+ */
+struct uv__iou_stream {
+  uv_stream_t* stream; /* NULL once the stream is closed. */
+  int accept;          /* Multishot accept instead of recv. */
+  int armed;           /* Multishot op in flight. */
+  int cancelled;       /* Multishot op is being cancelled. */
+  int done;            /* Recv ended with EOF or an error. */
+  int sending;
+  int send_cancelled;
+  uv_stream_t* closing; /* Closed while sending, waits for the send. */
+  int queued;          /* On the retry queue. */
+  int starved;         /* On the starved queue. */
+  unsigned int nops;
+  struct msghdr msg;
+  struct uv__iou_item* items;
+  unsigned int head;
+  unsigned int nitems;
+  unsigned int itemcap;
+  size_t off;          /* Bytes of the head buffer that were read. */
+  ngx_queue_t member;
+  ngx_queue_t retry;
+  ngx_queue_t starve;
+};
+
+
+static void uv__iou_flush(struct uv__iou* iou) {
+  int r;
+
+  while (iou->npending > 0) {
+    r = sys_io_uring_enter(iou->fd, iou->npending, 0, 0);
+
+    if (r == -1) {
+      if (errno == EINTR)
+        continue;
+      /* Out of kernel resources, try again on the next loop iteration. */
+      if (errno == EAGAIN || errno == EBUSY)
+        break;
+      uv_fatal_error(errno, "io_uring_enter");
+    }
+
+    iou->npending -= r;
+  }
+}
+
+
+/* Returns a cleared submission entry or NULL when the ring is full. It's
+ * not handed to the kernel until it's committed with uv__iou_commit().
+ */
+static struct uv__io_uring_sqe* uv__iou_get_sqe(struct uv__iou* iou,
+                                                uint64_t user_data) {
+  struct uv__io_uring_sqe* sqe;
+
+  if (iou->npending == iou->entries) {
+    uv__iou_flush(iou);
+
+    if (iou->npending == iou->entries)
+      return NULL;
+  }
+
+  sqe = iou->sqes + (*iou->sqtail & iou->sqmask);
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = user_data;
+
+  return sqe;
+}
+
+
+static void uv__iou_commit(struct uv__iou* iou) {
+  __atomic_store_n(iou->sqtail, *iou->sqtail + 1, __ATOMIC_RELEASE);
+  iou->npending++;
+}
+
+
+static void uv__iou_buf_recycle(struct uv__iou* iou, int bid) {
+  struct uv__io_uring_buf* buf;
+  struct uv__iou_stream* s;
+  ngx_queue_t* q;
+
+  buf = iou->bufring + (iou->buftail & (UV__IOU_NBUFS - 1));
+  buf->addr = (uintptr_t) (iou->bufs + bid * UV__IOU_BUFSIZE);
+  buf->len = UV__IOU_BUFSIZE;
+  buf->bid = bid;
+
+  iou->buftail++;
+  __atomic_store_n(&iou->bufring[0].tail, iou->buftail, __ATOMIC_RELEASE);
+
+  /* Rearm the recvs that ran dry before the loop blocks. */
+  while (!ngx_queue_empty(&iou->starved)) {
+    q = ngx_queue_head(&iou->starved);
+    s = ngx_queue_data(q, struct uv__iou_stream, starve);
+    ngx_queue_remove(q);
+    s->starved = 0;
+
+    if (!s->queued) {
+      ngx_queue_insert_tail(&iou->retry, &s->retry);
+      s->queued = 1;
+    }
+  }
+}
+
+
+static void uv__iou_statx_to_stat(const struct uv__statx* stx,
+                                  struct stat* st) {
+  memset(st, 0, sizeof(*st));
+  st->st_dev = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+  st->st_ino = stx->stx_ino;
+  st->st_mode = stx->stx_mode;
+  st->st_nlink = stx->stx_nlink;
+  st->st_uid = stx->stx_uid;
+  st->st_gid = stx->stx_gid;
+  st->st_rdev = makedev(stx->stx_rdev_major, stx->stx_rdev_minor);
+  st->st_size = stx->stx_size;
+  st->st_blksize = stx->stx_blksize;
+  st->st_blocks = stx->stx_blocks;
+  st->st_atim.tv_sec = stx->stx_atime.tv_sec;
+  st->st_atim.tv_nsec = stx->stx_atime.tv_nsec;
+  st->st_mtim.tv_sec = stx->stx_mtime.tv_sec;
+  st->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+  st->st_ctim.tv_sec = stx->stx_ctime.tv_sec;
+  st->st_ctim.tv_nsec = stx->stx_ctime.tv_nsec;
+}
+
+
+static void uv__iou_fs_complete(uv_fs_t* req, int res) {
+  struct uv__statx* stx;
+
+  stx = req->work_ptr;
+  req->work_ptr = NULL;
+
+  if (res < 0) {
+    req->work_result = -1;
+    req->work_errno = -res;
+  } else {
+    req->work_result = res;
+    req->work_errno = 0;
+  }
+
+  if (stx) {
+    if (res == 0) {
+      uv__iou_statx_to_stat(stx, &req->statbuf);
+      req->work_ptr = &req->statbuf;
+    }
+    free(stx);
+  }
+
+  req->work_req.done(&req->work_req, 0);
+}
+
+
+static void uv__iou_stream_free(struct uv__iou* iou, struct uv__iou_stream* s) {
+  assert(s->stream == NULL);
+  assert(s->nops == 0);
+
+  if (s->queued) {
+    ngx_queue_remove(&s->retry);
+  }
+
+  if (s->starved) {
+    ngx_queue_remove(&s->starve);
+  }
+
+  ngx_queue_remove(&s->member);
+  free(s->items);
+  free(s);
+}
+
+
+/*
+ * Brings the ops in flight in line with what the stream wants: a multishot
+ * recv or accept while its read watcher is active, nothing once it's
+ * closed. Streams that can't get a submission entry are retried before the
+ * loop blocks.
+ */
+static void uv__iou_stream_sync(uv_loop_t* loop, struct uv__iou_stream* s) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+  uv_stream_t* stream;
+  int want;
+
+  iou = loop->iou;
+  stream = s->stream;
+
+  want = stream != NULL &&
+         stream->fd != -1 &&
+         ev_is_active(&stream->read_watcher) &&
+         (s->accept || (stream->flags & UV_READING)) &&
+         !s->done;
+
+  if (want && !s->armed && !s->starved) {
+    sqe = uv__iou_get_sqe(iou, (uintptr_t) s | UV__IOU_OP_RECV);
+    if (sqe == NULL)
+      goto retry;
+
+    sqe->fd = stream->fd;
+
+    if (s->accept) {
+      sqe->opcode = UV__IORING_OP_ACCEPT;
+      sqe->ioprio = UV__IORING_ACCEPT_MULTISHOT;
+      sqe->rw_flags = SOCK_CLOEXEC | SOCK_NONBLOCK;
+    } else {
+      sqe->opcode = UV__IORING_OP_RECV;
+      sqe->ioprio = UV__IORING_RECV_MULTISHOT;
+      sqe->flags = UV__IOSQE_BUFFER_SELECT;
+      sqe->buf_group = 0;
+    }
+
+    uv__iou_commit(iou);
+    s->armed = 1;
+    s->cancelled = 0;
+    s->nops++;
+  }
+
+  if (!want && s->armed && !s->cancelled) {
+    sqe = uv__iou_get_sqe(iou, 0);
+    if (sqe == NULL)
+      goto retry;
+
+    sqe->opcode = UV__IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uintptr_t) s | UV__IOU_OP_RECV;
+    uv__iou_commit(iou);
+    s->cancelled = 1;
+  }
+
+  if (stream == NULL && s->sending && !s->send_cancelled) {
+    sqe = uv__iou_get_sqe(iou, 0);
+    if (sqe == NULL)
+      goto retry;
+
+    sqe->opcode = UV__IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uintptr_t) s | UV__IOU_OP_SEND;
+    uv__iou_commit(iou);
+    s->send_cancelled = 1;
+  }
+
+  if (s->queued) {
+    ngx_queue_remove(&s->retry);
+    s->queued = 0;
+  }
+
+  return;
+
+retry:
+  if (!s->queued) {
+    ngx_queue_insert_tail(&iou->retry, &s->retry);
+    s->queued = 1;
+  }
+}
+
+
+static void uv__iou_stash(struct uv__iou_stream* s, int res, int bid) {
+  struct uv__iou_item* items;
+  unsigned int cap;
+
+  if (s->head > 0 && s->head == s->nitems) {
+    s->head = 0;
+    s->nitems = 0;
+  }
+
+  if (s->nitems == s->itemcap) {
+    if (s->head > 0) {
+      memmove(s->items,
+              s->items + s->head,
+              (s->nitems - s->head) * sizeof(s->items[0]));
+      s->nitems -= s->head;
+      s->head = 0;
+    } else {
+      cap = s->itemcap ? 2 * s->itemcap : 16;
+      items = realloc(s->items, cap * sizeof(s->items[0]));
+      if (items == NULL)
+        uv_fatal_error(ENOMEM, "realloc");
+      s->items = items;
+      s->itemcap = cap;
+    }
+  }
+
+  s->items[s->nitems].res = res;
+  s->items[s->nitems].bid = bid;
+  s->nitems++;
+}
+
+
+static void uv__iou_stream_complete(uv_loop_t* loop,
+                                    struct uv__io_uring_cqe* cqe) {
+  struct uv__iou_stream* s;
+  struct uv__iou* iou;
+  uv_stream_t* stream;
+  int bid;
+
+  iou = loop->iou;
+  s = (struct uv__iou_stream*) (uintptr_t) (cqe->user_data & ~UV__IOU_OP_MASK);
+  stream = s->stream;
+
+  if ((cqe->user_data & UV__IOU_OP_MASK) == UV__IOU_OP_SEND) {
+    s->sending = 0;
+    s->nops--;
+
+    /* Balances the ref that uv__iou_sendmsg() took. */
+    ev_unref(loop->ev);
+
+    /* The kernel is done with the buffers, uv__stream_iou_sent() completes
+     * the write request and lets the close go ahead.
+     */
+    if (stream == NULL) {
+      stream = s->closing;
+      s->closing = NULL;
+      stream->iou = NULL;
+
+      if (s->nops == 0)
+        uv__iou_stream_free(iou, s);
+    }
+
+    uv__stream_iou_sent(stream, cqe->res);
+    return;
+  }
+
+  bid = (cqe->flags & UV__IORING_CQE_F_BUFFER) ? (int) (cqe->flags >> 16) : -1;
+
+  if ((cqe->flags & UV__IORING_CQE_F_MORE) == 0) {
+    s->armed = 0;
+    s->nops--;
+  }
+
+  if (stream == NULL) {
+    if (bid != -1)
+      uv__iou_buf_recycle(iou, bid);
+    else if (s->accept && cqe->res >= 0)
+      uv__close(cqe->res);
+
+    if (s->nops == 0)
+      uv__iou_stream_free(iou, s);
+    return;
+  }
+
+  /* Rearming right away when out of buffers would just spin, the recv
+   * waits until one is recycled. Cancelled ops are rearmed if need be.
+   */
+  if (cqe->res == -ENOBUFS) {
+    if (!s->starved) {
+      ngx_queue_insert_tail(&iou->starved, &s->starve);
+      s->starved = 1;
+    }
+  } else if (cqe->res != -ECANCELED) {
+    uv__iou_stash(s, cqe->res, bid);
+
+    if (!s->accept && cqe->res <= 0)
+      s->done = 1;
+  }
+
+  uv__iou_stream_sync(loop, s);
+
+  if (s->head != s->nitems && ev_is_active(&stream->read_watcher))
+    ev_feed_event(loop->ev, &stream->read_watcher, EV_READ);
+}
+
+
+static void uv__iou_reap(EV_P_ ev_io* w, int revents) {
+  struct uv__io_uring_cqe cqe;
+  struct uv__iou* iou;
+  uv_loop_t* uv_loop;
+  uint32_t head;
+  uint32_t tail;
+
+  uv_loop = w->data;
+  iou = uv_loop->iou;
+
+  for (;;) {
+    head = *iou->cqhead;
+    tail = __atomic_load_n(iou->cqtail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+      /* Hand the slot back before the callback, it may submit new work. */
+      cqe = iou->cqes[head & iou->cqmask];
+      head++;
+      __atomic_store_n(iou->cqhead, head, __ATOMIC_RELEASE);
+
+      if (cqe.user_data & UV__IOU_OP_MASK)
+        uv__iou_stream_complete(uv_loop, &cqe);
+      else if (cqe.user_data != 0)
+        uv__iou_fs_complete((uv_fs_t*) (uintptr_t) cqe.user_data, cqe.res);
+
+      if (head == tail)
+        tail = __atomic_load_n(iou->cqtail, __ATOMIC_ACQUIRE);
+    }
+
+    /* Completions that didn't fit in the ring are parked in the kernel,
+     * have it move them over.
+     */
+    if ((__atomic_load_n(iou->sqflags, __ATOMIC_ACQUIRE) &
+         UV__IORING_SQ_CQ_OVERFLOW) == 0) {
+      break;
+    }
+
+    if (sys_io_uring_enter(iou->fd, 0, 0, UV__IORING_ENTER_GETEVENTS) == -1 &&
+        errno != EINTR &&
+        errno != EAGAIN &&
+        errno != EBUSY) {
+      uv_fatal_error(errno, "io_uring_enter");
+    }
+  }
+}
+
+
+static void uv__iou_submit(EV_P_ ev_prepare* w, int revents) {
+  struct uv__iou_stream* s;
+  struct uv__iou* iou;
+  uv_loop_t* uv_loop;
+  ngx_queue_t* q;
+
+  uv_loop = w->data;
+  iou = uv_loop->iou;
+
+  /* Streams that dropped off the queue again stay off. */
+  while (!ngx_queue_empty(&iou->retry)) {
+    q = ngx_queue_head(&iou->retry);
+    s = ngx_queue_data(q, struct uv__iou_stream, retry);
+    uv__iou_stream_sync(uv_loop, s);
+
+    if (s->queued)
+      break;
+  }
+
+  uv__iou_flush(iou);
+}
+
+
+static int uv__iou_init_bufs(struct uv__iou* iou) {
+  struct uv__io_uring_buf_reg reg;
+  size_t size;
+  int i;
+
+  size = UV__IOU_NBUFS * sizeof(struct uv__io_uring_buf);
+
+  /* The kernel wants the ring page aligned. */
+  iou->bufring = mmap(NULL,
+                      size,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1,
+                      0);
+  if (iou->bufring == MAP_FAILED)
+    goto err;
+
+  if ((iou->bufs = malloc(UV__IOU_NBUFS * UV__IOU_BUFSIZE)) == NULL)
+    goto err_unmap;
+
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uintptr_t) iou->bufring;
+  reg.ring_entries = UV__IOU_NBUFS;
+  reg.bgid = 0;
+
+  if (sys_io_uring_register(iou->fd, UV__IORING_REGISTER_PBUF_RING, &reg, 1))
+    goto err_free;
+
+  for (i = 0; i < UV__IOU_NBUFS; i++)
+    uv__iou_buf_recycle(iou, i);
+
+  return 0;
+
+err_free:
+  free(iou->bufs);
+err_unmap:
+  munmap(iou->bufring, size);
+err:
+  iou->bufring = NULL;
+  iou->bufs = NULL;
+  return -1;
+}
+
+
+int uv__iou_init(uv_loop_t* loop, int fs, int net) {
+  struct uv__io_uring_params params;
+  struct uv__iou* iou;
+  char* ring;
+  uint32_t* sqarray;
+  size_t sqsize;
+  size_t cqsize;
+  unsigned int i;
+  int fd;
+
+  memset(&params, 0, sizeof(params));
+
+  fd = sys_io_uring_setup(UV__IOU_ENTRIES, &params);
+  if (fd == -1)
+    return -1;
+
+  /* RW_CUR_POS came with the open, close, statx, read and write ops. */
+  if ((params.features & UV__IORING_FEAT_SINGLE_MMAP) == 0 ||
+      (params.features & UV__IORING_FEAT_NODROP) == 0 ||
+      (params.features & UV__IORING_FEAT_RW_CUR_POS) == 0) {
+    uv__close(fd);
+    errno = ENOSYS;
+    return -1;
+  }
+
+  /* There's no flag for multishot recv, LINKED_FILE came in the same
+   * release.
+   */
+  if ((params.features & UV__IORING_FEAT_LINKED_FILE) == 0)
+    net = 0;
+
+  if ((iou = calloc(1, sizeof(*iou))) == NULL) {
+    uv__close(fd);
+    errno = ENOMEM;
+    return -1;
+  }
+
+  sqsize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cqsize = params.cq_off.cqes +
+           params.cq_entries * sizeof(struct uv__io_uring_cqe);
+
+  iou->fd = fd;
+  iou->ringsize = sqsize > cqsize ? sqsize : cqsize;
+  iou->sqessize = params.sq_entries * sizeof(struct uv__io_uring_sqe);
+
+  iou->ring = mmap(NULL,
+                   iou->ringsize,
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE,
+                   fd,
+                   UV__IORING_OFF_SQ_RING);
+  if (iou->ring == MAP_FAILED)
+    goto err;
+
+  iou->sqes = mmap(NULL,
+                   iou->sqessize,
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE,
+                   fd,
+                   UV__IORING_OFF_SQES);
+  if (iou->sqes == MAP_FAILED) {
+    munmap(iou->ring, iou->ringsize);
+    goto err;
+  }
+
+  ring = iou->ring;
+  iou->sqtail = (uint32_t*) (ring + params.sq_off.tail);
+  iou->sqflags = (uint32_t*) (ring + params.sq_off.flags);
+  iou->sqmask = *(uint32_t*) (ring + params.sq_off.ring_mask);
+  iou->cqhead = (uint32_t*) (ring + params.cq_off.head);
+  iou->cqtail = (uint32_t*) (ring + params.cq_off.tail);
+  iou->cqmask = *(uint32_t*) (ring + params.cq_off.ring_mask);
+  iou->cqes = (struct uv__io_uring_cqe*) (ring + params.cq_off.cqes);
+  iou->entries = params.sq_entries;
+
+  /* Slot i of the submission queue always holds entry i. */
+  sqarray = (uint32_t*) (ring + params.sq_off.array);
+  for (i = 0; i < params.sq_entries; i++)
+    sqarray[i] = i;
+
+  /* uv__iou_init_bufs() recycles every buffer into the ring. */
+  ngx_queue_init(&iou->starved);
+
+  if (uv__cloexec(fd, 1)) {
+    munmap(iou->sqes, iou->sqessize);
+    munmap(iou->ring, iou->ringsize);
+    goto err;
+  }
+
+  if (net && uv__iou_init_bufs(iou))
+    net = 0;
+
+  if (!fs && !net) {
+    munmap(iou->sqes, iou->sqessize);
+    munmap(iou->ring, iou->ringsize);
+    errno = ENOSYS;
+    goto err;
+  }
+
+  iou->fs = fs;
+  iou->net = net;
+  ngx_queue_init(&iou->streams);
+  ngx_queue_init(&iou->retry);
+  loop->iou = iou;
+
+  ev_io_init(&iou->io_watcher, uv__iou_reap, fd, EV_READ);
+  iou->io_watcher.data = loop;
+  ev_io_start(loop->ev, &iou->io_watcher);
+
+  ev_prepare_init(&iou->submit_watcher, uv__iou_submit);
+  iou->submit_watcher.data = loop;
+  ev_prepare_start(loop->ev, &iou->submit_watcher);
+
+  /* The requests and streams keep the loop alive, not the ring. */
+  ev_unref(loop->ev);
+  ev_unref(loop->ev);
+
+  return 0;
+
+err:
+  SAVE_ERRNO(uv__close(fd));
+  free(iou);
+  return -1;
+}
+
+
+void uv__iou_destroy(uv_loop_t* loop) {
+  struct uv__iou_stream* s;
+  struct uv__iou* iou;
+  ngx_queue_t* q;
+
+  iou = loop->iou;
+
+  ev_ref(loop->ev);
+  ev_ref(loop->ev);
+  ev_io_stop(loop->ev, &iou->io_watcher);
+  ev_prepare_stop(loop->ev, &iou->submit_watcher);
+
+  /* Closed streams whose ops never completed. */
+  while (!ngx_queue_empty(&iou->streams)) {
+    q = ngx_queue_head(&iou->streams);
+    s = ngx_queue_data(q, struct uv__iou_stream, member);
+    ngx_queue_remove(q);
+    free(s->items);
+    free(s);
+  }
+
+  /* Closing the ring cancels whatever is still in flight. */
+  uv__close(iou->fd);
+  munmap(iou->sqes, iou->sqessize);
+  munmap(iou->ring, iou->ringsize);
+
+  if (iou->bufring) {
+    munmap(iou->bufring, UV__IOU_NBUFS * sizeof(struct uv__io_uring_buf));
+    free(iou->bufs);
+  }
+
+  free(iou);
+  loop->iou = NULL;
+}
+
+
+/*
+ * Queues an async fs request in the loop's submission ring. Returns -1
+ * without touching the request when the ring can't take it, the caller
+ * falls back to the thread pool then.
+ */
+int uv__iou_fs_submit(uv_loop_t* loop,
+                      uv_fs_t* req,
+                      void (*done)(struct uv__work* w, int status)) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__statx* stx;
+  struct uv__iou* iou;
+  size_t pathlen;
+
+  iou = loop->iou;
+  stx = NULL;
+
+  if (!iou->fs)
+    return -1;
+
+  switch (req->fs_type) {
+    case UV_FS_STAT:
+    case UV_FS_LSTAT:
+      /* uv__fs_stat() strips a trailing backslash, leave those to it. */
+      pathlen = strlen(req->path);
+      if (pathlen > 0 && req->path[pathlen - 1] == '\\')
+        return -1;
+      break;
+
+    case UV_FS_READ:
+    case UV_FS_WRITE:
+      if (req->len > UINT32_MAX)
+        return -1;
+      break;
+
+    case UV_FS_FSTAT:
+    case UV_FS_OPEN:
+    case UV_FS_CLOSE:
+    case UV_FS_FSYNC:
+    case UV_FS_FDATASYNC:
+      break;
+
+    default:
+      return -1;
+  }
+
+  if ((sqe = uv__iou_get_sqe(iou, (uintptr_t) req)) == NULL)
+    return -1;
+
+  switch (req->fs_type) {
+    case UV_FS_OPEN:
+      sqe->opcode = UV__IORING_OP_OPENAT;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = (uintptr_t) req->path;
+      sqe->len = req->mode;
+      sqe->rw_flags = req->flags | O_CLOEXEC;
+      break;
+
+    case UV_FS_CLOSE:
+      sqe->opcode = UV__IORING_OP_CLOSE;
+      sqe->fd = req->file;
+      break;
+
+    case UV_FS_READ:
+    case UV_FS_WRITE:
+      sqe->opcode = req->fs_type == UV_FS_READ ? UV__IORING_OP_READ
+                                               : UV__IORING_OP_WRITE;
+      sqe->fd = req->file;
+      sqe->addr = (uintptr_t) req->buf;
+      sqe->len = req->len;
+      /* -1 reads or writes at the file position, like read() or write(). */
+      sqe->off = req->off < 0 ? (uint64_t) -1 : (uint64_t) req->off;
+      break;
+
+    case UV_FS_FSYNC:
+    case UV_FS_FDATASYNC:
+      sqe->opcode = UV__IORING_OP_FSYNC;
+      sqe->fd = req->file;
+      if (req->fs_type == UV_FS_FDATASYNC)
+        sqe->rw_flags = UV__IORING_FSYNC_DATASYNC;
+      break;
+
+    case UV_FS_STAT:
+    case UV_FS_LSTAT:
+    case UV_FS_FSTAT:
+      if ((stx = malloc(sizeof(*stx))) == NULL)
+        return -1;
+
+      sqe->opcode = UV__IORING_OP_STATX;
+      sqe->len = UV__STATX_BASIC_STATS;
+      sqe->off = (uintptr_t) stx;
+
+      if (req->fs_type == UV_FS_FSTAT) {
+        sqe->fd = req->file;
+        sqe->addr = (uintptr_t) "";
+        sqe->rw_flags = AT_EMPTY_PATH;
+      } else {
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uintptr_t) req->path;
+        if (req->fs_type == UV_FS_LSTAT)
+          sqe->rw_flags = AT_SYMLINK_NOFOLLOW;
+      }
+      break;
+
+    default:
+      assert(0 && "unreachable");
+  }
+
+  uv__iou_commit(iou);
+
+  req->work_ptr = stx;
+  req->work_req.loop = loop;
+  req->work_req.done = done;
+
+  return 0;
+}
+
+
+/*
+ * Sets up the ring state of a stream. Returns -1 when the loop doesn't
+ * do stream I/O through its ring or the stream can't: TTYs, IPC pipes,
+ * pipe servers and streams that aren't open yet stay on libev.
+ */
+int uv__iou_stream_init(uv_stream_t* stream) {
+  struct uv__iou_stream* s;
+  struct uv__iou* iou;
+
+  iou = stream->loop->iou;
+  assert(stream->iou == NULL);
+
+  if (iou == NULL || !iou->net || stream->fd == -1)
+    return -1;
+
+  if (stream->type == UV_NAMED_PIPE) {
+    if (((uv_pipe_t*) stream)->ipc)
+      return -1;
+  } else if (stream->type != UV_TCP) {
+    return -1;
+  }
+
+  if (ev_cb(&stream->read_watcher) != uv__stream_io &&
+      ev_cb(&stream->read_watcher) != uv__server_io) {
+    return -1;
+  }
+
+  if ((s = calloc(1, sizeof(*s))) == NULL)
+    return -1;
+
+  s->stream = stream;
+  s->accept = (ev_cb(&stream->read_watcher) == uv__server_io);
+  ngx_queue_insert_tail(&iou->streams, &s->member);
+  stream->iou = s;
+
+  return 0;
+}
+
+
+/* Called when the stream's read watcher starts or stops. */
+void uv__iou_stream_update(uv_stream_t* stream) {
+  struct uv__iou_stream* s;
+
+  s = stream->iou;
+  uv__iou_stream_sync(stream->loop, s);
+
+  if (s->head != s->nitems && ev_is_active(&stream->read_watcher))
+    ev_feed_event(stream->loop->ev, &stream->read_watcher, EV_READ);
+}
+
+
+void uv__iou_stream_close(uv_stream_t* stream) {
+  struct uv__iou_stream* s;
+  struct uv__iou* iou;
+  struct uv__iou_item* item;
+
+  s = stream->iou;
+  iou = stream->loop->iou;
+
+  s->stream = NULL;
+
+  /* The send in flight still points at the buffers of the write request
+   * at the head of the queue. The stream keeps its ring state until the
+   * send completes, uv__next() holds back the close until then.
+   */
+  if (s->sending)
+    s->closing = stream;
+  else
+    stream->iou = NULL;
+
+  for (; s->head < s->nitems; s->head++) {
+    item = s->items + s->head;
+
+    if (item->bid != -1)
+      uv__iou_buf_recycle(iou, item->bid);
+    else if (s->accept && item->res >= 0)
+      uv__close(item->res);
+  }
+
+  uv__iou_stream_sync(stream->loop, s);
+
+  /* The ops in flight keep the socket open. Cancel them right away, the
+   * loop may not come around to submit them if this was the last handle.
+   */
+  uv__iou_flush(iou);
+
+  if (s->nops == 0)
+    uv__iou_stream_free(iou, s);
+}
+
+
+/* Like read(2) on the data that was received into the stash. */
+ssize_t uv__iou_read(uv_stream_t* stream, char* buf, size_t len) {
+  struct uv__iou_stream* s;
+  struct uv__iou_item* item;
+  size_t n;
+
+  s = stream->iou;
+
+  if (s->head == s->nitems) {
+    errno = EAGAIN;
+    return -1;
+  }
+
+  item = s->items + s->head;
+
+  if (item->res <= 0) {
+    s->head++;
+    if (item->res == 0)
+      return 0;
+    errno = -item->res;
+    return -1;
+  }
+
+  n = item->res - s->off;
+  if (n > len)
+    n = len;
+
+  memcpy(buf,
+         stream->loop->iou->bufs + item->bid * UV__IOU_BUFSIZE + s->off,
+         n);
+  s->off += n;
+
+  if (s->off == (size_t) item->res) {
+    uv__iou_buf_recycle(stream->loop->iou, item->bid);
+    s->off = 0;
+    s->head++;
+  }
+
+  return n;
+}
+
+
+/* Like uv__iou_read() but hands out the buffer the kernel received into
+ * instead of copying from it. uv__iou_buf_release() gives it back.
+ */
+ssize_t uv__iou_read_buf(uv_stream_t* stream, uv_buf_t* buf) {
+  struct uv__iou_stream* s;
+  struct uv__iou_item* item;
+  char* base;
+  size_t n;
+
+  s = stream->iou;
+  *buf = uv_buf_init(NULL, 0);
+
+  if (s->head == s->nitems) {
+    errno = EAGAIN;
+    return -1;
+  }
+
+  item = s->items + s->head++;
+
+  if (item->res <= 0) {
+    if (item->res == 0)
+      return 0;
+    errno = -item->res;
+    return -1;
+  }
+
+  base = stream->loop->iou->bufs + item->bid * UV__IOU_BUFSIZE;
+  *buf = uv_buf_init(base + s->off, UV__IOU_BUFSIZE - s->off);
+  n = item->res - s->off;
+  s->off = 0;
+
+  return n;
+}
+
+
+/* Returns -1 if the buffer isn't one of the ring's. */
+int uv__iou_buf_release(uv_loop_t* loop, char* base) {
+  struct uv__iou* iou;
+
+  iou = loop->iou;
+
+  if (iou == NULL ||
+      iou->bufs == NULL ||
+      base < iou->bufs ||
+      base >= iou->bufs + UV__IOU_NBUFS * UV__IOU_BUFSIZE) {
+    return -1;
+  }
+
+  uv__iou_buf_recycle(iou, (base - iou->bufs) / UV__IOU_BUFSIZE);
+  return 0;
+}
+
+
+/* Like accept(2) on the connections that were accepted into the stash. */
+int uv__iou_accept(uv_stream_t* stream) {
+  struct uv__iou_stream* s;
+  struct uv__iou_item* item;
+
+  s = stream->iou;
+
+  if (s->head == s->nitems) {
+    errno = EAGAIN;
+    return -1;
+  }
+
+  item = s->items + s->head++;
+
+  if (item->res < 0) {
+    errno = -item->res;
+    return -1;
+  }
+
+  return item->res;
+}
+
+
+int uv__iou_readable(uv_stream_t* stream) {
+  return stream->iou->head != stream->iou->nitems;
+}
+
+
+int uv__iou_sending(uv_stream_t* stream) {
+  return stream->iou != NULL && stream->iou->sending;
+}
+
+
+/*
+ * Sends the iovecs with a sendmsg op. They must stay put until the stream's
+ * uv__stream_iou_sent() is called. Returns -1 when the ring is full.
+ */
+int uv__iou_sendmsg(uv_stream_t* stream, struct iovec* iov, int iovcnt) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou_stream* s;
+  struct uv__iou* iou;
+
+  s = stream->iou;
+  iou = stream->loop->iou;
+  assert(!s->sending);
+
+  sqe = uv__iou_get_sqe(iou, (uintptr_t) s | UV__IOU_OP_SEND);
+  if (sqe == NULL)
+    return -1;
+
+  memset(&s->msg, 0, sizeof(s->msg));
+  s->msg.msg_iov = iov;
+  s->msg.msg_iovlen = iovcnt;
+
+  sqe->opcode = UV__IORING_OP_SENDMSG;
+  sqe->fd = stream->fd;
+  sqe->addr = (uintptr_t) &s->msg;
+  sqe->len = 1;
+  uv__iou_commit(iou);
+
+  s->sending = 1;
+  s->send_cancelled = 0;
+  s->nops++;
+
+  /* The write watcher isn't active, keep the loop alive like it would. */
+  ev_ref(stream->loop->ev);
+
+  return 0;
+}
+
+#endif /* HAVE_SYS_IO_URING */
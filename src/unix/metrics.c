@@ -0,0 +1,169 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Loop runtime metrics.
+ *
+ * libev calls the loop's release and acquire callbacks right before and
+ * after it polls for events, and the invoke callback to run the pending
+ * callbacks. They take the timestamps.
+ *
+ * Readers can be on other threads. The loop bumps metrics_seq to an odd
+ * number before it touches the metrics and to an even number afterwards;
+ * a reader copies the metrics and tries again when it saw an odd number
+ * or the number changed under it (a seqlock). The loop never waits.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <string.h>
+
+
+static void uv__metrics_begin(uv_loop_t* loop) {
+  __atomic_store_n(&loop->metrics_seq, loop->metrics_seq + 1,
+                   __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+static void uv__metrics_end(uv_loop_t* loop) {
+  __atomic_store_n(&loop->metrics_seq, loop->metrics_seq + 1,
+                   __ATOMIC_RELEASE);
+}
+
+
+static int uv__metrics_bucket(uint64_t lag) {
+  uint64_t us;
+  int i;
+
+  us = lag / 1000;
+  for (i = 0; us != 0 && i < UV_LOOP_LAG_BUCKETS - 1; i++)
+    us >>= 1;
+
+  return i;
+}
+
+
+static void uv__metrics_iter_end(uv_loop_t* loop, uint64_t now) {
+  uint64_t lag;
+
+  if (loop->metrics_run_start == 0)
+    return;
+
+  lag = now - loop->metrics_run_start;
+  loop->metrics_run_start = 0;
+
+  uv__metrics_begin(loop);
+  loop->metrics.run_time += lag;
+  loop->metrics.lag_hist[uv__metrics_bucket(lag)]++;
+  uv__metrics_end(loop);
+}
+
+
+/* About to poll, the iteration is over. */
+static void uv__metrics_release(EV_P) {
+  uv_loop_t* uv_loop;
+  uint64_t now;
+
+  uv_loop = ev_userdata(EV_A);
+  now = uv_hrtime();
+
+  uv__metrics_iter_end(uv_loop, now);
+  uv_loop->metrics_poll_start = now;
+}
+
+
+/* Back from polling, a new iteration starts. */
+static void uv__metrics_acquire(EV_P) {
+  uv_loop_t* uv_loop;
+  uint64_t now;
+
+  uv_loop = ev_userdata(EV_A);
+  now = uv_hrtime();
+
+  uv__metrics_begin(uv_loop);
+  uv_loop->metrics.iterations++;
+  uv_loop->metrics.poll_time += now - uv_loop->metrics_poll_start;
+  uv__metrics_end(uv_loop);
+
+  uv_loop->metrics_run_start = now;
+  uv_loop->metrics_iter_events = 0;
+}
+
+
+static void uv__metrics_invoke(EV_P) {
+  uv_loop_t* uv_loop;
+  unsigned int n;
+  uint64_t before;
+  uint64_t time;
+
+  n = ev_pending_count(EV_A);
+  if (n == 0)
+    return;
+
+  before = uv_hrtime();
+  ev_invoke_pending(EV_A);
+  time = uv_hrtime() - before;
+
+  uv_loop = ev_userdata(EV_A);
+  uv_loop->metrics_iter_events += n;
+
+  uv__metrics_begin(uv_loop);
+  uv_loop->metrics.events += n;
+  if (uv_loop->metrics.max_events < uv_loop->metrics_iter_events)
+    uv_loop->metrics.max_events = uv_loop->metrics_iter_events;
+  if (uv_loop->metrics.max_callback_time < time)
+    uv_loop->metrics.max_callback_time = time;
+  uv__metrics_end(uv_loop);
+}
+
+
+/* uv_run() or uv_run_once() returns. The iteration ends here, the time
+ * until the loop is run again isn't the loop's.
+ */
+void uv__metrics_run_end(uv_loop_t* loop) {
+  uv__metrics_iter_end(loop, uv_hrtime());
+}
+
+
+void uv__metrics_loop_init(uv_loop_t* loop) {
+  ev_set_loop_release_cb(loop->ev, uv__metrics_release, uv__metrics_acquire);
+  ev_set_invoke_pending_cb(loop->ev, uv__metrics_invoke);
+}
+
+
+void uv_loop_metrics(uv_loop_t* loop, uv_loop_metrics_t* metrics) {
+  unsigned int seq;
+
+  for (;;) {
+    seq = __atomic_load_n(&loop->metrics_seq, __ATOMIC_ACQUIRE);
+
+    if (seq & 1)
+      continue;
+
+    memcpy(metrics, &loop->metrics, sizeof *metrics);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    if (seq == __atomic_load_n(&loop->metrics_seq, __ATOMIC_RELAXED))
+      break;
+  }
+}
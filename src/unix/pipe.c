@@ -137,7 +137,7 @@ int uv_pipe_listen(uv_pipe_t* handle, int backlog, uv_connection_cb cb) {
   } else {
     handle->connection_cb = cb;
     ev_io_init(&handle->read_watcher, uv__pipe_accept, handle->fd, EV_READ);
-    ev_io_start(handle->loop->ev, &handle->read_watcher);
+    uv__stream_watcher_start((uv_stream_t*)handle, &handle->read_watcher);
   }
 
 out:
@@ -216,8 +216,8 @@ void uv_pipe_connect(uv_connect_t* req,
 
   uv__stream_open((uv_stream_t*)handle, sockfd, UV_READABLE | UV_WRITABLE);
 
-  ev_io_start(handle->loop->ev, &handle->read_watcher);
-  ev_io_start(handle->loop->ev, &handle->write_watcher);
+  uv__stream_watcher_start((uv_stream_t*)handle, &handle->read_watcher);
+  uv__stream_watcher_start((uv_stream_t*)handle, &handle->write_watcher);
 
   status = 0;
 
@@ -265,7 +265,7 @@ void uv__pipe_accept(EV_P_ ev_io* watcher, int revents) {
     pipe->connection_cb((uv_stream_t*)pipe, 0);
     if (pipe->accepted_fd == sockfd) {
       /* The user hasn't yet accepted called uv_accept() */
-      ev_io_stop(pipe->loop->ev, &pipe->read_watcher);
+      uv__stream_watcher_stop((uv_stream_t*)pipe, &pipe->read_watcher);
     }
   }
 
@@ -0,0 +1,421 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifndef F_GETPIPE_SZ
+# define F_GETPIPE_SZ 1032
+#endif
+
+#define UV__SPLICE_BUFSIZE  (64 * 1024)
+
+/* Max number of read/write rounds per event. Keeps one busy splice
+ * from starving the other watchers.
+ */
+#define UV__SPLICE_BUDGET   16
+
+#define UV__SPLICE_EOF      0x1   /* src reached EOF */
+#define UV__SPLICE_COPY     0x2   /* moving data with read(2) and write(2) */
+#define UV__SPLICE_DONE     0x4   /* cancelled, callback pending */
+
+
+static void uv__splice_io(EV_P_ ev_io* w, int revents);
+
+
+/* Drops the pipe and switches to copying through a buffer. Data that
+ * already went into the pipe is moved to the buffer first.
+ */
+static int uv__splice_copy_mode(uv_splice_t* req) {
+  ssize_t r;
+  size_t n;
+
+  assert(req->pending <= req->pipesize);
+
+  req->buf = malloc(req->pipesize);
+  if (req->buf == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  for (n = 0; n < req->pending; n += r) {
+    do
+      r = read(req->fds[0], req->buf + n, req->pending - n);
+    while (r == -1 && errno == EINTR);
+
+    if (r <= 0) {
+      if (r == 0)
+        errno = EIO;
+      return -1;
+    }
+  }
+
+  if (req->fds[0] != -1) {
+    uv__close(req->fds[0]);
+    uv__close(req->fds[1]);
+    req->fds[0] = -1;
+    req->fds[1] = -1;
+  }
+
+  req->off = 0;
+  req->flags |= UV__SPLICE_COPY;
+
+  return 0;
+}
+
+
+static ssize_t uv__splice_in(uv_splice_t* req) {
+  uv_loop_t* loop = req->src->loop;
+  ssize_t n;
+
+  do {
+    loop->counters.read_syscalls++;
+#if HAVE_SYS_SPLICE
+    if (!(req->flags & UV__SPLICE_COPY))
+      n = sys_splice(req->src->fd,
+                     req->fds[1],
+                     req->pipesize - req->pending,
+                     UV__SPLICE_F_MOVE | UV__SPLICE_F_NONBLOCK);
+    else
+#endif
+      n = read(req->src->fd, req->buf, req->pipesize);
+  }
+  while (n == -1 && errno == EINTR);
+
+  if (n == -1 && errno == EAGAIN)
+    loop->counters.eagain++;
+
+  if (n > 0) {
+    loop->counters.read_bytes += n;
+    if (req->flags & UV__SPLICE_COPY)
+      req->off = 0;
+    req->pending += n;
+  }
+
+  return n;
+}
+
+
+static ssize_t uv__splice_out(uv_splice_t* req) {
+  uv_loop_t* loop = req->src->loop;
+  ssize_t n;
+
+  do {
+    loop->counters.write_syscalls++;
+#if HAVE_SYS_SPLICE
+    if (!(req->flags & UV__SPLICE_COPY))
+      n = sys_splice(req->fds[0],
+                     req->dst->fd,
+                     req->pending,
+                     UV__SPLICE_F_MOVE | UV__SPLICE_F_NONBLOCK);
+    else
+#endif
+      n = write(req->dst->fd, req->buf + req->off, req->pending);
+  }
+  while (n == -1 && errno == EINTR);
+
+  if (n == -1 && errno == EAGAIN)
+    loop->counters.eagain++;
+
+  if (n > 0) {
+    loop->counters.write_bytes += n;
+    if (req->flags & UV__SPLICE_COPY)
+      req->off += n;
+    req->pending -= n;
+    req->nbytes += n;
+  }
+
+  return n;
+}
+
+
+/* src is only read while dst has no writes queued. Bytes that are in
+ * flight go out before writes that are made while they wait, see
+ * uv__write().
+ */
+static int uv__splice_dst_idle(uv_splice_t* req) {
+  return ngx_queue_empty(&req->dst->write_queue);
+}
+
+
+/* Lets the writes that waited for the spliced bytes go. */
+static void uv__splice_release(uv_splice_t* req) {
+  uv_stream_t* dst = req->dst;
+
+  if (!ngx_queue_empty(&dst->write_queue) && !(dst->flags & UV_CLOSING))
+    uv__stream_watcher_start(dst, &dst->write_watcher);
+}
+
+
+/* Stops the watchers, unlinks the streams and frees the resources. */
+static void uv__splice_stop(uv_splice_t* req) {
+  uv_loop_t* loop = req->src->loop;
+
+  ev_io_stop(loop->ev, &req->read_watcher);
+  ev_io_stop(loop->ev, &req->write_watcher);
+
+  req->src->splice_from = NULL;
+  req->dst->splice_to = NULL;
+
+  /* Bytes that didn't make it out no longer hold up dst's writes. */
+  if (req->pending > 0)
+    uv__splice_release(req);
+
+  if (req->fds[0] != -1) {
+    uv__close(req->fds[0]);
+    uv__close(req->fds[1]);
+    req->fds[0] = -1;
+    req->fds[1] = -1;
+  }
+
+  free(req->buf);
+  req->buf = NULL;
+}
+
+
+static void uv__splice_finish(uv_splice_t* req, int err) {
+  uv_loop_t* loop = req->src->loop;
+
+  uv__splice_stop(req);
+
+  if (err) {
+    uv__set_sys_error(loop, err);
+    req->cb(req, -1);
+  } else {
+    uv__set_sys_error(loop, 0);
+    req->cb(req, 0);
+  }
+}
+
+
+/* Only one of the watchers is active at a time. src isn't read while
+ * data waits to go out, that's what makes a slow dst push back on src.
+ */
+static void uv__splice_update(uv_splice_t* req) {
+  uv_loop_t* loop = req->src->loop;
+
+  if (!(req->flags & UV__SPLICE_EOF) &&
+      req->pending == 0 &&
+      uv__splice_dst_idle(req)) {
+    ev_io_start(loop->ev, &req->read_watcher);
+  } else {
+    ev_io_stop(loop->ev, &req->read_watcher);
+  }
+
+  if (req->pending > 0)
+    ev_io_start(loop->ev, &req->write_watcher);
+  else
+    ev_io_stop(loop->ev, &req->write_watcher);
+}
+
+
+static void uv__splice_run(uv_splice_t* req) {
+  int progress;
+  int budget;
+  ssize_t n;
+
+  for (budget = UV__SPLICE_BUDGET; budget > 0; budget--) {
+    progress = 0;
+
+    if (req->pending > 0) {
+      n = uv__splice_out(req);
+
+      if (n > 0) {
+        progress = 1;
+        if (req->pending == 0)
+          uv__splice_release(req);
+      } else if (n == -1 && errno != EAGAIN) {
+#if HAVE_SYS_SPLICE
+        /* dst doesn't do splice(2), copy from here on. */
+        if (errno == EINVAL && !(req->flags & UV__SPLICE_COPY)) {
+          if (uv__splice_copy_mode(req)) {
+            uv__splice_finish(req, errno);
+            return;
+          }
+          continue;
+        }
+#endif
+        uv__splice_finish(req, errno);
+        return;
+      }
+    }
+
+    if ((req->flags & UV__SPLICE_EOF) && req->pending == 0) {
+      uv__splice_finish(req, 0);
+      return;
+    }
+
+    if (!(req->flags & UV__SPLICE_EOF) &&
+        uv__splice_dst_idle(req) &&
+        req->pending < req->pipesize &&
+        (req->pending == 0 || !(req->flags & UV__SPLICE_COPY))) {
+      n = uv__splice_in(req);
+
+      if (n > 0) {
+        progress = 1;
+      } else if (n == 0) {
+        req->flags |= UV__SPLICE_EOF;
+        progress = 1;
+      } else if (errno != EAGAIN) {
+#if HAVE_SYS_SPLICE
+        /* src doesn't do splice(2), copy from here on. */
+        if (errno == EINVAL && !(req->flags & UV__SPLICE_COPY)) {
+          if (uv__splice_copy_mode(req)) {
+            uv__splice_finish(req, errno);
+            return;
+          }
+          continue;
+        }
+#endif
+        uv__splice_finish(req, errno);
+        return;
+      }
+    }
+
+    if (!progress)
+      break;
+  }
+
+  uv__splice_update(req);
+}
+
+
+static void uv__splice_io(EV_P_ ev_io* w, int revents) {
+  uv_loop_t* uv_loop = ev_userdata(EV_A);
+  uv_splice_t* req = w->data;
+
+  if (req->flags & UV__SPLICE_DONE) {
+    uv__set_artificial_error(uv_loop, UV_ECANCELED);
+    req->cb(req, -1);
+    return;
+  }
+
+  uv__splice_run(req);
+}
+
+
+int uv_stream_splice(uv_splice_t* req, uv_stream_t* src, uv_stream_t* dst,
+    uv_splice_cb cb) {
+  uv_loop_t* loop = src->loop;
+
+  if (src == dst ||
+      src->fd < 0 ||
+      dst->fd < 0 ||
+      src->loop != dst->loop ||
+      (src->flags & (UV_CLOSING | UV_CLOSED)) ||
+      (dst->flags & (UV_CLOSING | UV_CLOSED | UV_SHUTTING)) ||
+      !(src->flags & UV_READABLE) ||
+      !(dst->flags & UV_WRITABLE)) {
+    uv__set_artificial_error(loop, UV_EINVAL);
+    return -1;
+  }
+
+  if ((src->flags & UV_READING) ||
+      src->splice_from != NULL ||
+      dst->splice_to != NULL) {
+    uv__set_artificial_error(loop, UV_EBUSY);
+    return -1;
+  }
+
+#if HAVE_SYS_IO_URING
+  /* Data that the ring already received would be skipped. */
+  if (src->iou != NULL && uv__iou_readable(src)) {
+    uv__set_artificial_error(loop, UV_EBUSY);
+    return -1;
+  }
+#endif
+
+  uv__req_init(loop, (uv_req_t*)req);
+  req->type = UV_SPLICE;
+  req->src = src;
+  req->dst = dst;
+  req->cb = cb;
+  req->nbytes = 0;
+  req->fds[0] = -1;
+  req->fds[1] = -1;
+  req->pipesize = UV__SPLICE_BUFSIZE;
+  req->buf = NULL;
+  req->off = 0;
+  req->pending = 0;
+  req->flags = 0;
+
+#if HAVE_SYS_SPLICE
+  if (uv__make_pipe(req->fds, UV__F_NONBLOCK) == 0) {
+    int size = fcntl(req->fds[0], F_GETPIPE_SZ);
+    if (size > 0)
+      req->pipesize = size;
+  } else {
+    req->fds[0] = -1;
+    req->fds[1] = -1;
+  }
+
+  if (req->fds[0] == -1)
+#endif
+  {
+    if (uv__splice_copy_mode(req)) {
+      uv__set_sys_error(loop, errno);
+      return -1;
+    }
+  }
+
+  ev_io_init(&req->read_watcher, uv__splice_io, src->fd, EV_READ);
+  ev_io_init(&req->write_watcher, uv__splice_io, dst->fd, EV_WRITE);
+  req->read_watcher.data = req;
+  req->write_watcher.data = req;
+
+  src->splice_from = req;
+  dst->splice_to = req;
+
+  uv__splice_update(req);
+
+  return 0;
+}
+
+
+void uv__splice_drained(uv_splice_t* req) {
+  uv__splice_run(req);
+}
+
+
+static void uv__splice_cancel(uv_splice_t* req) {
+  uv_loop_t* loop = req->src->loop;
+
+  uv__splice_stop(req);
+
+  /* The callback is made from the loop, not from inside uv_close(). */
+  req->flags |= UV__SPLICE_DONE;
+  ev_feed_event(loop->ev, &req->read_watcher, EV_CUSTOM);
+}
+
+
+void uv__splice_close(uv_stream_t* stream) {
+  if (stream->splice_from != NULL)
+    uv__splice_cancel(stream->splice_from);
+
+  if (stream->splice_to != NULL)
+    uv__splice_cancel(stream->splice_to);
+}
@@ -24,12 +24,58 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/uio.h>
+#include <sys/mman.h>
 
 #include <stdio.h>
+#include <limits.h> /* IOV_MAX */
+
+#if defined(IOV_MAX) && IOV_MAX < 1024
+# define UV__IOV_MAX IOV_MAX
+#else
+# define UV__IOV_MAX 1024
+#endif
+
+#define UV__READ_POOL_NBUFS 256
+#define UV__READ_POOL_SIZE  (64 * 1024)
+
+/* Bounds and starting point of the size that alloc_cb is asked for. */
+#define UV__READ_SIZE_MIN   64
+#define UV__READ_SIZE_MAX   (64 * 1024)
+#define UV__READ_SIZE_INIT  1024
+
+/* uv_write_file() sends at most this much per sendfile(2) call and checks
+ * the page cache for it up front.
+ */
+#define UV__WRITE_FILE_CHUNK  (512 * 1024)
+
+/* Reads a part of a uv_write_file() request into the page cache. Owned by
+ * the thread pool while it's in flight, req is NULL once the stream has
+ * been closed.
+ */
+struct uv__write_file_work {
+  struct uv__work work;
+  uv_write_t* req;
+  uv_file file;
+  off_t offset;
+  size_t length;
+  int error;
+};
+
+
+/* The buffers that uv_read_start_pool() reads into. */
+struct uv__read_pool {
+  char* bufs;
+  size_t size;
+  unsigned int nbufs;
+  unsigned int* free; /* Indices of the free buffers, used as a stack. */
+  unsigned int nfree;
+  ngx_queue_t parked; /* Streams that found the pool empty. */
+};
 
 
 static void uv__stream_connect(uv_stream_t*);
@@ -60,9 +106,17 @@ void uv__stream_init(uv_loop_t* loop,
   stream->connection_cb = NULL;
   stream->connect_req = NULL;
   stream->accepted_fd = -1;
+  stream->accept_batch = 0;
   stream->fd = -1;
   stream->delayed_error = 0;
   stream->blocking = 0;
+  stream->iou = NULL;
+  ngx_queue_init(&stream->read_pool_queue);
+  stream->read_size = UV__READ_SIZE_INIT;
+  stream->splice_from = NULL;
+  stream->splice_to = NULL;
+  stream->zerocopy = NULL;
+  uv__stream_init_watermarks(stream);
   ngx_queue_init(&stream->write_queue);
   ngx_queue_init(&stream->write_completed_queue);
   stream->write_queue_size = 0;
@@ -79,32 +133,176 @@ void uv__stream_init(uv_loop_t* loop,
 }
 
 
+#if HAVE_EPOLL
+static int uv__stream_events(uv_stream_t* stream) {
+  return (ev_is_active(&stream->read_watcher) ? EV_READ : 0) |
+         (ev_is_active(&stream->write_watcher) ? EV_WRITE : 0);
+}
+#endif
+
+
+#if HAVE_SYS_IO_URING
+/* Returns 1 if the stream's I/O goes through the loop's io_uring. */
+static int uv__stream_iou(uv_stream_t* stream) {
+  if (stream->iou)
+    return 1;
+
+  if (stream->loop->iou == NULL)
+    return 0;
+
+  return uv__iou_stream_init(stream) == 0;
+}
+#endif
+
+
+/* Starts watching the stream for readability or writability. Loops created
+ * with UV_LOOP_EPOLL don't hand the watcher to libev. The watcher is only
+ * marked active, ref'd like libev would do, and the stream's registration
+ * in the loop's epoll set is updated. On UV_LOOP_IO_URING_NET loops the same
+ * goes for the read watcher, it arms a multishot recv or accept instead.
+ */
+void uv__stream_watcher_start(uv_stream_t* stream, ev_io* w) {
+#if HAVE_EPOLL
+  int old_events;
+#endif
+
+  assert(w == &stream->read_watcher || w == &stream->write_watcher);
+
+#if HAVE_SYS_IO_URING
+  if (w == &stream->read_watcher && uv__stream_iou(stream)) {
+    if (!ev_is_active(w)) {
+      w->active = 1;
+      ev_ref(stream->loop->ev);
+    }
+
+    uv__iou_stream_update(stream);
+    return;
+  }
+#endif
+
+#if HAVE_EPOLL
+  if (stream->loop->epoll_fd != -1 && !(stream->flags & UV_EPOLL_REFUSED)) {
+    if (ev_is_active(w))
+      return;
+
+    old_events = uv__stream_events(stream);
+    w->active = 1;
+    ev_ref(stream->loop->ev);
+
+    if (uv__epoll_update(stream->loop,
+                         stream,
+                         w->fd,
+                         old_events,
+                         uv__stream_events(stream)) == 0) {
+      return;
+    }
+
+    /* Not pollable. Nothing else was registered yet, so the stream's
+     * watchers can go to libev from here on.
+     */
+    assert(old_events == 0);
+    w->active = 0;
+    ev_unref(stream->loop->ev);
+    stream->flags |= UV_EPOLL_REFUSED;
+  }
+#endif
+
+  ev_io_start(stream->loop->ev, w);
+}
+
+
+void uv__stream_watcher_stop(uv_stream_t* stream, ev_io* w) {
+#if HAVE_EPOLL
+  int old_events;
+#endif
+
+  assert(w == &stream->read_watcher || w == &stream->write_watcher);
+
+#if HAVE_SYS_IO_URING
+  if (w == &stream->read_watcher && stream->iou) {
+    ev_clear_pending(stream->loop->ev, w);
+
+    if (!ev_is_active(w))
+      return;
+
+    w->active = 0;
+    ev_unref(stream->loop->ev);
+
+    uv__iou_stream_update(stream);
+    return;
+  }
+#endif
+
+#if HAVE_EPOLL
+  if (stream->loop->epoll_fd != -1 && !(stream->flags & UV_EPOLL_REFUSED)) {
+    /* Like ev_io_stop(), drop events that were fed but not yet delivered. */
+    ev_clear_pending(stream->loop->ev, w);
+
+    if (!ev_is_active(w))
+      return;
+
+    old_events = uv__stream_events(stream);
+    w->active = 0;
+    ev_unref(stream->loop->ev);
+
+    uv__epoll_update(stream->loop,
+                     stream,
+                     w->fd,
+                     old_events,
+                     uv__stream_events(stream));
+    return;
+  }
+#endif
+
+  ev_io_stop(stream->loop->ev, w);
+}
+
+
+/* For accepted sockets, the UV_TCP_NODELAY and UV_TCP_KEEPALIVE bits in
+ * `flags` are the options that the socket already has.
+ */
 int uv__stream_open(uv_stream_t* stream, int fd, int flags) {
   socklen_t yes;
+  int inherited;
 
   assert(fd >= 0);
   stream->fd = fd;
 
+  inherited = 0;
+  if (flags & UV_ACCEPTED)
+    inherited = flags & (UV_TCP_NODELAY | UV_TCP_KEEPALIVE);
+
   stream->flags |= flags;
 
   if (stream->type == UV_TCP) {
-    /* Reuse the port address if applicable. */
-    yes = 1;
-    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes) == -1) {
-      uv__set_sys_error(stream->loop, errno);
-      return -1;
+    /* Reuse the port address if applicable. Accepted sockets are never
+     * bound so it doesn't apply to them.
+     */
+    if (!(flags & UV_ACCEPTED)) {
+      yes = 1;
+      if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes) == -1) {
+        uv__set_sys_error(stream->loop, errno);
+        return -1;
+      }
     }
 
     if ((stream->flags & UV_TCP_NODELAY) &&
+        !(inherited & UV_TCP_NODELAY) &&
         uv__tcp_nodelay((uv_tcp_t*)stream, 1)) {
       return -1;
     }
 
     /* TODO Use delay the user passed in. */
     if ((stream->flags & UV_TCP_KEEPALIVE) &&
+        !(inherited & UV_TCP_KEEPALIVE) &&
         uv__tcp_keepalive((uv_tcp_t*)stream, 1, 60)) {
       return -1;
     }
+
+#if HAVE_MSG_ZEROCOPY
+    if (stream->zerocopy != NULL && uv__zerocopy_open(stream))
+      return -1;
+#endif
   }
 
   /* Associate the fd with each ev_io watcher. */
@@ -125,6 +323,23 @@ void uv__stream_destroy(uv_stream_t* stream) {
 
   assert(stream->flags & UV_CLOSED);
 
+#if HAVE_MSG_ZEROCOPY
+  if (stream->zerocopy != NULL)
+    uv__zerocopy_destroy(stream);
+#endif
+
+  /* Finished requests go first, they were written before the rest. */
+  while (!ngx_queue_empty(&stream->write_completed_queue)) {
+    q = ngx_queue_head(&stream->write_completed_queue);
+    ngx_queue_remove(q);
+
+    req = ngx_queue_data(q, uv_write_t, queue);
+    if (req->cb) {
+      uv__set_sys_error(stream->loop, req->error);
+      req->cb(req, req->error ? -1 : 0);
+    }
+  }
+
   while (!ngx_queue_empty(&stream->write_queue)) {
     q = ngx_queue_head(&stream->write_queue);
     ngx_queue_remove(q);
@@ -133,28 +348,89 @@ void uv__stream_destroy(uv_stream_t* stream) {
     if (req->bufs != req->bufsml)
       free(req->bufs);
 
+    /* The thread pool frees it. */
+    if (req->file_work != NULL)
+      req->file_work->req = NULL;
+
     if (req->cb) {
       uv__set_artificial_error(req->handle->loop, UV_EINTR);
       req->cb(req, -1);
     }
   }
+}
 
-  while (!ngx_queue_empty(&stream->write_completed_queue)) {
-    q = ngx_queue_head(&stream->write_completed_queue);
-    ngx_queue_remove(q);
 
-    req = ngx_queue_data(q, uv_write_t, queue);
-    if (req->cb) {
-      uv__set_sys_error(stream->loop, req->error);
-      req->cb(req, req->error ? -1 : 0);
-    }
+static int uv__stream_accept(uv_stream_t* stream) {
+  struct sockaddr_storage addr;
+
+#if HAVE_SYS_IO_URING
+  if (stream->iou)
+    return uv__iou_accept(stream);
+#endif
+
+  return uv__accept(stream->fd, (struct sockaddr*)&addr, sizeof addr);
+}
+
+
+/* The reserve is a descriptor that's given up when accept() fails with
+ * EMFILE or ENFILE. Without it the listener stays readable and the loop
+ * spins on it until a descriptor is freed somewhere else.
+ */
+static void uv__emfile_reserve(uv_loop_t* loop) {
+  int fd;
+
+  if (loop->emfile_fd != -1)
+    return;
+
+  fd = open("/", O_RDONLY);
+  if (fd == -1)
+    return;
+
+  if (uv__cloexec(fd, 1)) {
+    uv__close(fd);
+    return;
   }
+
+  loop->emfile_fd = fd;
+}
+
+
+/* Frees the reserve, then accepts and closes the pending connections so
+ * that the clients see them fail instead of hanging in the backlog.
+ * Returns the number of connections that were dropped.
+ */
+static int uv__emfile_trick(uv_loop_t* loop, int accept_fd) {
+  struct sockaddr_storage addr;
+  int saved_errno;
+  int dropped;
+  int fd;
+
+  if (loop->emfile_fd == -1)
+    return 0;
+
+  saved_errno = errno;
+  uv__close(loop->emfile_fd);
+  loop->emfile_fd = -1;
+
+  for (dropped = 0; ; dropped++) {
+    fd = uv__accept(accept_fd, (struct sockaddr*)&addr, sizeof addr);
+    if (fd < 0)
+      break;
+    uv__close(fd);
+  }
+
+  loop->counters.accept_dropped += dropped;
+
+  uv__emfile_reserve(loop);
+  errno = saved_errno;
+
+  return dropped;
 }
 
 
 void uv__server_io(EV_P_ ev_io* watcher, int revents) {
+  unsigned int count;
   int fd;
-  struct sockaddr_storage addr;
   uv_stream_t* stream = watcher->data;
 
   assert(watcher == &stream->read_watcher ||
@@ -164,34 +440,60 @@ void uv__server_io(EV_P_ ev_io* watcher, int revents) {
   assert(!(stream->flags & UV_CLOSING));
 
   if (stream->accepted_fd >= 0) {
-    ev_io_stop(EV_A, &stream->read_watcher);
+    uv__stream_watcher_stop(stream, &stream->read_watcher);
     return;
   }
 
   /* connection_cb can close the server socket while we're
    * in the loop so check it on each iteration.
    */
-  while (stream->fd != -1) {
+  for (count = 0; stream->fd != -1; count++) {
     assert(stream->accepted_fd < 0);
-    fd = uv__accept(stream->fd, (struct sockaddr*)&addr, sizeof addr);
+
+    if (stream->accept_batch != 0 && count == stream->accept_batch) {
+#if HAVE_SYS_IO_URING
+      /* Completions that are already in are only fed once. */
+      if (stream->iou && uv__iou_readable(stream))
+        ev_feed_event(EV_A_ &stream->read_watcher, EV_READ);
+#endif
+      return;
+    }
+
+    fd = uv__stream_accept(stream);
 
     if (fd < 0) {
       if (errno == EAGAIN) {
         /* No problem. */
+        stream->loop->counters.eagain++;
         return;
-      } else if (errno == EMFILE) {
-        /* TODO special trick. unlock reserved socket, accept, close. */
-        return;
+      } else if (errno == EMFILE || errno == ENFILE) {
+        stream->loop->counters.accept_error++;
+
+        /* Nothing was pending once the reserve was freed. */
+        if (stream->loop->emfile_fd != -1 &&
+            uv__emfile_trick(stream->loop, stream->fd) == 0) {
+          return;
+        }
+
+        uv__set_sys_error(stream->loop, errno);
+        stream->connection_cb((uv_stream_t*)stream, -1);
+
+        if (stream->loop->emfile_fd == -1) {
+          /* No reserve to fall back on, wait for the next wakeup. */
+          return;
+        }
       } else {
+        stream->loop->counters.accept_error++;
         uv__set_sys_error(stream->loop, errno);
         stream->connection_cb((uv_stream_t*)stream, -1);
       }
     } else {
+      stream->loop->counters.accept++;
       stream->accepted_fd = fd;
       stream->connection_cb((uv_stream_t*)stream, 0);
       if (stream->accepted_fd >= 0) {
         /* The user hasn't yet accepted called uv_accept() */
-        ev_io_stop(stream->loop->ev, &stream->read_watcher);
+        uv__stream_watcher_stop(stream, &stream->read_watcher);
         return;
       }
     }
@@ -204,6 +506,7 @@ int uv_accept(uv_stream_t* server, uv_stream_t* client) {
   uv_stream_t* streamClient;
   int saved_errno;
   int status;
+  int flags;
 
   /* TODO document this */
   assert(server->loop == client->loop);
@@ -219,15 +522,20 @@ int uv_accept(uv_stream_t* server, uv_stream_t* client) {
     goto out;
   }
 
-  if (uv__stream_open(streamClient, streamServer->accepted_fd,
-        UV_READABLE | UV_WRITABLE)) {
+  flags = UV_READABLE | UV_WRITABLE | UV_ACCEPTED;
+#if HAVE_ACCEPT_INHERIT
+  if (server->type == UV_TCP)
+    flags |= server->flags & (UV_TCP_NODELAY | UV_TCP_KEEPALIVE);
+#endif
+
+  if (uv__stream_open(streamClient, streamServer->accepted_fd, flags)) {
     /* TODO handle error */
     uv__close(streamServer->accepted_fd);
     streamServer->accepted_fd = -1;
     goto out;
   }
 
-  ev_io_start(streamServer->loop->ev, &streamServer->read_watcher);
+  uv__stream_watcher_start(streamServer, &streamServer->read_watcher);
   streamServer->accepted_fd = -1;
   status = 0;
 
@@ -237,7 +545,15 @@ out:
 }
 
 
+int uv_stream_set_accept_batch(uv_stream_t* server, unsigned int n) {
+  server->accept_batch = n;
+  return 0;
+}
+
+
 int uv_listen(uv_stream_t* stream, int backlog, uv_connection_cb cb) {
+  uv__emfile_reserve(stream->loop);
+
   switch (stream->type) {
     case UV_TCP:
       return uv_tcp_listen((uv_tcp_t*)stream, backlog, cb);
@@ -276,7 +592,7 @@ static void uv__drain(uv_stream_t* stream) {
   assert(!uv_write_queue_head(stream));
   assert(stream->write_queue_size == 0);
 
-  ev_io_stop(stream->loop->ev, &stream->write_watcher);
+  uv__stream_watcher_stop(stream, &stream->write_watcher);
 
   /* Shutdown? */
   if ((stream->flags & UV_SHUTTING) &&
@@ -308,6 +624,7 @@ static size_t uv__write_req_size(uv_write_t* req) {
 
   size = uv__buf_count(req->bufs + req->write_index,
                        req->bufcnt - req->write_index);
+  size += req->file_length;
   assert(req->handle->write_queue_size >= size);
 
   return size;
@@ -324,6 +641,12 @@ static void uv__write_req_finish(uv_write_t* req) {
   }
   req->bufs = NULL;
 
+#if HAVE_MSG_ZEROCOPY
+  /* The kernel may still be sending from the buffers. */
+  if (stream->zerocopy != NULL && uv__zerocopy_hold(stream, req))
+    return;
+#endif
+
   /* Add it to the write_completed_queue where it will have its
    * callback called in the near future.
    */
@@ -332,14 +655,355 @@ static void uv__write_req_finish(uv_write_t* req) {
 }
 
 
-/* On success returns NULL. On error returns a pointer to the write request
- * which had the error.
+/* Collects the unwritten buffers of the requests at the front of the write
+ * queue so that they can be flushed with a single writev(). Requests that
+ * pass a handle must go out on their own sendmsg() and file requests on
+ * sendfile(), so gathering stops there.
+ * When only the head request contributes, its buffer array is used in place.
+ *
+ * Returns the number of iovecs, stores the number of requests it touched
+ * in *nreqs and the number of bytes gathered in *nbytes.
+ */
+static int uv__write_gather(uv_stream_t* stream,
+                            struct iovec* iovbuf,
+                            struct iovec** iovp,
+                            int* nreqs,
+                            size_t* nbytes) {
+  uv_write_t* req;
+  ngx_queue_t* q;
+  int iovcnt;
+  int n;
+
+  req = uv_write_queue_head(stream);
+  assert(req != NULL);
+
+  n = req->bufcnt - req->write_index;
+  q = ngx_queue_next(&req->queue);
+
+  if (req->send_handle ||
+      n >= UV__IOV_MAX ||
+      q == ngx_queue_sentinel(&stream->write_queue) ||
+      (ngx_queue_data(q, uv_write_t, queue))->send_handle ||
+      (ngx_queue_data(q, uv_write_t, queue))->file != -1) {
+    if (n > UV__IOV_MAX)
+      n = UV__IOV_MAX;
+
+    *iovp = (struct iovec*) &(req->bufs[req->write_index]);
+    *nreqs = 1;
+    *nbytes = uv__buf_count(req->bufs + req->write_index, n);
+    return n;
+  }
+
+  iovcnt = 0;
+  *nreqs = 0;
+  *nbytes = 0;
+
+  ngx_queue_foreach(q, &stream->write_queue) {
+    req = ngx_queue_data(q, uv_write_t, queue);
+
+    if (req->send_handle || req->file != -1 || iovcnt == UV__IOV_MAX)
+      break;
+
+    n = req->bufcnt - req->write_index;
+    if (n > UV__IOV_MAX - iovcnt)
+      n = UV__IOV_MAX - iovcnt;
+
+    memcpy(iovbuf + iovcnt, req->bufs + req->write_index, n * sizeof(*iovbuf));
+    *nbytes += uv__buf_count(req->bufs + req->write_index, n);
+    iovcnt += n;
+    (*nreqs)++;
+  }
+
+  *iovp = iovbuf;
+  return iovcnt;
+}
+
+
+/* Advances req past the first *n bytes that were written out and subtracts
+ * them from *n. Returns 1 if all of req's buffers have been written.
+ */
+static int uv__write_req_update(uv_stream_t* stream,
+                                uv_write_t* req,
+                                size_t* n) {
+  uv_buf_t* buf;
+
+  while (req->write_index < req->bufcnt) {
+    buf = &(req->bufs[req->write_index]);
+
+    if (*n < buf->len) {
+      buf->base += *n;
+      buf->len -= *n;
+      assert(stream->write_queue_size >= *n);
+      stream->write_queue_size -= *n;
+      *n = 0;
+      return 0;
+    }
+
+    /* Finished writing the buf at index req->write_index. */
+    *n -= buf->len;
+    assert(stream->write_queue_size >= buf->len);
+    stream->write_queue_size -= buf->len;
+    req->write_index++;
+  }
+
+  return 1;
+}
+
+
+#if HAVE_SYS_IO_URING
+/* Hands the rest of the request at the head of the queue to the kernel
+ * instead of waiting for the socket to become writable. Returns 0 when the
+ * stream doesn't do its I/O through the loop's io_uring or the ring is full.
+ */
+static int uv__write_iou(uv_stream_t* stream) {
+  uv_write_t* req;
+  int iovcnt;
+
+  req = uv_write_queue_head(stream);
+  assert(req != NULL);
+
+  if (req->send_handle || req->file != -1 || !uv__stream_iou(stream))
+    return 0;
+
+  iovcnt = req->bufcnt - req->write_index;
+  if (iovcnt > UV__IOV_MAX)
+    iovcnt = UV__IOV_MAX;
+
+  if (uv__iou_sendmsg(stream,
+                      (struct iovec*) (req->bufs + req->write_index),
+                      iovcnt)) {
+    return 0;
+  }
+
+  uv__stream_watcher_stop(stream, &stream->write_watcher);
+  return 1;
+}
+#endif
+
+
+/* Returns 1 if the given part of file is in the page cache, so sendfile()
+ * won't have to wait for the disk. Where there's no telling, or the file
+ * can't be mapped, the answer is yes and sendfile() has to cope.
+ */
+static int uv__write_file_cached(uv_file file, off_t offset, size_t length) {
+#if defined(__linux__)
+  unsigned char vec[UV__WRITE_FILE_CHUNK / 4096 + 2];
+  size_t pagesize;
+  size_t maplen;
+  size_t npages;
+  size_t i;
+  off_t start;
+  void* addr;
+  int r;
+
+  pagesize = getpagesize();
+  start = offset - offset % pagesize;
+  maplen = (size_t) (offset - start) + length;
+  npages = (maplen + pagesize - 1) / pagesize;
+
+  if (npages > sizeof(vec))
+    return 0;
+
+  /* Only reserves address space, mincore() doesn't fault pages in. */
+  addr = mmap(NULL, maplen, PROT_READ, MAP_SHARED, file, start);
+  if (addr == MAP_FAILED)
+    return 1;
+
+  r = mincore(addr, maplen, vec);
+  munmap(addr, maplen);
+
+  if (r)
+    return 1;
+
+  for (i = 0; i < npages; i++)
+    if (!(vec[i] & 1))
+      return 0;
+#endif
+
+  return 1;
+}
+
+
+static void uv__write_file_warm(struct uv__work* w) {
+  struct uv__write_file_work* fw;
+  size_t left;
+  off_t offset;
+  ssize_t n;
+  char* buf;
+
+  fw = container_of(w, struct uv__write_file_work, work);
+
+  buf = malloc(UV__READ_POOL_SIZE);
+  if (buf == NULL) {
+    fw->error = ENOMEM;
+    return;
+  }
+
+  offset = fw->offset;
+  left = fw->length;
+
+  while (left > 0) {
+    n = pread(fw->file,
+              buf,
+              left < UV__READ_POOL_SIZE ? left : UV__READ_POOL_SIZE,
+              offset);
+
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      fw->error = errno;
+      break;
+    }
+
+    if (n == 0) {
+      /* The file is shorter than the request. */
+      fw->error = EINVAL;
+      break;
+    }
+
+    offset += n;
+    left -= n;
+  }
+
+  free(buf);
+}
+
+
+static void uv__write_file_warm_done(struct uv__work* w, int status) {
+  struct uv__write_file_work* fw;
+  uv_stream_t* stream;
+  uv_write_t* req;
+
+  fw = container_of(w, struct uv__write_file_work, work);
+  req = fw->req;
+
+  /* The stream was closed in the meantime. */
+  if (req == NULL) {
+    free(fw);
+    return;
+  }
+
+  req->file_work = NULL;
+  stream = req->handle;
+
+  if (fw->error) {
+    req->error = fw->error;
+    stream->write_queue_size -= uv__write_req_size(req);
+    uv__write_req_finish(req);
+  } else {
+    req->file_cached = fw->length;
+  }
+
+  free(fw);
+  uv__write(stream);
+}
+
+
+/* Sends as much of the uv_write_file() request at the head of the queue as
+ * the stream takes. Parts of the file that aren't cached are read in on the
+ * thread pool first. Returns 1 when the request is done, 0 when the stream
+ * is full or the thread pool is busy with the file.
+ */
+static int uv__write_file(uv_stream_t* stream, uv_write_t* req) {
+  struct uv__write_file_work* fw;
+  size_t len;
+  ssize_t n;
+
+  if (req->file_work != NULL)
+    return 0;
+
+  while (req->file_length > 0) {
+    len = req->file_length;
+    if (len > UV__WRITE_FILE_CHUNK)
+      len = UV__WRITE_FILE_CHUNK;
+
+    if (req->file_cached == 0) {
+      if (!uv__write_file_cached(req->file, req->file_offset, len)) {
+        fw = malloc(sizeof(*fw));
+        if (fw == NULL) {
+          req->error = ENOMEM;
+          break;
+        }
+
+        fw->req = req;
+        fw->file = req->file;
+        fw->offset = req->file_offset;
+        fw->length = len;
+        fw->error = 0;
+
+        if (uv__work_submit(stream->loop,
+                            &fw->work,
+                            uv__write_file_warm,
+                            uv__write_file_warm_done)) {
+          free(fw);
+          req->error = ENOMEM;
+          break;
+        }
+
+        req->file_work = fw;
+        return 0;
+      }
+
+      req->file_cached = len;
+    }
+
+    if (len > req->file_cached)
+      len = req->file_cached;
+
+    stream->loop->counters.write_syscalls++;
+    n = eio_sendfile_sync(stream->fd, req->file, req->file_offset, len);
+
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN) {
+        stream->loop->counters.eagain++;
+        return 0;
+      }
+      req->error = errno;
+      break;
+    }
+
+    if (n == 0) {
+      /* The file is shorter than the request. */
+      req->error = EINVAL;
+      break;
+    }
+
+    stream->loop->counters.write_bytes += n;
+    req->file_offset += n;
+    req->file_length -= n;
+    req->file_cached -= n;
+    assert(stream->write_queue_size >= (size_t) n);
+    stream->write_queue_size -= n;
+  }
+
+  stream->write_queue_size -= req->file_length;
+  uv__write_req_finish(req);
+  return 1;
+}
+
+
+static int uv__write_held(uv_stream_t* stream) {
+  return stream->splice_to != NULL && stream->splice_to->pending > 0;
+}
+
+
+/* Writes out as much of the write queue as the socket accepts. The buffers
+ * of consecutive requests are coalesced into one writev() so that a burst
+ * of small uv_write() calls costs a single syscall.
  */
 static void uv__write(uv_stream_t* stream) {
+  struct iovec iovbuf[UV__IOV_MAX];
   uv_write_t* req;
   struct iovec* iov;
+  size_t nbytes;
+  size_t nwritten;
+  int zerocopy;
   int iovcnt;
+  int nreqs;
   ssize_t n;
+  int i;
 
   if (stream->flags & UV_CLOSING) {
     /* Handle was closed this tick. We've received a stale
@@ -348,6 +1012,20 @@ static void uv__write(uv_stream_t* stream) {
     return;
   }
 
+#if HAVE_SYS_IO_URING
+  /* The kernel is still working on the head of the queue. */
+  if (uv__iou_sending(stream))
+    return;
+#endif
+
+  /* A splice into the stream already took bytes from its source, those go
+   * out first. The splice restarts the queue once they're written.
+   */
+  if (uv__write_held(stream)) {
+    uv__stream_watcher_stop(stream, &stream->write_watcher);
+    return;
+  }
+
 start:
 
   assert(stream->fd >= 0);
@@ -361,13 +1039,47 @@ start:
 
   assert(req->handle == stream);
 
+  if (req->file != -1) {
+    if (uv__write_file(stream, req))
+      goto start;
+
+    /* Picked up again when the thread pool is done. */
+    if (req->file_work != NULL) {
+      uv__stream_watcher_stop(stream, &stream->write_watcher);
+      return;
+    }
+
+    if (stream->blocking)
+      goto start;
+
+    uv__stream_watcher_start(stream, &stream->write_watcher);
+    return;
+  }
+
   /*
    * Cast to iovec. We had to have our own uv_buf_t instead of iovec
    * because Windows's WSABUF is not an iovec.
    */
   assert(sizeof(uv_buf_t) == sizeof(struct iovec));
-  iov = (struct iovec*) &(req->bufs[req->write_index]);
-  iovcnt = req->bufcnt - req->write_index;
+
+  zerocopy = 0;
+#if HAVE_MSG_ZEROCOPY
+  /* Large writes go out on their own, straight from their buffers. */
+  if (stream->zerocopy != NULL && req->send_handle == NULL)
+    zerocopy = uv__zerocopy_wanted(stream, uv__write_req_size(req));
+#endif
+
+  if (zerocopy) {
+    iovcnt = req->bufcnt - req->write_index;
+    if (iovcnt > UV__IOV_MAX)
+      iovcnt = UV__IOV_MAX;
+
+    iov = (struct iovec*) &(req->bufs[req->write_index]);
+    nreqs = 1;
+    nbytes = uv__buf_count(req->bufs + req->write_index, iovcnt);
+  } else {
+    iovcnt = uv__write_gather(stream, iovbuf, &iov, &nreqs, &nbytes);
+  }
 
   /*
    * Now do the actual writev. Note that we've been updating the pointers
@@ -398,11 +1110,17 @@ start:
     *(int*) CMSG_DATA(cmsg) = fd_to_send;
 
     do {
+      stream->loop->counters.write_syscalls++;
       n = sendmsg(stream->fd, &msg, 0);
     }
     while (n == -1 && errno == EINTR);
+#if HAVE_MSG_ZEROCOPY
+  } else if (zerocopy) {
+    n = uv__zerocopy_send(stream, req, iov, iovcnt);
+#endif
   } else {
     do {
+      stream->loop->counters.write_syscalls++;
       if (iovcnt == 1) {
         n = write(stream->fd, iov[0].iov_base, iov[0].iov_len);
       } else {
@@ -419,68 +1137,119 @@ start:
       stream->write_queue_size -= uv__write_req_size(req);
       uv__write_req_finish(req);
       return;
-    } else if (stream->blocking) {
+    }
+
+    stream->loop->counters.eagain++;
+
+    if (stream->blocking) {
       /* If this is a blocking stream, try again. */
       goto start;
     }
   } else {
-    /* Successful write */
-
-    /* Update the counters. */
-    while (n >= 0) {
-      uv_buf_t* buf = &(req->bufs[req->write_index]);
-      size_t len = buf->len;
-
-      assert(req->write_index < req->bufcnt);
-
-      if ((size_t)n < len) {
-        buf->base += n;
-        buf->len -= n;
-        stream->write_queue_size -= n;
-        n = 0;
-
-        /* There is more to write. */
-        if (stream->blocking) {
-          /*
-           * If we're blocking then we should not be enabling the write
-           * watcher - instead we need to try again.
-           */
-          goto start;
-        } else {
-          /* Break loop and ensure the watcher is pending. */
-          break;
-        }
+    /* Successful write. Retire the buffers and the requests that went out,
+     * the completed ones are moved to the write_completed_queue.
+     */
+    nwritten = n;
+    stream->loop->counters.write_bytes += n;
+
+    for (i = 0; i < nreqs; i++) {
+      req = uv_write_queue_head(stream);
+      assert(req != NULL);
+
+      if (!uv__write_req_update(stream, req, &nwritten))
+        break;
+
+      uv__write_req_finish(req);
+    }
+
+    assert(nwritten == 0);
+
+    if ((size_t)n == nbytes) {
+      /* Everything we gathered was written. The queue may still hold
+       * requests that didn't fit in this batch, try to write those too.
+       */
+      goto start;
+    }
+
+    /* There is more to write. */
+    stream->loop->counters.partial_writes++;
+
+    if (stream->blocking) {
+      /*
+       * If we're blocking then we should not be enabling the write
+       * watcher - instead we need to try again.
+       */
+      goto start;
+    }
+  }
+
+  /* Only non-blocking streams should use the write_watcher. */
+  assert(!stream->blocking);
+
+#if HAVE_SYS_IO_URING
+  if (uv__write_iou(stream))
+    return;
+#endif
+
+  /* We're not done. */
+  uv__stream_watcher_start(stream, &stream->write_watcher);
+}
 
-      } else {
-        /* Finished writing the buf at index req->write_index. */
-        req->write_index++;
 
-        assert((size_t)n >= len);
-        n -= len;
+#if HAVE_SYS_IO_URING
+/* Called when the sendmsg op that uv__write_iou() submitted completes. */
+void uv__stream_iou_sent(uv_stream_t* stream, int res) {
+  uv_write_t* req;
+  size_t n;
 
-        assert(stream->write_queue_size >= len);
-        stream->write_queue_size -= len;
+  req = uv_write_queue_head(stream);
+  assert(req != NULL);
 
-        if (req->write_index == req->bufcnt) {
-          /* Then we're done! */
-          assert(n == 0);
-          uv__write_req_finish(req);
-          /* TODO: start trying to write the next request. */
-          return;
-        }
-      }
-    }
+  if (res > 0)
+    stream->loop->counters.write_bytes += res;
+
+  /* uv_close() cancelled the send. Report what the kernel managed to do and
+   * finish the close that uv__next() held back.
+   */
+  if (stream->flags & UV_CLOSING) {
+    n = res < 0 ? 0 : res;
+    if (res < 0)
+      req->error = -res;
+    else if (!uv__write_req_update(stream, req, &n))
+      req->error = ECANCELED;
+
+    ngx_queue_remove(&req->queue);
+    if (req->bufs != req->bufsml)
+      free(req->bufs);
+    req->bufs = NULL;
+
+    ngx_queue_insert_tail(&stream->write_completed_queue, &req->queue);
+    ev_idle_start(stream->loop->ev, &stream->next_watcher);
+    ev_feed_event(stream->loop->ev, &stream->next_watcher, EV_IDLE);
+    return;
   }
 
-  /* Either we've counted n down to zero or we've got EAGAIN. */
-  assert(n == 0 || n == -1);
+  if (res < 0) {
+    req->error = -res;
+    stream->write_queue_size -= uv__write_req_size(req);
+    uv__write_req_finish(req);
+    return;
+  }
 
-  /* Only non-blocking streams should use the write_watcher. */
-  assert(!stream->blocking);
+  n = res;
+  if (uv__write_req_update(stream, req, &n))
+    uv__write_req_finish(req);
+  assert(n == 0);
 
-  /* We're not done. */
-  ev_io_start(stream->loop->ev, &stream->write_watcher);
+  /* Callbacks are made from the write watcher, uv__write_req_finish()
+   * feeds it an event.
+   */
+  uv__write(stream);
+
+  if (!(stream->flags & UV_CLOSING))
+    uv__stream_watermarks(stream);
 }
+#endif
 
 
 static void uv__write_callbacks(uv_stream_t* stream) {
@@ -506,10 +1275,163 @@ static void uv__write_callbacks(uv_stream_t* stream) {
 
   assert(ngx_queue_empty(&stream->write_completed_queue));
 
+  /* A callback may have closed the stream. */
+  if (!(stream->flags & UV_CLOSING))
+    uv__stream_watermarks(stream);
+
   /* Write queue drained. */
   if (!uv_write_queue_head(stream)) {
     uv__drain(stream);
+
+    /* A splice into the stream waits for the queue to drain. */
+    if (stream->splice_to)
+      uv__splice_drained(stream->splice_to);
+  }
+}
+
+
+static ssize_t uv__stream_read(uv_stream_t* stream, char* buf, size_t len) {
+#if HAVE_SYS_IO_URING
+  if (stream->iou)
+    return uv__iou_read(stream, buf, len);
+#endif
+
+  stream->loop->counters.read_syscalls++;
+  return read(stream->fd, buf, len);
+}
+
+
+/* Returns 1 if data was received that uv__stream_read() hasn't returned. */
+static int uv__stream_readable(uv_stream_t* stream) {
+#if HAVE_SYS_IO_URING
+  if (stream->iou)
+    return uv__iou_readable(stream);
+#endif
+
+  return 0;
+}
+
+
+static void uv__read_unpark(uv_stream_t* stream) {
+  ngx_queue_remove(&stream->read_pool_queue);
+  stream->flags &= ~UV_READ_PARKED;
+}
+
+
+/* Takes a free buffer from the loop's read pool. When there is none, the
+ * stream stops reading and waits for uv_read_release().
+ */
+static int uv__read_pool_get(uv_stream_t* stream, uv_buf_t* buf) {
+  struct uv__read_pool* pool;
+  unsigned int i;
+
+  pool = stream->loop->read_pool;
+
+  if (pool->nfree == 0) {
+    uv__stream_watcher_stop(stream, &stream->read_watcher);
+    ngx_queue_insert_tail(&pool->parked, &stream->read_pool_queue);
+    stream->flags |= UV_READ_PARKED;
+    return -1;
+  }
+
+  i = pool->free[--pool->nfree];
+  *buf = uv_buf_init(pool->bufs + i * pool->size, pool->size);
+  return 0;
+}
+
+
+static void uv__read_pool_put(uv_loop_t* loop, char* base) {
+  struct uv__read_pool* pool;
+  uv_stream_t* stream;
+  ngx_queue_t* q;
+
+  pool = loop->read_pool;
+  assert(pool != NULL);
+  assert(base >= pool->bufs && base < pool->bufs + pool->nbufs * pool->size);
+  assert(pool->nfree < pool->nbufs);
+
+  pool->free[pool->nfree++] = (base - pool->bufs) / pool->size;
+
+  if (ngx_queue_empty(&pool->parked))
+    return;
+
+  q = ngx_queue_head(&pool->parked);
+  stream = ngx_queue_data(q, uv_stream_t, read_pool_queue);
+  uv__read_unpark(stream);
+
+  /* The data it was woken up for is most likely still there. */
+  uv__stream_watcher_start(stream, &stream->read_watcher);
+  ev_feed_event(loop->ev, &stream->read_watcher, EV_READ);
+}
+
+
+/* Reads into a pooled buffer. On EOF and errors, buf is left empty. Fails
+ * with ENOBUFS when the stream was parked.
+ */
+static ssize_t uv__stream_read_pool(uv_stream_t* stream, uv_buf_t* buf) {
+  ssize_t nread;
+
+#if HAVE_SYS_IO_URING
+  if (stream->iou)
+    return uv__iou_read_buf(stream, buf);
+#endif
+
+  if (uv__read_pool_get(stream, buf)) {
+    *buf = uv_buf_init(NULL, 0);
+    errno = ENOBUFS;
+    return -1;
+  }
+
+  do {
+    stream->loop->counters.read_syscalls++;
+    nread = read(stream->fd, buf->base, buf->len);
+  }
+  while (nread < 0 && errno == EINTR);
+
+  /* Nothing for the caller to hold on to, the buffer goes right back. */
+  if (nread <= 0) {
+    uv__read_pool_put(stream->loop, buf->base);
+    *buf = uv_buf_init(NULL, 0);
+  }
+
+  return nread;
+}
+
+
+/*
+ * Sizes the next alloc_cb suggestion after a read of `nread` bytes. A read
+ * that fills the suggestion doubles it. Two reads in a row that use less
+ * than half of it shrink it to fit the last one. Costs no system calls,
+ * unlike asking the kernel with FIONREAD before every read.
+ */
+static void uv__read_adapt(uv_stream_t* stream, size_t nread) {
+  size_t size;
+
+  if (nread >= stream->read_size) {
+    stream->flags &= ~UV_READ_SHORT;
+
+    if (stream->read_size < UV__READ_SIZE_MAX)
+      stream->read_size *= 2;
+
+    return;
+  }
+
+  if (nread >= stream->read_size / 2) {
+    stream->flags &= ~UV_READ_SHORT;
+    return;
+  }
+
+  if (!(stream->flags & UV_READ_SHORT)) {
+    stream->flags |= UV_READ_SHORT;
+    return;
   }
+
+  size = UV__READ_SIZE_MIN;
+  while (size < nread)
+    size *= 2;
+
+  stream->read_size = size;
+  stream->flags &= ~UV_READ_SHORT;
 }
 
 
@@ -519,23 +1441,31 @@ static void uv__read(uv_stream_t* stream) {
   struct msghdr msg;
   struct cmsghdr* cmsg;
   char cmsg_space[64];
-  struct ev_loop* ev = stream->loop->ev;
 
   /* XXX: Maybe instead of having UV_READING we just test if
    * tcp->read_cb is NULL or not?
    */
   while ((stream->read_cb || stream->read2_cb) &&
          stream->flags & UV_READING) {
-    assert(stream->alloc_cb);
-    buf = stream->alloc_cb((uv_handle_t*)stream, 64 * 1024);
+    if (!(stream->flags & UV_READ_POOL)) {
+      assert(stream->alloc_cb);
+      buf = stream->alloc_cb((uv_handle_t*)stream, stream->read_size);
+
+      assert(buf.len > 0);
+      assert(buf.base);
+    }
 
-    assert(buf.len > 0);
-    assert(buf.base);
     assert(stream->fd >= 0);
 
-    if (stream->read_cb) {
+    if (stream->flags & UV_READ_POOL) {
+      nread = uv__stream_read_pool(stream, &buf);
+
+      /* Parked, uv_read_release() picks the stream up again. */
+      if (nread == -1 && errno == ENOBUFS)
+        return;
+    } else if (stream->read_cb) {
       do {
-        nread = read(stream->fd, buf.base, buf.len);
+        nread = uv__stream_read(stream, buf.base, buf.len);
       }
       while (nread < 0 && errno == EINTR);
     } else {
@@ -551,6 +1481,7 @@ static void uv__read(uv_stream_t* stream) {
       msg.msg_control = (void *) cmsg_space;
 
       do {
+        stream->loop->counters.read_syscalls++;
         nread = recvmsg(stream->fd, &msg, 0);
       }
       while (nread < 0 && errno == EINTR);
@@ -561,8 +1492,10 @@ static void uv__read(uv_stream_t* stream) {
       /* Error */
       if (errno == EAGAIN) {
         /* Wait for the next one. */
+        stream->loop->counters.eagain++;
+
         if (stream->flags & UV_READING) {
-          ev_io_start(ev, &stream->read_watcher);
+          uv__stream_watcher_start(stream, &stream->read_watcher);
         }
         uv__set_sys_error(stream->loop, EAGAIN);
 
@@ -590,7 +1523,7 @@ static void uv__read(uv_stream_t* stream) {
     } else if (nread == 0) {
       /* EOF */
       uv__set_artificial_error(stream->loop, UV_EOF);
-      ev_io_stop(ev, &stream->read_watcher);
+      uv__stream_watcher_stop(stream, &stream->read_watcher);
 
       if (stream->read_cb) {
         stream->read_cb(stream, -1, buf);
@@ -602,6 +1535,11 @@ static void uv__read(uv_stream_t* stream) {
       /* Successful read */
       ssize_t buflen = buf.len;
 
+      stream->loop->counters.read_bytes += nread;
+
+      if (!(stream->flags & UV_READ_POOL))
+        uv__read_adapt(stream, nread);
+
       if (stream->read_cb) {
         stream->read_cb(stream, nread, buf);
       } else {
@@ -640,7 +1578,7 @@ static void uv__read(uv_stream_t* stream) {
       }
 
       /* Return if we didn't fill the buffer, there is no more data to read. */
-      if (nread < buflen) {
+      if (nread < buflen && !uv__stream_readable(stream)) {
         return;
       }
     }
@@ -671,8 +1609,13 @@ int uv_shutdown(uv_shutdown_t* req, uv_stream_t* stream, uv_shutdown_cb cb) {
 
   ((uv_handle_t*)stream)->flags |= UV_SHUTTING;
 
+#if HAVE_SYS_IO_URING
+  /* The write queue drains when the send completes, the shutdown follows. */
+  if (uv__iou_sending(stream))
+    return 0;
+#endif
 
-  ev_io_start(stream->loop->ev, &stream->write_watcher);
+  uv__stream_watcher_start(stream, &stream->write_watcher);
 
   return 0;
 }
@@ -732,7 +1675,7 @@ static void uv__stream_connect(uv_stream_t* stream) {
   }
 
   if (!error) {
-    ev_io_start(stream->loop->ev, &stream->read_watcher);
+    uv__stream_watcher_start(stream, &stream->read_watcher);
 
     /* Successful connection */
     stream->connect_req = NULL;
@@ -814,7 +1757,7 @@ int uv__connect(uv_connect_t* req, uv_stream_t* stream, struct sockaddr* addr,
   }
 
   assert(stream->write_watcher.data == stream);
-  ev_io_start(stream->loop->ev, &stream->write_watcher);
+  uv__stream_watcher_start(stream, &stream->write_watcher);
 
   if (stream->delayed_error) {
     ev_feed_event(stream->loop->ev, &stream->write_watcher, EV_WRITE);
@@ -824,10 +1767,53 @@ int uv__connect(uv_connect_t* req, uv_stream_t* stream, struct sockaddr* addr,
 }
 
 
-int uv_write2(uv_write_t* req, uv_stream_t* stream, uv_buf_t bufs[], int bufcnt,
-    uv_stream_t* send_handle, uv_write_cb cb) {
+/* Appends req to the write queue. If the queue was empty, the write is
+ * attempted right away, otherwise it waits for the fd to become writable.
+ */
+static void uv__write_enqueue(uv_stream_t* stream, uv_write_t* req,
+    size_t size) {
   int empty_queue;
 
+  empty_queue = (stream->write_queue_size == 0);
+  stream->write_queue_size += size;
+
+  /* Append the request to write_queue. */
+  ngx_queue_insert_tail(&stream->write_queue, &req->queue);
+
+  assert(!ngx_queue_empty(&stream->write_queue));
+  assert(stream->write_watcher.cb == uv__stream_io);
+  assert(stream->write_watcher.data == stream);
+  assert(stream->write_watcher.fd == stream->fd);
+
+  if (empty_queue) {
+    uv__write(stream);
+  } else {
+    /*
+     * blocking streams should never have anything in the queue.
+     * if this assert fires then somehow the blocking stream isn't being
+     * sufficently flushed in uv__write.
+     */
+    assert(!stream->blocking);
+
+#if HAVE_SYS_IO_URING
+    /* Picked up when the send that's in flight completes. */
+    if (uv__iou_sending(stream))
+      return;
+#endif
+
+    /* Picked up when the spliced bytes are written. */
+    if (uv__write_held(stream))
+      return;
+
+    uv__stream_watcher_start(stream, &stream->write_watcher);
+  }
+
+  uv__stream_watermarks(stream);
+}
+
+
+int uv_write2(uv_write_t* req, uv_stream_t* stream, uv_buf_t bufs[], int bufcnt,
+    uv_stream_t* send_handle, uv_write_cb cb) {
   assert((stream->type == UV_TCP || stream->type == UV_NAMED_PIPE ||
       stream->type == UV_TTY) &&
       "uv_write (unix) does not yet support other types of streams");
@@ -844,8 +1830,6 @@ int uv_write2(uv_write_t* req, uv_stream_t* stream, uv_buf_t bufs[], int bufcnt,
     }
   }
 
-  empty_queue = (stream->write_queue_size == 0);
-
   /* Initialize the req */
   uv__req_init(stream->loop, (uv_req_t*)req);
   req->cb = cb;
@@ -870,33 +1854,59 @@ int uv_write2(uv_write_t* req, uv_stream_t* stream, uv_buf_t bufs[], int bufcnt,
    */
 
   req->write_index = 0;
-  stream->write_queue_size += uv__buf_count(bufs, bufcnt);
+  req->file = -1;
+  req->file_offset = 0;
+  req->file_length = 0;
+  req->file_cached = 0;
+  req->file_work = NULL;
+  req->zerocopy_first = 0;
+  req->zerocopy_sends = 0;
+  req->zerocopy_pending = 0;
 
-  /* Append the request to write_queue. */
-  ngx_queue_insert_tail(&stream->write_queue, &req->queue);
+  uv__write_enqueue(stream, req, uv__buf_count(bufs, bufcnt));
 
-  assert(!ngx_queue_empty(&stream->write_queue));
-  assert(stream->write_watcher.cb == uv__stream_io);
-  assert(stream->write_watcher.data == stream);
-  assert(stream->write_watcher.fd == stream->fd);
+  return 0;
+}
 
-  /* If the queue was empty when this function began, we should attempt to
-   * do the write immediately. Otherwise start the write_watcher and wait
-   * for the fd to become writable.
-   */
-  if (empty_queue) {
-    uv__write(stream);
-  } else {
-    /*
-     * blocking streams should never have anything in the queue.
-     * if this assert fires then somehow the blocking stream isn't being
-     * sufficently flushed in uv__write.
-     */
-    assert(!stream->blocking);
 
-    ev_io_start(stream->loop->ev, &stream->write_watcher);
+int uv_write_file(uv_write_t* req, uv_stream_t* stream, uv_file file,
+    off_t offset, size_t length, uv_write_cb cb) {
+  assert((stream->type == UV_TCP || stream->type == UV_NAMED_PIPE ||
+      stream->type == UV_TTY) &&
+      "uv_write_file (unix) does not yet support other types of streams");
+
+  if (stream->fd < 0 || file < 0) {
+    uv__set_sys_error(stream->loop, EBADF);
+    return -1;
+  }
+
+  if (offset < 0) {
+    uv__set_sys_error(stream->loop, EINVAL);
+    return -1;
   }
 
+  uv__req_init(stream->loop, (uv_req_t*)req);
+  req->cb = cb;
+  req->handle = stream;
+  req->error = 0;
+  req->send_handle = NULL;
+  req->type = UV_WRITE;
+  ngx_queue_init(&req->queue);
+
+  req->bufs = req->bufsml;
+  req->bufcnt = 0;
+  req->write_index = 0;
+  req->file = file;
+  req->file_offset = offset;
+  req->file_length = length;
+  req->file_cached = 0;
+  req->file_work = NULL;
+  req->zerocopy_first = 0;
+  req->zerocopy_sends = 0;
+  req->zerocopy_pending = 0;
+
+  uv__write_enqueue(stream, req, length);
+
   return 0;
 }
 
@@ -910,8 +1920,65 @@ int uv_write(uv_write_t* req, uv_stream_t* stream, uv_buf_t bufs[], int bufcnt,
 }
 
 
+int uv_try_write(uv_stream_t* stream, uv_buf_t bufs[], int bufcnt) {
+  struct iovec* iov;
+  int iovcnt;
+  ssize_t n;
+
+  assert((stream->type == UV_TCP || stream->type == UV_NAMED_PIPE ||
+      stream->type == UV_TTY) &&
+      "uv_try_write (unix) does not yet support other types of streams");
+
+  if (stream->fd < 0) {
+    uv__set_sys_error(stream->loop, EBADF);
+    return -1;
+  }
+
+  /* Writing now would put the data in front of what's already queued, or
+   * in the middle of a splice into this stream.
+   */
+  if (!ngx_queue_empty(&stream->write_queue) || stream->splice_to != NULL) {
+    uv__set_sys_error(stream->loop, EAGAIN);
+    return -1;
+  }
+
+#if HAVE_SYS_IO_URING
+  if (uv__iou_sending(stream)) {
+    uv__set_sys_error(stream->loop, EAGAIN);
+    return -1;
+  }
+#endif
+
+  assert(sizeof(uv_buf_t) == sizeof(struct iovec));
+  iov = (struct iovec*) bufs;
+  iovcnt = bufcnt;
+  if (iovcnt > UV__IOV_MAX)
+    iovcnt = UV__IOV_MAX;
+
+  do {
+    stream->loop->counters.write_syscalls++;
+    if (iovcnt == 1) {
+      n = write(stream->fd, iov[0].iov_base, iov[0].iov_len);
+    } else {
+      n = writev(stream->fd, iov, iovcnt);
+    }
+  }
+  while (n == -1 && errno == EINTR);
+
+  if (n == -1) {
+    if (errno == EAGAIN)
+      stream->loop->counters.eagain++;
+    uv__set_sys_error(stream->loop, errno);
+    return -1;
+  }
+
+  stream->loop->counters.write_bytes += n;
+  return n;
+}
+
+
 int uv__read_start_common(uv_stream_t* stream, uv_alloc_cb alloc_cb,
-    uv_read_cb read_cb, uv_read2_cb read2_cb) {
+    uv_read_cb read_cb, uv_read2_cb read2_cb, int pool) {
   assert(stream->type == UV_TCP || stream->type == UV_NAMED_PIPE ||
       stream->type == UV_TTY);
 
@@ -920,17 +1987,36 @@ int uv__read_start_common(uv_stream_t* stream, uv_alloc_cb alloc_cb,
     return -1;
   }
 
+  /* A splice reads from the stream until it completes. */
+  if (stream->splice_from != NULL) {
+    uv__set_artificial_error(stream->loop, UV_EBUSY);
+    return -1;
+  }
+
   /* The UV_READING flag is irrelevant of the state of the tcp - it just
    * expresses the desired state of the user.
    */
   ((uv_handle_t*)stream)->flags |= UV_READING;
 
+  /* Only uv_read_start_pool() goes without an alloc callback, it makes sure
+   * that the loop has a read pool.
+   */
+  if (pool) {
+    assert(stream->loop->read_pool != NULL);
+    stream->flags |= UV_READ_POOL;
+  } else {
+    assert(alloc_cb != NULL);
+    stream->flags &= ~UV_READ_POOL;
+  }
+
+  if (stream->flags & UV_READ_PARKED)
+    uv__read_unpark(stream);
+
   /* TODO: try to do the read inline? */
   /* TODO: keep track of tcp state. If we've gotten a EOF then we should
    * not start the IO watcher.
    */
   assert(stream->fd >= 0);
-  assert(alloc_cb);
 
   stream->read_cb = read_cb;
   stream->read2_cb = read2_cb;
@@ -939,26 +2025,127 @@ int uv__read_start_common(uv_stream_t* stream, uv_alloc_cb alloc_cb,
   /* These should have been set by uv_tcp_init. */
   assert(stream->read_watcher.cb == uv__stream_io);
 
-  ev_io_start(stream->loop->ev, &stream->read_watcher);
+  uv__stream_watcher_start(stream, &stream->read_watcher);
   return 0;
 }
 
 
 int uv_read_start(uv_stream_t* stream, uv_alloc_cb alloc_cb,
     uv_read_cb read_cb) {
-  return uv__read_start_common(stream, alloc_cb, read_cb, NULL);
+  if (alloc_cb == NULL) {
+    uv__set_artificial_error(stream->loop, UV_EINVAL);
+    return -1;
+  }
+
+  return uv__read_start_common(stream, alloc_cb, read_cb, NULL, 0);
 }
 
 
 int uv_read2_start(uv_stream_t* stream, uv_alloc_cb alloc_cb,
     uv_read2_cb read_cb) {
-  return uv__read_start_common(stream, alloc_cb, NULL, read_cb);
+  if (alloc_cb == NULL) {
+    uv__set_artificial_error(stream->loop, UV_EINVAL);
+    return -1;
+  }
+
+  return uv__read_start_common(stream, alloc_cb, NULL, read_cb, 0);
+}
+
+
+int uv_read_start_pool(uv_stream_t* stream, uv_read_cb read_cb) {
+  if (stream->loop->read_pool == NULL &&
+      uv_loop_set_read_pool(stream->loop,
+                            UV__READ_POOL_NBUFS,
+                            UV__READ_POOL_SIZE)) {
+    return -1;
+  }
+
+  return uv__read_start_common(stream, NULL, read_cb, NULL, 1);
+}
+
+
+void uv_read_release(uv_loop_t* loop, uv_buf_t buf) {
+#if HAVE_SYS_IO_URING
+  if (uv__iou_buf_release(loop, buf.base) == 0)
+    return;
+#endif
+
+  uv__read_pool_put(loop, buf.base);
+}
+
+
+int uv_loop_set_read_pool(uv_loop_t* loop, unsigned int nbufs, size_t size) {
+  struct uv__read_pool* pool;
+  unsigned int i;
+
+  if (nbufs == 0 || size == 0) {
+    uv__set_artificial_error(loop, UV_EINVAL);
+    return -1;
+  }
+
+  pool = loop->read_pool;
+  if (pool != NULL && pool->nfree != pool->nbufs) {
+    uv__set_artificial_error(loop, UV_EBUSY);
+    return -1;
+  }
+
+  if (size > (size_t) -1 / nbufs) {
+    uv__set_sys_error(loop, ENOMEM);
+    return -1;
+  }
+
+  if ((pool = malloc(sizeof(*pool))) == NULL)
+    goto err;
+
+  /* Pages that are never read into aren't backed by memory. */
+  pool->bufs = malloc(nbufs * size);
+  pool->free = malloc(nbufs * sizeof(pool->free[0]));
+
+  if (pool->bufs == NULL || pool->free == NULL) {
+    free(pool->bufs);
+    free(pool->free);
+    free(pool);
+    goto err;
+  }
+
+  for (i = 0; i < nbufs; i++)
+    pool->free[i] = nbufs - 1 - i;
+
+  pool->size = size;
+  pool->nbufs = nbufs;
+  pool->nfree = nbufs;
+  ngx_queue_init(&pool->parked);
+
+  if (loop->read_pool)
+    uv__read_pool_destroy(loop);
+
+  loop->read_pool = pool;
+  return 0;
+
+err:
+  uv__set_sys_error(loop, ENOMEM);
+  return -1;
+}
+
+
+void uv__read_pool_destroy(uv_loop_t* loop) {
+  struct uv__read_pool* pool;
+
+  pool = loop->read_pool;
+  loop->read_pool = NULL;
+
+  free(pool->bufs);
+  free(pool->free);
+  free(pool);
 }
 
 
 int uv_read_stop(uv_stream_t* stream) {
-  ev_io_stop(stream->loop->ev, &stream->read_watcher);
-  stream->flags &= ~UV_READING;
+  if (stream->flags & UV_READ_PARKED)
+    uv__read_unpark(stream);
+
+  uv__stream_watcher_stop(stream, &stream->read_watcher);
+  stream->flags &= ~(UV_READING | UV_READ_POOL);
   stream->read_cb = NULL;
   stream->read2_cb = NULL;
   stream->alloc_cb = NULL;
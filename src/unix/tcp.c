@@ -33,6 +33,25 @@ int uv_tcp_init(uv_loop_t* loop, uv_tcp_t* tcp) {
 }
 
 
+static int uv__tcp_reuseport(uv_tcp_t* handle, int enable) {
+#if defined(UV__SO_REUSEPORT)
+  if (setsockopt(handle->fd,
+                 SOL_SOCKET,
+                 UV__SO_REUSEPORT,
+                 &enable,
+                 sizeof enable) == -1) {
+    uv__set_sys_error(handle->loop, errno);
+    return -1;
+  }
+
+  return 0;
+#else
+  uv__set_artificial_error(handle->loop, UV_ENOTSUP);
+  return -1;
+#endif
+}
+
+
 static int uv__bind(uv_tcp_t* tcp,
                     int domain,
                     struct sockaddr* addr,
@@ -55,6 +74,12 @@ static int uv__bind(uv_tcp_t* tcp,
       status = -2;
       goto out;
     }
+
+    if ((tcp->flags & UV_TCP_REUSEPORT) && uv__tcp_reuseport(tcp, 1)) {
+      uv__close(tcp->fd);
+      tcp->fd = -1;
+      goto out;
+    }
   }
 
   assert(tcp->fd >= 0);
@@ -200,7 +225,7 @@ int uv_tcp_listen(uv_tcp_t* tcp, int backlog, uv_connection_cb cb) {
   /* Start listening for connections. */
   ev_io_set(&tcp->read_watcher, tcp->fd, EV_READ);
   ev_set_cb(&tcp->read_watcher, uv__server_io);
-  ev_io_start(tcp->loop->ev, &tcp->read_watcher);
+  uv__stream_watcher_start((uv_stream_t*)tcp, &tcp->read_watcher);
 
   return 0;
 }
@@ -304,6 +329,16 @@ int uv_tcp_nodelay(uv_tcp_t* handle, int enable) {
 }
 
 
+int uv_tcp_zerocopy(uv_tcp_t* handle, int enable, size_t threshold) {
+#if HAVE_MSG_ZEROCOPY
+  return uv__zerocopy_set((uv_stream_t*)handle, enable, threshold);
+#else
+  uv__set_artificial_error(handle->loop, UV_ENOTSUP);
+  return -1;
+#endif
+}
+
+
 int uv_tcp_keepalive(uv_tcp_t* handle, int enable, unsigned int delay) {
   if (handle->fd != -1 && uv__tcp_keepalive(handle, enable, delay))
     return -1;
@@ -321,6 +356,24 @@ int uv_tcp_keepalive(uv_tcp_t* handle, int enable, unsigned int delay) {
 }
 
 
+int uv_tcp_reuseport(uv_tcp_t* handle, int enable) {
+#if defined(UV__SO_REUSEPORT)
+  if (handle->fd != -1 && uv__tcp_reuseport(handle, enable))
+    return -1;
+
+  if (enable)
+    handle->flags |= UV_TCP_REUSEPORT;
+  else
+    handle->flags &= ~UV_TCP_REUSEPORT;
+
+  return 0;
+#else
+  uv__set_artificial_error(handle->loop, UV_ENOTSUP);
+  return -1;
+#endif
+}
+
+
 int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
   return 0;
 }
@@ -0,0 +1,629 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Thread pool for fs, work and getaddrinfo requests.
+ *
+ * A loop submits work to the pool it's attached to: the one that was passed
+ * to uv_loop_set_threadpool() or, failing that, a process-wide default pool
+ * that's created on first use. Finished work is put on the done queue of
+ * the loop that submitted it and the loop is woken up with an ev_async.
+ * Loops never look at each other's done queues.
+ *
+ * Every worker thread owns a queue with its own lock. Loops hand out work
+ * round-robin so submitters rarely contend with each other or with more
+ * than one worker. A worker takes work from the front of its own queue.
+ * When that's empty, it steals from the back of another worker's queue
+ * before it goes to sleep. Thieves only ever trylock a victim, so stealing
+ * never makes the victim or a submitter wait for the thief.
+ *
+ * Each queue has an interactive and a bulk lane. Interactive requests are
+ * always taken first and at most max_bulk bulk requests run at the same
+ * time, so an interactive request never waits for more than max_bulk bulk
+ * requests. A worker whose bulk lane is stalled because all slots are taken
+ * marks itself as stalled and sleeps. When a bulk request finishes while
+ * others are waiting, all stalled workers are woken up to compete for the
+ * slot; the losers go back to sleep.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#define UV__THREADPOOL_DEFAULT_SIZE 4
+
+/*
+ * How many other workers a submitter checks for a sleeping one when the
+ * worker that it queued to is busy.
+ */
+#define UV__THREADPOOL_WAKE_PROBES 4
+
+
+struct uv__worker {
+  uv_mutex_t mutex;
+  pthread_cond_t cond;
+  ngx_queue_t queue[2]; /* Indexed by uv_lane_t. */
+  int idle;   /* Sleeping in pthread_cond_wait(). */
+  int wakeup; /* Woken up to steal work. */
+  int bulk_wakeup; /* Woken up because a bulk slot was freed. */
+  int stalled; /* Waits for a bulk slot, guarded by pool->mutex. */
+  int stop;
+  uv_threadpool_t* pool;
+  uv_thread_t thread;
+};
+
+
+struct uv_threadpool_s {
+  uv_mutex_t mutex; /* Guards nloops and the bulk counters. */
+  unsigned int nloops;
+  unsigned int max_bulk;
+  unsigned int nbulk;        /* Bulk requests that are running. */
+  unsigned int nbulk_queued; /* Bulk requests that are waiting. */
+  unsigned int nstalled;     /* Workers that wait for a bulk slot. */
+  unsigned int nworkers;
+  struct uv__worker* workers;
+};
+
+
+static uv_threadpool_t* default_pool;
+static uv_once_t default_pool_once = UV_ONCE_INIT;
+
+
+/* Stands in for the work function of requests that were cancelled. */
+static void uv__work_cancelled(struct uv__work* w) {
+  abort();
+}
+
+
+/*
+ * Takes a bulk slot for a request on `worker`'s bulk lane. When there is
+ * none, the worker is marked stalled so the next uv__bulk_release() wakes
+ * it up. Must be called with worker->mutex held.
+ */
+static int uv__bulk_acquire(struct uv__worker* worker) {
+  uv_threadpool_t* pool;
+  int r;
+
+  pool = worker->pool;
+
+  uv_mutex_lock(&pool->mutex);
+  r = -1;
+  if (pool->nbulk < pool->max_bulk) {
+    pool->nbulk++;
+    pool->nbulk_queued--;
+    r = 0;
+  } else if (!worker->stalled) {
+    worker->stalled = 1;
+    pool->nstalled++;
+  }
+  uv_mutex_unlock(&pool->mutex);
+
+  return r;
+}
+
+
+/*
+ * Gives back a bulk slot. If bulk requests are waiting for it, every
+ * stalled worker is woken up. A worker that stalls after its scan does so
+ * because someone else took the slot, and that one's release wakes it.
+ */
+static void uv__bulk_release(uv_threadpool_t* pool) {
+  struct uv__worker* worker;
+  unsigned int i;
+  int stalled;
+  int wake;
+
+  uv_mutex_lock(&pool->mutex);
+  pool->nbulk--;
+  wake = (pool->nbulk_queued > 0 && pool->nstalled > 0);
+  uv_mutex_unlock(&pool->mutex);
+
+  if (!wake)
+    return;
+
+  for (i = 0; i < pool->nworkers; i++) {
+    worker = pool->workers + i;
+
+    /* Same lock order as uv__bulk_acquire(): worker first, then pool. */
+    uv_mutex_lock(&worker->mutex);
+    uv_mutex_lock(&pool->mutex);
+    stalled = worker->stalled;
+    if (stalled) {
+      worker->stalled = 0;
+      pool->nstalled--;
+    }
+    uv_mutex_unlock(&pool->mutex);
+
+    if (stalled) {
+      worker->bulk_wakeup = 1;
+      pthread_cond_signal(&worker->cond);
+    }
+    uv_mutex_unlock(&worker->mutex);
+  }
+}
+
+
+/*
+ * Takes the next request off `worker`'s queue, interactive lane first.
+ * The owner takes from the front, thieves from the back. Must be called
+ * with worker->mutex held.
+ */
+static struct uv__work* uv__worker_take(struct uv__worker* worker, int steal) {
+  struct uv__work* w;
+  ngx_queue_t* h;
+  ngx_queue_t* q;
+
+  h = &worker->queue[UV_LANE_INTERACTIVE];
+
+  if (ngx_queue_empty(h)) {
+    h = &worker->queue[UV_LANE_BULK];
+
+    if (ngx_queue_empty(h) || uv__bulk_acquire(worker))
+      return NULL;
+  }
+
+  q = steal ? ngx_queue_last(h) : ngx_queue_head(h);
+  ngx_queue_remove(q);
+  w = ngx_queue_data(q, struct uv__work, wq);
+  w->worker = NULL;
+
+  return w;
+}
+
+
+static struct uv__work* uv__worker_steal(struct uv__worker* self) {
+  uv_threadpool_t* pool;
+  struct uv__worker* victim;
+  struct uv__work* w;
+  unsigned int i;
+
+  pool = self->pool;
+
+  for (i = 1; i < pool->nworkers; i++) {
+    victim = pool->workers + (self - pool->workers + i) % pool->nworkers;
+
+    if (uv_mutex_trylock(&victim->mutex))
+      continue;
+
+    w = uv__worker_take(victim, 1);
+    uv_mutex_unlock(&victim->mutex);
+
+    if (w)
+      return w;
+  }
+
+  return NULL;
+}
+
+
+static void uv__worker_run(void* arg) {
+  struct uv__worker* self;
+  struct uv__work* w;
+  uv_loop_t* loop;
+  int stalled;
+
+  self = arg;
+
+  for (;;) {
+    uv_mutex_lock(&self->mutex);
+
+    if (self->stop) {
+      uv_mutex_unlock(&self->mutex);
+      break;
+    }
+
+    self->bulk_wakeup = 0;
+    w = uv__worker_take(self, 0);
+    stalled = (w == NULL && !ngx_queue_empty(&self->queue[UV_LANE_BULK]));
+    uv_mutex_unlock(&self->mutex);
+
+    if (w == NULL)
+      w = uv__worker_steal(self);
+
+    if (w == NULL) {
+      uv_mutex_lock(&self->mutex);
+      self->wakeup = 0;
+      while (ngx_queue_empty(&self->queue[UV_LANE_INTERACTIVE]) &&
+             (ngx_queue_empty(&self->queue[UV_LANE_BULK]) ||
+              (stalled && !self->bulk_wakeup)) &&
+             !self->wakeup &&
+             !self->stop) {
+        self->idle = 1;
+        pthread_cond_wait(&self->cond, &self->mutex);
+        self->idle = 0;
+      }
+      uv_mutex_unlock(&self->mutex);
+      continue;
+    }
+
+    w->work(w);
+
+    if (w->lane == UV_LANE_BULK)
+      uv__bulk_release(self->pool);
+
+    /*
+     * Wake up the loop before letting go of the lock. Once the request is
+     * done the loop may exit and be deleted at any time.
+     */
+    loop = w->loop;
+    uv_mutex_lock(&loop->wq_mutex);
+    ngx_queue_insert_tail(&loop->wq, &w->wq);
+    ev_async_send(loop->ev, &loop->wq_async);
+    uv_mutex_unlock(&loop->wq_mutex);
+  }
+}
+
+
+/* Called from the loop thread when one or more requests have finished. */
+static void uv__work_done(EV_P_ ev_async* watcher, int revents) {
+  uv_loop_t* uv_loop;
+  struct uv__work* w;
+  ngx_queue_t wq;
+  ngx_queue_t* q;
+
+  uv_loop = watcher->data;
+
+  uv_mutex_lock(&uv_loop->wq_mutex);
+  if (ngx_queue_empty(&uv_loop->wq)) {
+    ngx_queue_init(&wq);
+  } else {
+    q = ngx_queue_head(&uv_loop->wq);
+    ngx_queue_split(&uv_loop->wq, q, &wq);
+  }
+  uv_mutex_unlock(&uv_loop->wq_mutex);
+
+  while (!ngx_queue_empty(&wq)) {
+    q = ngx_queue_head(&wq);
+    ngx_queue_remove(q);
+
+    w = ngx_queue_data(q, struct uv__work, wq);
+    uv_loop->counters.work_pending--;
+    w->done(w, w->work == uv__work_cancelled ? UV_ECANCELED : 0);
+  }
+}
+
+
+static int uv__worker_init(struct uv__worker* worker, uv_threadpool_t* pool) {
+  worker->pool = pool;
+  worker->idle = 0;
+  worker->wakeup = 0;
+  worker->bulk_wakeup = 0;
+  worker->stalled = 0;
+  worker->stop = 0;
+  ngx_queue_init(&worker->queue[UV_LANE_INTERACTIVE]);
+  ngx_queue_init(&worker->queue[UV_LANE_BULK]);
+
+  if (uv_mutex_init(&worker->mutex))
+    return -1;
+
+  if (pthread_cond_init(&worker->cond, NULL)) {
+    uv_mutex_destroy(&worker->mutex);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+static void uv__worker_destroy(struct uv__worker* worker) {
+  pthread_cond_destroy(&worker->cond);
+  uv_mutex_destroy(&worker->mutex);
+}
+
+
+static void uv__worker_stop(struct uv__worker* worker) {
+  uv_mutex_lock(&worker->mutex);
+  worker->stop = 1;
+  pthread_cond_signal(&worker->cond);
+  uv_mutex_unlock(&worker->mutex);
+}
+
+
+/* Stops and joins the first `nthreads` threads and frees the pool. */
+static void uv__threadpool_destroy(uv_threadpool_t* pool,
+                                   unsigned int nthreads) {
+  unsigned int i;
+
+  for (i = 0; i < nthreads; i++)
+    uv__worker_stop(pool->workers + i);
+
+  for (i = 0; i < nthreads; i++)
+    uv_thread_join(&pool->workers[i].thread);
+
+  for (i = 0; i < pool->nworkers; i++)
+    uv__worker_destroy(pool->workers + i);
+
+  uv_mutex_destroy(&pool->mutex);
+  free(pool->workers);
+  free(pool);
+}
+
+
+uv_threadpool_t* uv_threadpool_new(unsigned int nthreads) {
+  return uv_threadpool_new2(nthreads, (nthreads + 1) / 2);
+}
+
+
+uv_threadpool_t* uv_threadpool_new2(unsigned int nthreads,
+                                    unsigned int max_bulk) {
+  uv_threadpool_t* pool;
+  unsigned int i;
+
+  if (nthreads == 0 || max_bulk == 0)
+    return NULL;
+
+  if ((pool = calloc(1, sizeof(*pool))) == NULL)
+    return NULL;
+
+  pool->max_bulk = max_bulk < nthreads ? max_bulk : nthreads;
+
+  if ((pool->workers = calloc(nthreads, sizeof(pool->workers[0]))) == NULL)
+    goto err_free;
+
+  if (uv_mutex_init(&pool->mutex))
+    goto err_free;
+
+  /* Workers look at each other's queues, set them all up before starting. */
+  for (i = 0; i < nthreads; i++) {
+    if (uv__worker_init(pool->workers + i, pool)) {
+      uv__threadpool_destroy(pool, 0);
+      return NULL;
+    }
+    pool->nworkers++;
+  }
+
+  for (i = 0; i < nthreads; i++) {
+    if (uv_thread_create(&pool->workers[i].thread,
+                         uv__worker_run,
+                         pool->workers + i)) {
+      uv__threadpool_destroy(pool, i);
+      return NULL;
+    }
+  }
+
+  return pool;
+
+err_free:
+  free(pool->workers);
+  free(pool);
+  return NULL;
+}
+
+
+void uv_threadpool_delete(uv_threadpool_t* pool) {
+  assert(pool != default_pool);
+  assert(pool->nloops == 0);
+  uv__threadpool_destroy(pool, pool->nworkers);
+}
+
+
+static void uv__threadpool_attach(uv_loop_t* loop, uv_threadpool_t* pool) {
+  assert(loop->threadpool == NULL);
+
+  uv_mutex_lock(&pool->mutex);
+  pool->nloops++;
+  uv_mutex_unlock(&pool->mutex);
+
+  loop->threadpool = pool;
+  loop->counters.threadpool_init++;
+
+  ev_async_init(&loop->wq_async, uv__work_done);
+  loop->wq_async.data = loop;
+  ev_async_start(loop->ev, &loop->wq_async);
+  /* Outstanding requests keep the loop alive, the watcher itself doesn't. */
+  ev_unref(loop->ev);
+}
+
+
+int uv_loop_set_threadpool(uv_loop_t* loop, uv_threadpool_t* pool) {
+  if (pool == NULL) {
+    uv__set_artificial_error(loop, UV_EINVAL);
+    return -1;
+  }
+
+  if (loop->threadpool) {
+    uv__set_artificial_error(loop, UV_EBUSY);
+    return -1;
+  }
+
+  uv__threadpool_attach(loop, pool);
+  return 0;
+}
+
+
+static void uv__threadpool_default_init(void) {
+  default_pool = uv_threadpool_new(UV__THREADPOOL_DEFAULT_SIZE);
+}
+
+
+int uv__work_submit(uv_loop_t* loop,
+                    struct uv__work* w,
+                    void (*work)(struct uv__work* w),
+                    void (*done)(struct uv__work* w, int status)) {
+  uv_threadpool_t* pool;
+  struct uv__worker* worker;
+  unsigned int i;
+  int idle;
+
+  if (loop->threadpool == NULL) {
+    uv_once(&default_pool_once, uv__threadpool_default_init);
+
+    if (default_pool == NULL) {
+      uv__set_sys_error(loop, ENOMEM);
+      return -1;
+    }
+
+    uv__threadpool_attach(loop, default_pool);
+  }
+
+  w->loop = loop;
+  w->work = work;
+  w->done = done;
+  w->lane = loop->wq_lane;
+
+  pool = loop->threadpool;
+  worker = pool->workers + loop->wq_next++ % pool->nworkers;
+
+  if (w->lane == UV_LANE_BULK) {
+    uv_mutex_lock(&pool->mutex);
+    pool->nbulk_queued++;
+    uv_mutex_unlock(&pool->mutex);
+  }
+
+  uv_mutex_lock(&worker->mutex);
+  ngx_queue_insert_tail(&worker->queue[w->lane], &w->wq);
+  w->worker = worker;
+  idle = worker->idle;
+  if (idle)
+    pthread_cond_signal(&worker->cond);
+  uv_mutex_unlock(&worker->mutex);
+
+  if (++loop->counters.work_pending > loop->counters.work_pending_max)
+    loop->counters.work_pending_max = loop->counters.work_pending;
+
+  if (idle)
+    return 0;
+
+  /* The worker is busy. Wake up a sleeping neighbour to steal the work. */
+  for (i = 1; i <= UV__THREADPOOL_WAKE_PROBES && i < pool->nworkers; i++) {
+    worker = pool->workers + (loop->wq_next + i - 1) % pool->nworkers;
+
+    if (uv_mutex_trylock(&worker->mutex))
+      continue;
+
+    idle = worker->idle;
+    if (idle) {
+      worker->wakeup = 1;
+      pthread_cond_signal(&worker->cond);
+    }
+    uv_mutex_unlock(&worker->mutex);
+
+    if (idle)
+      break;
+  }
+
+  return 0;
+}
+
+
+static int uv__work_cancel(uv_loop_t* loop, struct uv__work* w) {
+  uv_threadpool_t* pool;
+  struct uv__worker* worker;
+  unsigned int i;
+  int found;
+
+  pool = loop->threadpool;
+  found = 0;
+
+  /*
+   * Requests only ever leave a queue, they don't move between queues, so
+   * it's enough to look at each queue once.
+   */
+  for (i = 0; pool != NULL && i < pool->nworkers && !found; i++) {
+    worker = pool->workers + i;
+
+    uv_mutex_lock(&worker->mutex);
+    if (w->worker == worker) {
+      ngx_queue_remove(&w->wq);
+      w->worker = NULL;
+      found = 1;
+
+      if (w->lane == UV_LANE_BULK) {
+        uv_mutex_lock(&pool->mutex);
+        pool->nbulk_queued--;
+        uv_mutex_unlock(&pool->mutex);
+      }
+    }
+    uv_mutex_unlock(&worker->mutex);
+  }
+
+  if (!found) {
+    uv__set_artificial_error(loop, UV_EBUSY);
+    return -1;
+  }
+
+  w->work = uv__work_cancelled;
+
+  uv_mutex_lock(&loop->wq_mutex);
+  ngx_queue_insert_tail(&loop->wq, &w->wq);
+  uv_mutex_unlock(&loop->wq_mutex);
+
+  ev_async_send(loop->ev, &loop->wq_async);
+
+  return 0;
+}
+
+
+int uv_cancel(uv_req_t* req) {
+  switch (req->type) {
+    case UV_FS:
+      return uv__work_cancel(((uv_fs_t*) req)->loop,
+                             &((uv_fs_t*) req)->work_req);
+    case UV_WORK:
+      return uv__work_cancel(((uv_work_t*) req)->loop,
+                             &((uv_work_t*) req)->work_req);
+    case UV_GETADDRINFO:
+      return uv__work_cancel(((uv_getaddrinfo_t*) req)->loop,
+                             &((uv_getaddrinfo_t*) req)->work_req);
+    default:
+      uv__set_artificial_error(uv__req_loop(req), UV_EINVAL);
+      return -1;
+  }
+}
+
+
+void uv_loop_set_lane(uv_loop_t* loop, uv_lane_t lane) {
+  assert(lane == UV_LANE_INTERACTIVE || lane == UV_LANE_BULK);
+  loop->wq_lane = lane;
+}
+
+
+int uv__threadpool_loop_init(uv_loop_t* loop) {
+  loop->threadpool = NULL;
+  loop->wq_next = 0;
+  loop->wq_lane = UV_LANE_INTERACTIVE;
+  ngx_queue_init(&loop->wq);
+  return uv_mutex_init(&loop->wq_mutex);
+}
+
+
+void uv__threadpool_loop_delete(uv_loop_t* loop) {
+  uv_threadpool_t* pool;
+
+  pool = loop->threadpool;
+
+  if (pool) {
+    ev_ref(loop->ev);
+    ev_async_stop(loop->ev, &loop->wq_async);
+
+    uv_mutex_lock(&pool->mutex);
+    pool->nloops--;
+    uv_mutex_unlock(&pool->mutex);
+
+    loop->threadpool = NULL;
+  }
+
+  uv_mutex_destroy(&loop->wq_mutex);
+}
@@ -0,0 +1,327 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Hierarchical timing wheel for loops created with UV_LOOP_TIMER_WHEEL.
+ *
+ * Timers are hashed on their due time in milliseconds into one of five
+ * levels of buckets. The first level has one bucket per millisecond for the
+ * next 256 ms. Each of the four levels above it has 64 buckets that each
+ * span 64 times the range of a bucket one level down. When the first level
+ * wraps around, the next bucket of the level above is emptied and its timers
+ * are redistributed ("cascaded") into the levels below.
+ *
+ * Starting and stopping a timer is a list insert or remove. A single ev_timer
+ * per loop drives the wheel; it's armed for the next non-empty bucket on the
+ * first level or, failing that, for the next cascade.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#define TVN_BITS  6
+#define TVR_BITS  8
+#define TVN_SIZE  (1 << TVN_BITS)
+#define TVR_SIZE  (1 << TVR_BITS)
+#define TVN_MASK  (TVN_SIZE - 1)
+#define TVR_MASK  (TVR_SIZE - 1)
+
+/* Timeouts beyond this (about 49 days) are clamped. */
+#define MAX_TVAL  ((int64_t)0xFFFFFFFF)
+
+#define INDEX(time, n) \
+  ((int)(((time) >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK))
+
+
+struct uv__timer_wheel {
+  ev_timer driver;
+  int64_t time;     /* Next tick to be processed. */
+  int64_t armed;    /* Tick the driver fires at, if it's active. */
+  unsigned int nactive;
+  ngx_queue_t tv1[TVR_SIZE];
+  ngx_queue_t tv2[TVN_SIZE];
+  ngx_queue_t tv3[TVN_SIZE];
+  ngx_queue_t tv4[TVN_SIZE];
+  ngx_queue_t tv5[TVN_SIZE];
+};
+
+
+static void uv__timer_wheel_add(struct uv__timer_wheel* wheel,
+                                uv_timer_t* timer) {
+  ngx_queue_t* vec;
+  int64_t expires;
+  int64_t idx;
+
+  expires = timer->timer_due;
+  idx = expires - wheel->time;
+
+  if (idx < 0) {
+    /* Already expired, run it on the next tick. */
+    vec = &wheel->tv1[wheel->time & TVR_MASK];
+  } else if (idx < TVR_SIZE) {
+    vec = &wheel->tv1[expires & TVR_MASK];
+  } else if (idx < 1 << (TVR_BITS + TVN_BITS)) {
+    vec = &wheel->tv2[INDEX(expires, 0)];
+  } else if (idx < 1 << (TVR_BITS + 2 * TVN_BITS)) {
+    vec = &wheel->tv3[INDEX(expires, 1)];
+  } else if (idx < 1 << (TVR_BITS + 3 * TVN_BITS)) {
+    vec = &wheel->tv4[INDEX(expires, 2)];
+  } else {
+    if (idx > MAX_TVAL) {
+      expires = wheel->time + MAX_TVAL;
+      timer->timer_due = expires;
+    }
+    vec = &wheel->tv5[INDEX(expires, 3)];
+  }
+
+  ngx_queue_insert_tail(vec, &timer->timer_queue);
+}
+
+
+/* Moves the timers in bucket `index` of level `tv` one or more levels down.
+ * Returns the index so the caller knows when the level wrapped around.
+ */
+static int uv__timer_wheel_cascade(struct uv__timer_wheel* wheel,
+                                   ngx_queue_t* tv,
+                                   int index) {
+  ngx_queue_t* q;
+
+  while (!ngx_queue_empty(&tv[index])) {
+    q = ngx_queue_head(&tv[index]);
+    ngx_queue_remove(q);
+    uv__timer_wheel_add(wheel, ngx_queue_data(q, uv_timer_t, timer_queue));
+  }
+
+  return index;
+}
+
+
+/* Runs all timers that are due at or before `now`. */
+static void uv__timer_wheel_run(struct uv__timer_wheel* wheel, int64_t now) {
+  ngx_queue_t work;
+  ngx_queue_t* q;
+  uv_timer_t* timer;
+  int index;
+
+  while (now >= wheel->time) {
+    if (wheel->nactive == 0) {
+      wheel->time = now + 1;
+      break;
+    }
+
+    index = wheel->time & TVR_MASK;
+
+    if (index == 0 &&
+        uv__timer_wheel_cascade(wheel, wheel->tv2, INDEX(wheel->time, 0)) == 0 &&
+        uv__timer_wheel_cascade(wheel, wheel->tv3, INDEX(wheel->time, 1)) == 0 &&
+        uv__timer_wheel_cascade(wheel, wheel->tv4, INDEX(wheel->time, 2)) == 0) {
+      uv__timer_wheel_cascade(wheel, wheel->tv5, INDEX(wheel->time, 3));
+    }
+
+    wheel->time++;
+
+    if (ngx_queue_empty(&wheel->tv1[index]))
+      continue;
+
+    /* Detach the bucket first, callbacks may start timers that hash to it. */
+    ngx_queue_init(&work);
+    ngx_queue_add(&work, &wheel->tv1[index]);
+    ngx_queue_init(&wheel->tv1[index]);
+
+    while (!ngx_queue_empty(&work)) {
+      q = ngx_queue_head(&work);
+      ngx_queue_remove(q);
+
+      timer = ngx_queue_data(q, uv_timer_t, timer_queue);
+
+      if (timer->timer_repeat) {
+        /* Re-arm relative to the old due time so repeating timers don't
+         * drift but never schedule it for a tick that's being processed.
+         */
+        timer->timer_due += timer->timer_repeat;
+        if (timer->timer_due <= now)
+          timer->timer_due = now + 1;
+        uv__timer_wheel_add(wheel, timer);
+      } else {
+        timer->flags &= ~UV_TIMER_ACTIVE;
+        wheel->nactive--;
+      }
+
+      if (timer->timer_cb)
+        timer->timer_cb(timer, 0);
+    }
+  }
+}
+
+
+/* Returns the tick the driver should fire at next. Only the first level is
+ * scanned; if it has nothing before the next cascade, wake up for that.
+ */
+static int64_t uv__timer_wheel_next(struct uv__timer_wheel* wheel) {
+  int index;
+  int i;
+
+  index = wheel->time & TVR_MASK;
+
+  for (i = index; i < TVR_SIZE; i++)
+    if (!ngx_queue_empty(&wheel->tv1[i]))
+      return wheel->time + (i - index);
+
+  return wheel->time + (TVR_SIZE - index);
+}
+
+
+static void uv__timer_wheel_arm(uv_loop_t* loop, int64_t due) {
+  struct uv__timer_wheel* wheel;
+  int64_t timeout;
+
+  wheel = loop->timer_wheel;
+  timeout = due - uv_now(loop);
+
+  if (timeout < 0)
+    timeout = 0;
+
+  if (ev_is_active(&wheel->driver)) {
+    ev_ref(loop->ev);
+    ev_timer_stop(loop->ev, &wheel->driver);
+  }
+
+  /* The driver doesn't keep the loop alive, the timers do that. */
+  ev_timer_set(&wheel->driver, timeout / 1000.0, 0.);
+  ev_timer_start(loop->ev, &wheel->driver);
+  ev_unref(loop->ev);
+
+  wheel->armed = due;
+}
+
+
+static void uv__timer_wheel_cb(EV_P_ ev_timer* w, int revents) {
+  struct uv__timer_wheel* wheel;
+  uv_loop_t* uv_loop;
+
+  uv_loop = w->data;
+  wheel = uv_loop->timer_wheel;
+  assert(w == &wheel->driver);
+
+  /* The driver just stopped, give back the ref it held. */
+  ev_ref(EV_A);
+
+  uv__timer_wheel_run(wheel, uv_now(uv_loop));
+
+  /* Callbacks may have armed the driver for a timer they started but the
+   * next one due can be an older timer, always re-arm.
+   */
+  if (wheel->nactive > 0)
+    uv__timer_wheel_arm(uv_loop, uv__timer_wheel_next(wheel));
+}
+
+
+int uv__timer_wheel_init(uv_loop_t* loop) {
+  struct uv__timer_wheel* wheel;
+  int i;
+
+  if ((wheel = malloc(sizeof(*wheel))) == NULL)
+    return -1;
+
+  for (i = 0; i < TVR_SIZE; i++) {
+    ngx_queue_init(&wheel->tv1[i]);
+  }
+
+  for (i = 0; i < TVN_SIZE; i++) {
+    ngx_queue_init(&wheel->tv2[i]);
+    ngx_queue_init(&wheel->tv3[i]);
+    ngx_queue_init(&wheel->tv4[i]);
+    ngx_queue_init(&wheel->tv5[i]);
+  }
+
+  ev_init(&wheel->driver, uv__timer_wheel_cb);
+  wheel->driver.data = loop;
+  wheel->time = uv_now(loop);
+  wheel->armed = 0;
+  wheel->nactive = 0;
+
+  loop->timer_wheel = wheel;
+
+  return 0;
+}
+
+
+void uv__timer_wheel_destroy(uv_loop_t* loop) {
+  struct uv__timer_wheel* wheel;
+
+  wheel = loop->timer_wheel;
+
+  if (ev_is_active(&wheel->driver)) {
+    ev_ref(loop->ev);
+    ev_timer_stop(loop->ev, &wheel->driver);
+  }
+
+  free(wheel);
+  loop->timer_wheel = NULL;
+}
+
+
+void uv__timer_wheel_start(uv_timer_t* timer, int64_t timeout) {
+  struct uv__timer_wheel* wheel;
+  uv_loop_t* loop;
+  int64_t now;
+
+  loop = timer->loop;
+  wheel = loop->timer_wheel;
+  now = uv_now(loop);
+
+  assert(!(timer->flags & UV_TIMER_ACTIVE));
+
+  /* Nothing is pending, fast-forward instead of walking the idle ticks. */
+  if (wheel->nactive == 0)
+    wheel->time = now;
+
+  timer->timer_due = now + (timeout > 0 ? timeout : 0);
+  timer->flags |= UV_TIMER_ACTIVE;
+  wheel->nactive++;
+
+  uv__timer_wheel_add(wheel, timer);
+
+  if (!ev_is_active(&wheel->driver) || timer->timer_due < wheel->armed)
+    uv__timer_wheel_arm(loop, timer->timer_due);
+}
+
+
+void uv__timer_wheel_stop(uv_timer_t* timer) {
+  struct uv__timer_wheel* wheel;
+
+  if (!(timer->flags & UV_TIMER_ACTIVE))
+    return;
+
+  wheel = timer->loop->timer_wheel;
+
+  ngx_queue_remove(&timer->timer_queue);
+  timer->flags &= ~UV_TIMER_ACTIVE;
+  wheel->nactive--;
+
+  /* Leave the driver alone, a spurious wakeup is cheaper than finding
+   * out when the next timer is due.
+   */
+}
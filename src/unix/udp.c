@@ -26,6 +26,13 @@
 #include <string.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <sys/ioctl.h>
+
+/* Largest possible UDP payload, the slot size for batched receives. */
+#define UV__UDP_DGRAM_MAXSIZE (64 * 1024)
+
+/* Upper bound for the number of datagrams read per recvmmsg() call. */
+#define UV__MMSG_MAXWIDTH 64
 
 
 static void uv__udp_watcher_start(uv_udp_t* handle, ev_io* w);
@@ -113,12 +120,101 @@ void uv__udp_destroy(uv_udp_t* handle) {
 }
 
 
+#if HAVE_SYS_SENDMMSG
+/* Cleared when the kernel turns out not to implement sendmmsg(). */
+static int uv__sendmmsg_avail = 1;
+
+
+/* Flushes the pending queue with sendmmsg(), up to UV__MMSG_MAXWIDTH
+ * datagrams per system call. Returns -1 if sendmmsg() is not supported,
+ * nothing has been sent in that case.
+ */
+static int uv__udp_run_pending_mmsg(uv_udp_t* handle) {
+  struct uv__mmsghdr h[UV__MMSG_MAXWIDTH];
+  uv_udp_send_t* req;
+  ngx_queue_t* q;
+  int npkts;
+  int nsent;
+  int i;
+
+  while (!ngx_queue_empty(&handle->write_queue)) {
+    npkts = 0;
+
+    ngx_queue_foreach(q, &handle->write_queue) {
+      if (npkts == UV__MMSG_MAXWIDTH)
+        break;
+
+      req = ngx_queue_data(q, uv_udp_send_t, queue);
+      assert(req != NULL);
+
+      memset(&h[npkts], 0, sizeof h[npkts]);
+      h[npkts].msg_hdr.msg_name = &req->addr;
+      h[npkts].msg_hdr.msg_namelen = req->addrlen;
+      h[npkts].msg_hdr.msg_iov = (struct iovec*)req->bufs;
+      h[npkts].msg_hdr.msg_iovlen = req->bufcnt;
+      npkts++;
+    }
+
+    do {
+      handle->loop->counters.write_syscalls++;
+      nsent = sys_sendmmsg(handle->fd, h, npkts, 0);
+    }
+    while (nsent == -1 && errno == EINTR);
+
+    if (nsent == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        handle->loop->counters.eagain++;
+        break;
+      }
+
+      if (errno == ENOSYS) {
+        uv__sendmmsg_avail = 0;
+        return -1;
+      }
+
+      /* The datagram at the head of the queue failed, report it and
+       * carry on with the next one.
+       */
+      req = ngx_queue_data(ngx_queue_head(&handle->write_queue),
+                           uv_udp_send_t,
+                           queue);
+      req->status = -errno;
+      ngx_queue_remove(&req->queue);
+      ngx_queue_insert_tail(&handle->write_completed_queue, &req->queue);
+      continue;
+    }
+
+    /* The first nsent datagrams went out. If that's less than npkts, the
+     * next one either would block or failed. The next sendmmsg() call
+     * tells us which.
+     */
+    for (i = 0; i < nsent; i++) {
+      req = ngx_queue_data(ngx_queue_head(&handle->write_queue),
+                           uv_udp_send_t,
+                           queue);
+      req->status = h[i].msg_len;
+      handle->loop->counters.write_bytes += h[i].msg_len;
+      ngx_queue_remove(&req->queue);
+      ngx_queue_insert_tail(&handle->write_completed_queue, &req->queue);
+    }
+  }
+
+  return 0;
+}
+#endif /* HAVE_SYS_SENDMMSG */
+
+
 static void uv__udp_run_pending(uv_udp_t* handle) {
   uv_udp_send_t* req;
   ngx_queue_t* q;
   struct msghdr h;
   ssize_t size;
 
+#if HAVE_SYS_SENDMMSG
+  if (uv__sendmmsg_avail && uv__udp_run_pending_mmsg(handle) == 0)
+    return;
+#endif
+
   while (!ngx_queue_empty(&handle->write_queue)) {
     q = ngx_queue_head(&handle->write_queue);
     assert(q != NULL);
@@ -133,6 +229,7 @@ static void uv__udp_run_pending(uv_udp_t* handle) {
     h.msg_iovlen = req->bufcnt;
 
     do {
+      handle->loop->counters.write_syscalls++;
       size = sendmsg(handle->fd, &h, 0);
     }
     while (size == -1 && errno == EINTR);
@@ -140,8 +237,13 @@ static void uv__udp_run_pending(uv_udp_t* handle) {
     /* TODO try to write once or twice more in the
      * hope that the socket becomes readable again?
      */
-    if (size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    if (size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      handle->loop->counters.eagain++;
       break;
+    }
+
+    if (size != -1)
+      handle->loop->counters.write_bytes += size;
 
     req->status = (size == -1 ? -errno : size);
 
@@ -202,22 +304,170 @@ static void uv__udp_run_completed(uv_udp_t* handle) {
 }
 
 
+#if HAVE_SYS_RECVMMSG
+/* Reads up to `chunks` datagrams into the slots of buf with a single
+ * recvmmsg() call and passes them to recv_cb, followed by one last callback that hands
+ * buf back to the user.
+ *
+ * Returns the number of datagrams read or -1 on error. If errno is ENOSYS,
+ * recv_cb has not been called and buf is still owned by the caller.
+ */
+static int uv__udp_recvmmsg(uv_udp_t* handle,
+                            uv_buf_t buf,
+                            unsigned int chunks) {
+  struct sockaddr_storage peers[UV__MMSG_MAXWIDTH];
+  struct uv__mmsghdr msgs[UV__MMSG_MAXWIDTH];
+  struct iovec iov[UV__MMSG_MAXWIDTH];
+  uv_udp_recv_cb recv_cb;
+  unsigned int flags;
+  int nread;
+  int i;
+
+  assert(chunks > 1);
+  assert(chunks <= UV__MMSG_MAXWIDTH);
+
+  memset(msgs, 0, chunks * sizeof msgs[0]);
+
+  for (i = 0; i < (int)chunks; i++) {
+    iov[i].iov_base = buf.base + i * UV__UDP_DGRAM_MAXSIZE;
+    iov[i].iov_len = UV__UDP_DGRAM_MAXSIZE;
+    msgs[i].msg_hdr.msg_name = &peers[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof peers[i];
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  do {
+    handle->loop->counters.read_syscalls++;
+    nread = sys_recvmmsg(handle->fd, msgs, chunks, 0, NULL);
+  }
+  while (nread == -1 && errno == EINTR);
+
+  if (nread == -1) {
+    if (errno == ENOSYS)
+      return -1;
+
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      handle->loop->counters.eagain++;
+      uv__set_sys_error(handle->loop, EAGAIN);
+      SAVE_ERRNO(handle->recv_cb(handle, 0, buf, NULL, 0));
+    }
+    else {
+      uv__set_sys_error(handle->loop, errno);
+      SAVE_ERRNO(handle->recv_cb(handle, -1, buf, NULL, 0));
+    }
+
+    return -1;
+  }
+
+  /* recv_cb may stop or close the handle halfway through the batch but the
+   * buffer must be handed back regardless, hold on to the callback.
+   */
+  recv_cb = handle->recv_cb;
+
+  for (i = 0; i < nread; i++)
+    handle->loop->counters.read_bytes += msgs[i].msg_len;
+
+  for (i = 0; i < nread && handle->recv_cb != NULL; i++) {
+    flags = UV_UDP_MMSG_CHUNK;
+
+    if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+      flags |= UV_UDP_PARTIAL;
+
+    handle->recv_cb(handle,
+                    msgs[i].msg_len,
+                    uv_buf_init(iov[i].iov_base, iov[i].iov_len),
+                    (struct sockaddr*)&peers[i],
+                    flags);
+  }
+
+  recv_cb(handle, 0, buf, NULL, 0);
+
+  return nread;
+}
+#endif /* HAVE_SYS_RECVMMSG */
+
+
+/* Returns the size of the next datagram, or an upper bound for it. Linux
+ * reports the size of the datagram at the head of the queue, elsewhere
+ * FIONREAD counts all queued bytes. Only the first datagram of a wakeup is
+ * sized like this, a probe per datagram would double the system calls of a
+ * busy socket.
+ */
+static size_t uv__udp_next_size(uv_udp_t* handle) {
+  int n;
+
+  if (ioctl(handle->fd, FIONREAD, &n) == -1)
+    return UV__UDP_DGRAM_MAXSIZE;
+
+  /* Nothing queued, or an empty datagram. */
+  if (n <= 0)
+    return 1;
+
+  if (n > UV__UDP_DGRAM_MAXSIZE)
+    return UV__UDP_DGRAM_MAXSIZE;
+
+  return n;
+}
+
+
 static void uv__udp_recvmsg(uv_udp_t* handle) {
   struct sockaddr_storage peer;
   struct msghdr h;
   ssize_t nread;
   uv_buf_t buf;
+  size_t size;
+  int probe;
   int flags;
+#if HAVE_SYS_RECVMMSG
+  unsigned int chunks;
+#endif
 
   assert(handle->recv_cb != NULL);
   assert(handle->alloc_cb != NULL);
 
+  probe = 1;
+
   do {
-    /* FIXME: hoist alloc_cb out the loop but for now follow uv__read() */
-    buf = handle->alloc_cb((uv_handle_t*)handle, 64 * 1024);
+    /* FIXME: hoist alloc_cb out the loop but for now follow uv__read()
+     * Batches need room for the largest datagram in every slot. The size of
+     * the datagrams after the first one isn't known, they get the maximum.
+     */
+    if (handle->recv_nmsgs > 1) {
+      size = handle->recv_nmsgs * UV__UDP_DGRAM_MAXSIZE;
+    } else if (probe) {
+      size = uv__udp_next_size(handle);
+      probe = 0;
+    } else {
+      size = UV__UDP_DGRAM_MAXSIZE;
+    }
+
+    buf = handle->alloc_cb((uv_handle_t*)handle, size);
     assert(buf.len > 0);
     assert(buf.base != NULL);
 
+#if HAVE_SYS_RECVMMSG
+    chunks = buf.len / UV__UDP_DGRAM_MAXSIZE;
+    if (chunks > handle->recv_nmsgs)
+      chunks = handle->recv_nmsgs;
+
+    if (chunks > 1) {
+      nread = uv__udp_recvmmsg(handle, buf, chunks);
+
+      /* A short batch means the socket's receive queue has been drained,
+       * no need to find that out with another system call.
+       */
+      if (nread >= 0 && (unsigned int)nread < chunks)
+        break;
+
+      if (nread != -1 || errno != ENOSYS)
+        continue;
+
+      /* Kernel doesn't support recvmmsg(), don't try again. */
+      handle->recv_nmsgs = 1;
+    }
+#endif
+
     memset(&h, 0, sizeof h);
     h.msg_name = &peer;
     h.msg_namelen = sizeof peer;
@@ -225,12 +475,14 @@ static void uv__udp_recvmsg(uv_udp_t* handle) {
     h.msg_iovlen = 1;
 
     do {
+      handle->loop->counters.read_syscalls++;
       nread = recvmsg(handle->fd, &h, 0);
     }
     while (nread == -1 && errno == EINTR);
 
     if (nread == -1) {
       if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        handle->loop->counters.eagain++;
         uv__set_sys_error(handle->loop, EAGAIN);
         handle->recv_cb(handle, 0, buf, NULL, 0);
       }
@@ -240,6 +492,7 @@ static void uv__udp_recvmsg(uv_udp_t* handle) {
       }
     }
     else {
+      handle->loop->counters.read_bytes += nread;
       flags = 0;
 
       if (h.msg_flags & MSG_TRUNC)
@@ -312,7 +565,7 @@ static int uv__bind(uv_udp_t* handle,
   fd = -1;
 
   /* Check for bad flags. */
-  if (flags & ~UV_UDP_IPV6ONLY) {
+  if (flags & ~(UV_UDP_IPV6ONLY | UV_UDP_REUSEPORT)) {
     uv__set_sys_error(handle->loop, EINVAL);
     goto out;
   }
@@ -347,6 +600,19 @@ static int uv__bind(uv_udp_t* handle,
 #endif
   }
 
+  if (flags & UV_UDP_REUSEPORT) {
+#if defined(UV__SO_REUSEPORT)
+    yes = 1;
+    if (setsockopt(fd, SOL_SOCKET, UV__SO_REUSEPORT, &yes, sizeof yes) == -1) {
+      uv__set_sys_error(handle->loop, errno);
+      goto out;
+    }
+#else
+    uv__set_sys_error(handle->loop, ENOTSUP);
+    goto out;
+#endif
+  }
+
   if (bind(fd, addr, len) == -1) {
     uv__set_sys_error(handle->loop, errno);
     goto out;
@@ -436,6 +702,47 @@ static int uv__udp_send(uv_udp_send_t* req,
 }
 
 
+static int uv__udp_try_send(uv_udp_t* handle,
+                            uv_buf_t bufs[],
+                            int bufcnt,
+                            struct sockaddr* addr,
+                            socklen_t addrlen) {
+  struct msghdr h;
+  ssize_t size;
+
+  /* Don't let the datagram overtake the ones that are already queued. */
+  if (!ngx_queue_empty(&handle->write_queue)) {
+    uv__set_sys_error(handle->loop, EAGAIN);
+    return -1;
+  }
+
+  if (uv__udp_maybe_deferred_bind(handle, addr->sa_family))
+    return -1;
+
+  memset(&h, 0, sizeof h);
+  h.msg_name = addr;
+  h.msg_namelen = addrlen;
+  h.msg_iov = (struct iovec*)bufs;
+  h.msg_iovlen = bufcnt;
+
+  do {
+    handle->loop->counters.write_syscalls++;
+    size = sendmsg(handle->fd, &h, 0);
+  }
+  while (size == -1 && errno == EINTR);
+
+  if (size == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      handle->loop->counters.eagain++;
+    uv__set_sys_error(handle->loop, errno);
+    return -1;
+  }
+
+  handle->loop->counters.write_bytes += size;
+  return size;
+}
+
+
 int uv_udp_init(uv_loop_t* loop, uv_udp_t* handle) {
   memset(handle, 0, sizeof *handle);
 
@@ -567,6 +874,30 @@ int uv_udp_send6(uv_udp_send_t* req,
 }
 
 
+int uv_udp_try_send(uv_udp_t* handle,
+                    uv_buf_t bufs[],
+                    int bufcnt,
+                    struct sockaddr_in addr) {
+  return uv__udp_try_send(handle,
+                          bufs,
+                          bufcnt,
+                          (struct sockaddr*)&addr,
+                          sizeof addr);
+}
+
+
+int uv_udp_try_send6(uv_udp_t* handle,
+                     uv_buf_t bufs[],
+                     int bufcnt,
+                     struct sockaddr_in6 addr) {
+  return uv__udp_try_send(handle,
+                          bufs,
+                          bufcnt,
+                          (struct sockaddr*)&addr,
+                          sizeof addr);
+}
+
+
 int uv_udp_recv_start(uv_udp_t* handle,
                       uv_alloc_cb alloc_cb,
                       uv_udp_recv_cb recv_cb) {
@@ -585,12 +916,36 @@ int uv_udp_recv_start(uv_udp_t* handle,
 
   handle->alloc_cb = alloc_cb;
   handle->recv_cb = recv_cb;
+  handle->recv_nmsgs = 1;
   uv__udp_watcher_start(handle, &handle->read_watcher);
 
   return 0;
 }
 
 
+int uv_udp_recv_start_batch(uv_udp_t* handle,
+                            uv_alloc_cb alloc_cb,
+                            uv_udp_recv_cb recv_cb,
+                            unsigned int nmsgs) {
+  if (nmsgs == 0) {
+    uv__set_artificial_error(handle->loop, UV_EINVAL);
+    return -1;
+  }
+
+  if (uv_udp_recv_start(handle, alloc_cb, recv_cb))
+    return -1;
+
+#if HAVE_SYS_RECVMMSG
+  if (nmsgs > UV__MMSG_MAXWIDTH)
+    nmsgs = UV__MMSG_MAXWIDTH;
+
+  handle->recv_nmsgs = nmsgs;
+#endif
+
+  return 0;
+}
+
+
 int uv_udp_recv_stop(uv_udp_t* handle) {
   uv__udp_watcher_stop(handle, &handle->read_watcher);
   handle->alloc_cb = NULL;
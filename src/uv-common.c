@@ -134,6 +134,33 @@ uv_err_t uv__new_artificial_error(uv_err_code code) {
 }
 
 
+/* The loop that errors about a request are reported on. Requests that don't
+ * know their loop report on the default loop.
+ */
+uv_loop_t* uv__req_loop(uv_req_t* req) {
+  switch (req->type) {
+    case UV_CONNECT:
+      return ((uv_connect_t*) req)->handle->loop;
+    case UV_WRITE:
+      return ((uv_write_t*) req)->handle->loop;
+    case UV_SHUTDOWN:
+      return ((uv_shutdown_t*) req)->handle->loop;
+    case UV_UDP_SEND:
+      return ((uv_udp_send_t*) req)->handle->loop;
+    case UV_FS:
+      return ((uv_fs_t*) req)->loop;
+    case UV_WORK:
+      return ((uv_work_t*) req)->loop;
+    case UV_GETADDRINFO:
+      return ((uv_getaddrinfo_t*) req)->loop;
+    case UV_SPLICE:
+      return ((uv_splice_t*) req)->src->loop;
+    default:
+      return uv_default_loop();
+  }
+}
+
+
 uv_err_t uv_last_error(uv_loop_t* loop) {
   return loop->last_err;
 }
@@ -228,6 +255,49 @@ int uv_ares_handles_empty(uv_loop_t* loop) {
   return loop->uv_ares_handles_ ? 0 : 1;
 }
 
+void uv__stream_init_watermarks(uv_stream_t* stream) {
+  stream->watermark_cb = NULL;
+  stream->write_low_watermark = 0;
+  stream->write_high_watermark = 0;
+  stream->write_above_high = 0;
+}
+
+
+int uv_stream_set_watermarks(uv_stream_t* stream, size_t low, size_t high,
+    uv_watermark_cb cb) {
+  if (cb != NULL && low > high) {
+    uv__set_artificial_error(stream->loop, UV_EINVAL);
+    return -1;
+  }
+
+  stream->watermark_cb = cb;
+  stream->write_low_watermark = low;
+  stream->write_high_watermark = high;
+  stream->write_above_high = (stream->write_queue_size > high);
+
+  return 0;
+}
+
+
+/* Called by the backends whenever write_queue_size may have crossed a
+ * watermark.
+ */
+void uv__stream_watermarks(uv_stream_t* stream) {
+  if (stream->watermark_cb == NULL)
+    return;
+
+  if (!stream->write_above_high &&
+      stream->write_queue_size > stream->write_high_watermark) {
+    stream->write_above_high = 1;
+    stream->watermark_cb(stream, 1);
+  } else if (stream->write_above_high &&
+             stream->write_queue_size <= stream->write_low_watermark) {
+    stream->write_above_high = 0;
+    stream->watermark_cb(stream, 0);
+  }
+}
+
+
 int uv_tcp_bind(uv_tcp_t* handle, struct sockaddr_in addr) {
   if (handle->type != UV_TCP || addr.sin_family != AF_INET) {
     uv__set_artificial_error(handle->loop, UV_EFAULT);
@@ -339,3 +409,102 @@ int uv_thread_create(uv_thread_t *tid, void (*entry)(void *arg), void *arg) {
 
   return 0;
 }
+
+
+static void uv__tcp_shard_close(uv_tcp_shard_t* shard) {
+  uv_close((uv_handle_t*)&shard->server, NULL);
+  uv_close((uv_handle_t*)&shard->stop_async, NULL);
+}
+
+
+static void uv__tcp_shard_delete(uv_tcp_shard_t* shard) {
+  /* Finish the close callbacks before the loop goes away. */
+  uv_run(shard->loop);
+  uv_loop_delete(shard->loop);
+  shard->loop = NULL;
+}
+
+
+static void uv__tcp_shard_stop_cb(uv_async_t* handle, int status) {
+  uv__tcp_shard_close((uv_tcp_shard_t*)handle->data);
+}
+
+
+static void uv__tcp_shard_run(void* arg) {
+  uv_tcp_shard_t* shard = arg;
+  uv_run(shard->loop);
+}
+
+
+uv_err_t uv_tcp_shards_start(uv_tcp_shard_t* shards, int count,
+    struct sockaddr_in addr, int backlog, uv_connection_cb cb) {
+  uv_tcp_shard_t* shard;
+  uv_err_t err;
+  int started;
+  int n;
+  int i;
+
+  if (count <= 0)
+    return uv__new_artificial_error(UV_EINVAL);
+
+  /* Bind all listeners up front so that errors are reported here. */
+  for (n = 0; n < count; n++) {
+    shard = shards + n;
+
+    if ((shard->loop = uv_loop_new()) == NULL) {
+      err = uv__new_artificial_error(UV_ENOMEM);
+      goto error;
+    }
+
+    uv_tcp_init(shard->loop, &shard->server);
+    uv_async_init(shard->loop, &shard->stop_async, uv__tcp_shard_stop_cb);
+    shard->server.data = shard;
+    shard->stop_async.data = shard;
+
+    if (uv_tcp_reuseport(&shard->server, 1) ||
+        uv_tcp_bind(&shard->server, addr) ||
+        uv_listen((uv_stream_t*)&shard->server, backlog, cb)) {
+      err = uv_last_error(shard->loop);
+      uv__tcp_shard_close(shard);
+      uv__tcp_shard_delete(shard);
+      goto error;
+    }
+  }
+
+  for (started = 0; started < count; started++) {
+    shard = shards + started;
+
+    if (uv_thread_create(&shard->thread, uv__tcp_shard_run, shard)) {
+      uv_tcp_shards_stop(shards, started);
+      for (i = started; i < count; i++) {
+        uv__tcp_shard_close(shards + i);
+        uv__tcp_shard_delete(shards + i);
+      }
+      return uv__new_artificial_error(UV_ENOMEM);
+    }
+  }
+
+  return uv_ok_;
+
+error:
+  for (i = 0; i < n; i++) {
+    uv__tcp_shard_close(shards + i);
+    uv__tcp_shard_delete(shards + i);
+  }
+
+  return err;
+}
+
+
+void uv_tcp_shards_stop(uv_tcp_shard_t* shards, int count) {
+  int i;
+
+  for (i = 0; i < count; i++)
+    uv_async_send(&shards[i].stop_async);
+
+  for (i = 0; i < count; i++) {
+    uv_thread_join(&shards[i].thread);
+    uv_loop_delete(shards[i].loop);
+    shards[i].loop = NULL;
+  }
+}
@@ -57,6 +57,11 @@ void uv__set_artificial_error(uv_loop_t* loop, uv_err_code code);
 uv_err_t uv__new_sys_error(int sys_error);
 uv_err_t uv__new_artificial_error(uv_err_code code);
 
+uv_loop_t* uv__req_loop(uv_req_t* req);
+
+void uv__stream_init_watermarks(uv_stream_t* stream);
+void uv__stream_watermarks(uv_stream_t* stream);
+
 int uv__tcp_bind(uv_tcp_t* handle, struct sockaddr_in addr);
 int uv__tcp_bind6(uv_tcp_t* handle, struct sockaddr_in6 addr);
 
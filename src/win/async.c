@@ -125,3 +125,16 @@ void uv_process_async_wakeup_req(uv_loop_t* loop, uv_async_t* handle,
     uv_want_endgame(loop, (uv_handle_t*)handle);
   }
 }
+
+
+int uv_channel_init(uv_loop_t* loop, uv_channel_t* handle,
+    uv_channel_cb channel_cb) {
+  uv__set_artificial_error(loop, UV_ENOTSUP);
+  return -1;
+}
+
+
+int uv_channel_send(uv_channel_t* handle, uv_channel_msg_t* msg) {
+  /* Can't set errno because that's not thread-safe. */
+  return -1;
+}
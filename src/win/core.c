@@ -128,6 +128,14 @@ uv_loop_t* uv_loop_new(void) {
 }
 
 
+uv_loop_t* uv_loop_new2(unsigned int flags) {
+  /* Timers are kept in a tree already and I/O goes through a completion
+   * port. UV_LOOP_TIMER_WHEEL and UV_LOOP_EPOLL are ignored.
+   */
+  return uv_loop_new();
+}
+
+
 void uv_loop_delete(uv_loop_t* loop) {
   if (loop != &uv_default_loop_) {
     free(loop);
@@ -140,6 +148,12 @@ int uv_loop_refcount(const uv_loop_t* loop) {
 }
 
 
+void uv_loop_metrics(uv_loop_t* loop, uv_loop_metrics_t* metrics) {
+  /* Not collected yet. */
+  memset(metrics, 0, sizeof *metrics);
+}
+
+
 void uv_ref(uv_loop_t* loop) {
   loop->refs++;
 }
@@ -1392,6 +1392,9 @@ void uv_process_pipe_write_req(uv_loop_t* loop, uv_pipe_t* handle,
     }
   }
 
+  if (!(handle->flags & UV_HANDLE_CLOSING))
+    uv__stream_watermarks((uv_stream_t*) handle);
+
   handle->write_reqs_pending--;
 
   if (handle->flags & UV_HANDLE_NON_OVERLAPPED_PIPE &&
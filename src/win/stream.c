@@ -20,6 +20,7 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 
 #include "uv.h"
 #include "../uv-common.h"
@@ -30,6 +31,7 @@ void uv_stream_init(uv_loop_t* loop, uv_stream_t* handle) {
   handle->write_queue_size = 0;
   handle->loop = loop;
   handle->flags = 0;
+  uv__stream_init_watermarks(handle);
 
   loop->counters.handle_init++;
   loop->counters.stream_init++;
@@ -76,8 +78,18 @@ int uv_accept(uv_stream_t* server, uv_stream_t* client) {
 }
 
 
+int uv_stream_set_accept_batch(uv_stream_t* server, unsigned int n) {
+  return 0;
+}
+
+
 int uv_read_start(uv_stream_t* handle, uv_alloc_cb alloc_cb,
     uv_read_cb read_cb) {
+  if (alloc_cb == NULL) {
+    uv__set_artificial_error(handle->loop, UV_EINVAL);
+    return -1;
+  }
+
   switch (handle->type) {
     case UV_TCP:
       return uv_tcp_read_start((uv_tcp_t*)handle, alloc_cb, read_cb);
@@ -94,6 +106,11 @@ int uv_read_start(uv_stream_t* handle, uv_alloc_cb alloc_cb,
 
 int uv_read2_start(uv_stream_t* handle, uv_alloc_cb alloc_cb,
     uv_read2_cb read_cb) {
+  if (alloc_cb == NULL) {
+    uv__set_artificial_error(handle->loop, UV_EINVAL);
+    return -1;
+  }
+
   switch (handle->type) {
     case UV_NAMED_PIPE:
       return uv_pipe_read2_start((uv_pipe_t*)handle, alloc_cb, read_cb);
@@ -104,6 +121,49 @@ int uv_read2_start(uv_stream_t* handle, uv_alloc_cb alloc_cb,
 }
 
 
+#define UV__READ_POOL_SIZE (64 * 1024)
+
+
+static uv_buf_t uv__read_pool_alloc(uv_handle_t* handle,
+    size_t suggested_size) {
+  return uv_buf_init((char*) malloc(UV__READ_POOL_SIZE), UV__READ_POOL_SIZE);
+}
+
+
+static void uv__read_pool_cb(uv_stream_t* handle, ssize_t nread,
+    uv_buf_t buf) {
+  /* Only buffers with data in them are handed to the user. */
+  if (nread <= 0) {
+    free(buf.base);
+    buf = uv_buf_init(NULL, 0);
+  }
+
+  handle->pool_read_cb(handle, nread, buf);
+}
+
+
+/* There is no pool on windows, the buffers are allocated as reads complete. */
+int uv_read_start_pool(uv_stream_t* handle, uv_read_cb read_cb) {
+  handle->pool_read_cb = read_cb;
+  return uv_read_start(handle, uv__read_pool_alloc, uv__read_pool_cb);
+}
+
+
+void uv_read_release(uv_loop_t* loop, uv_buf_t buf) {
+  free(buf.base);
+}
+
+
+int uv_loop_set_read_pool(uv_loop_t* loop, unsigned int nbufs, size_t size) {
+  if (nbufs == 0 || size == 0) {
+    uv__set_artificial_error(loop, UV_EINVAL);
+    return -1;
+  }
+
+  return 0;
+}
+
+
 int uv_read_stop(uv_stream_t* handle) {
   if (handle->type == UV_TTY) {
     return uv_tty_read_stop((uv_tty_t*) handle);
@@ -114,37 +174,74 @@ int uv_read_stop(uv_stream_t* handle) {
 }
 
 
+int uv_stream_splice(uv_splice_t* req, uv_stream_t* src, uv_stream_t* dst,
+    uv_splice_cb cb) {
+  uv__set_artificial_error(src->loop, UV_ENOSYS);
+  return -1;
+}
+
+
+int uv_write_file(uv_write_t* req, uv_stream_t* handle, uv_file file,
+    off_t offset, size_t length, uv_write_cb cb) {
+  uv__set_artificial_error(handle->loop, UV_ENOSYS);
+  return -1;
+}
+
+
+int uv_try_write(uv_stream_t* handle, uv_buf_t bufs[], int bufcnt) {
+  /* Writes always go through the completion port. */
+  uv__set_artificial_error(handle->loop, UV_EAGAIN);
+  return -1;
+}
+
+
 int uv_write(uv_write_t* req, uv_stream_t* handle, uv_buf_t bufs[], int bufcnt,
     uv_write_cb cb) {
   uv_loop_t* loop = handle->loop;
+  int r;
 
   switch (handle->type) {
     case UV_TCP:
-      return uv_tcp_write(loop, req, (uv_tcp_t*) handle, bufs, bufcnt, cb);
+      r = uv_tcp_write(loop, req, (uv_tcp_t*) handle, bufs, bufcnt, cb);
+      break;
     case UV_NAMED_PIPE:
-      return uv_pipe_write(loop, req, (uv_pipe_t*) handle, bufs, bufcnt, cb);
+      r = uv_pipe_write(loop, req, (uv_pipe_t*) handle, bufs, bufcnt, cb);
+      break;
     case UV_TTY:
-      return uv_tty_write(loop, req, (uv_tty_t*) handle, bufs, bufcnt, cb);
+      r = uv_tty_write(loop, req, (uv_tty_t*) handle, bufs, bufcnt, cb);
+      break;
     default:
       assert(0);
       uv__set_sys_error(loop, WSAEINVAL);
       return -1;
   }
+
+  if (r == 0)
+    uv__stream_watermarks(handle);
+
+  return r;
 }
 
 
 int uv_write2(uv_write_t* req, uv_stream_t* handle, uv_buf_t bufs[], int bufcnt,
     uv_stream_t* send_handle, uv_write_cb cb) {
   uv_loop_t* loop = handle->loop;
+  int r;
 
   switch (handle->type) {
     case UV_NAMED_PIPE:
-      return uv_pipe_write2(loop, req, (uv_pipe_t*) handle, bufs, bufcnt, send_handle, cb);
+      r = uv_pipe_write2(loop, req, (uv_pipe_t*) handle, bufs, bufcnt, send_handle, cb);
+      break;
     default:
       assert(0);
       uv__set_sys_error(loop, WSAEINVAL);
       return -1;
   }
+
+  if (r == 0)
+    uv__stream_watermarks(handle);
+
+  return r;
 }
 
 
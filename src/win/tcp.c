@@ -935,6 +935,9 @@ void uv_process_tcp_write_req(uv_loop_t* loop, uv_tcp_t* handle,
     ((uv_write_cb)req->cb)(req, loop->last_err.code == UV_OK ? 0 : -1);
   }
 
+  if (!(handle->flags & UV_HANDLE_CLOSING))
+    uv__stream_watermarks((uv_stream_t*) handle);
+
   handle->write_reqs_pending--;
   if (handle->flags & UV_HANDLE_SHUTTING &&
       handle->write_reqs_pending == 0) {
@@ -1055,6 +1058,12 @@ int uv_tcp_nodelay(uv_tcp_t* handle, int enable) {
 }
 
 
+int uv_tcp_zerocopy(uv_tcp_t* handle, int enable, size_t threshold) {
+  uv__set_artificial_error(handle->loop, UV_ENOTSUP);
+  return -1;
+}
+
+
 int uv_tcp_keepalive(uv_tcp_t* handle, int enable, unsigned int delay) {
   if (handle->socket != INVALID_SOCKET &&
       uv__tcp_keepalive(handle, handle->socket, enable, delay)) {
@@ -1109,6 +1118,12 @@ int uv_tcp_duplicate_socket(uv_tcp_t* handle, int pid,
 }
 
 
+int uv_tcp_reuseport(uv_tcp_t* handle, int enable) {
+  uv__set_artificial_error(handle->loop, UV_ENOTSUP);
+  return -1;
+}
+
+
 int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
   if (handle->flags & UV_HANDLE_CONNECTION) {
     uv__set_artificial_error(handle->loop, UV_EINVAL);
@@ -20,6 +20,7 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 
 #include "uv.h"
 #include "internal.h"
@@ -71,3 +72,70 @@ void uv_process_work_req(uv_loop_t* loop, uv_work_t* req) {
   req->after_work_cb(req);
   uv_unref(loop);
 }
+
+
+/*
+ * Work always runs on the system thread pool, see QueueUserWorkItem() above.
+ * Pools are accepted so that code that sizes its own pool stays portable.
+ */
+struct uv_threadpool_s {
+  unsigned int nthreads;
+};
+
+
+uv_threadpool_t* uv_threadpool_new(unsigned int nthreads) {
+  uv_threadpool_t* pool;
+
+  if (nthreads == 0)
+    return NULL;
+
+  if ((pool = malloc(sizeof(*pool))) == NULL)
+    return NULL;
+
+  pool->nthreads = nthreads;
+  return pool;
+}
+
+
+void uv_threadpool_delete(uv_threadpool_t* pool) {
+  free(pool);
+}
+
+
+int uv_loop_set_threadpool(uv_loop_t* loop, uv_threadpool_t* pool) {
+  if (pool == NULL) {
+    uv__set_artificial_error(loop, UV_EINVAL);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+int uv_cancel(uv_req_t* req) {
+  switch (req->type) {
+    case UV_FS:
+    case UV_WORK:
+    case UV_GETADDRINFO:
+      uv__set_artificial_error(uv__req_loop(req), UV_ENOSYS);
+      break;
+    default:
+      uv__set_artificial_error(uv__req_loop(req), UV_EINVAL);
+      break;
+  }
+
+  return -1;
+}
+
+
+uv_threadpool_t* uv_threadpool_new2(unsigned int nthreads,
+                                    unsigned int max_bulk) {
+  if (max_bulk == 0)
+    return NULL;
+
+  return uv_threadpool_new(nthreads);
+}
+
+
+void uv_loop_set_lane(uv_loop_t* loop, uv_lane_t lane) {
+}
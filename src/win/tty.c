@@ -1683,6 +1683,9 @@ void uv_process_tty_write_req(uv_loop_t* loop, uv_tty_t* handle,
     ((uv_write_cb)req->cb)(req, loop->last_err.code == UV_OK ? 0 : -1);
   }
 
+  if (!(handle->flags & UV_HANDLE_CLOSING))
+    uv__stream_watermarks((uv_stream_t*) handle);
+
   handle->write_reqs_pending--;
   if (handle->flags & UV_HANDLE_SHUTTING &&
       handle->write_reqs_pending == 0) {
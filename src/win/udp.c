@@ -172,6 +172,11 @@ static int uv__bind(uv_udp_t* handle,
     return -1;
   }
 
+  if (flags & UV_UDP_REUSEPORT) {
+    uv__set_artificial_error(handle->loop, UV_ENOTSUP);
+    return -1;
+  }
+
   if (handle->socket == INVALID_SOCKET) {
     sock = socket(domain, SOCK_DGRAM, 0);
     if (sock == INVALID_SOCKET) {
@@ -367,6 +372,18 @@ int uv_udp_recv_start(uv_udp_t* handle, uv_alloc_cb alloc_cb,
 }
 
 
+int uv_udp_recv_start_batch(uv_udp_t* handle, uv_alloc_cb alloc_cb,
+    uv_udp_recv_cb recv_cb, unsigned int nmsgs) {
+  if (nmsgs == 0) {
+    uv__set_artificial_error(handle->loop, UV_EINVAL);
+    return -1;
+  }
+
+  /* There is no batched receive on windows, read one datagram at a time. */
+  return uv_udp_recv_start(handle, alloc_cb, recv_cb);
+}
+
+
 int uv_udp_recv_stop(uv_udp_t* handle) {
   if (handle->flags & UV_HANDLE_READING) {
     handle->flags &= ~UV_HANDLE_READING;
@@ -453,6 +470,21 @@ int uv_udp_send6(uv_udp_send_t* req, uv_udp_t* handle, uv_buf_t bufs[],
 }
 
 
+int uv_udp_try_send(uv_udp_t* handle, uv_buf_t bufs[], int bufcnt,
+    struct sockaddr_in addr) {
+  /* Sends always go through the completion port. */
+  uv__set_artificial_error(handle->loop, UV_EAGAIN);
+  return -1;
+}
+
+
+int uv_udp_try_send6(uv_udp_t* handle, uv_buf_t bufs[], int bufcnt,
+    struct sockaddr_in6 addr) {
+  uv__set_artificial_error(handle->loop, UV_EAGAIN);
+  return -1;
+}
+
+
 void uv_process_udp_recv_req(uv_loop_t* loop, uv_udp_t* handle,
     uv_req_t* req) {
   uv_buf_t buf;
@@ -0,0 +1,154 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* A loop with many async handles of which only a few are busy. Every sender
+ * thread runs a loop of its own and ping-pongs with one hot handle on the
+ * main loop, so each round trip costs one wakeup on either side.
+ */
+
+#define NUM_SENDERS    4
+#define NUM_ROUNDTRIPS 20000 /* Per sender. */
+
+typedef struct {
+  uv_loop_t* loop;
+  uv_async_t ack;
+  uv_thread_t thread;
+  uv_async_t* hot;
+  int roundtrips;
+} sender_t;
+
+static sender_t senders[NUM_SENDERS];
+static uv_async_t* handles;
+static int num_handles;
+static int roundtrips;
+
+
+static void ack_cb(uv_async_t* handle, int status) {
+  sender_t* sender = handle->data;
+
+  if (++sender->roundtrips == NUM_ROUNDTRIPS)
+    uv_close((uv_handle_t*)handle, NULL);
+  else
+    uv_async_send(sender->hot);
+}
+
+
+static void sender_run(void* arg) {
+  sender_t* sender = arg;
+
+  uv_async_send(sender->hot);
+  uv_run(sender->loop);
+}
+
+
+static void hot_cb(uv_async_t* handle, int status) {
+  sender_t* sender = handle->data;
+  int i;
+
+  uv_async_send(&sender->ack);
+
+  if (++roundtrips < NUM_SENDERS * NUM_ROUNDTRIPS)
+    return;
+
+  for (i = 0; i < num_handles; i++)
+    uv_close((uv_handle_t*)&handles[i], NULL);
+}
+
+
+static void idle_cb(uv_async_t* handle, int status) {
+  ASSERT(0 && "idle handle signalled");
+}
+
+
+static int async_pending(int nhandles) {
+  uv_loop_t* loop;
+  uint64_t before;
+  uint64_t duration;
+  int stride;
+  int i;
+
+  loop = uv_default_loop();
+  roundtrips = 0;
+  num_handles = nhandles;
+
+  handles = malloc(nhandles * sizeof(handles[0]));
+  ASSERT(handles != NULL);
+
+  /* Spread the hot handles over the idle ones. */
+  stride = nhandles / NUM_SENDERS;
+
+  for (i = 0; i < nhandles; i++) {
+    if (i % stride == 0 && i / stride < NUM_SENDERS) {
+      senders[i / stride].hot = &handles[i];
+      handles[i].data = &senders[i / stride];
+      ASSERT(0 == uv_async_init(loop, &handles[i], hot_cb));
+    } else {
+      ASSERT(0 == uv_async_init(loop, &handles[i], idle_cb));
+    }
+  }
+
+  for (i = 0; i < NUM_SENDERS; i++) {
+    senders[i].roundtrips = 0;
+    senders[i].loop = uv_loop_new();
+    ASSERT(senders[i].loop != NULL);
+    ASSERT(0 == uv_async_init(senders[i].loop, &senders[i].ack, ack_cb));
+    senders[i].ack.data = &senders[i];
+  }
+
+  before = uv_hrtime();
+
+  for (i = 0; i < NUM_SENDERS; i++)
+    ASSERT(0 == uv_thread_create(&senders[i].thread, sender_run, &senders[i]));
+
+  ASSERT(0 == uv_run(loop));
+
+  for (i = 0; i < NUM_SENDERS; i++) {
+    ASSERT(0 == uv_thread_join(&senders[i].thread));
+    ASSERT(senders[i].roundtrips == NUM_ROUNDTRIPS);
+    uv_loop_delete(senders[i].loop);
+  }
+
+  duration = uv_hrtime() - before;
+
+  LOGF("async_pending_%d: %.0f roundtrips/s\n",
+       nhandles,
+       roundtrips / (duration / 1e9));
+
+  free(handles);
+
+  return 0;
+}
+
+
+BENCHMARK_IMPL(async_pending_10) {
+  return async_pending(10);
+}
+
+
+BENCHMARK_IMPL(async_pending_10k) {
+  return async_pending(10 * 1000);
+}
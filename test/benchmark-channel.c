@@ -0,0 +1,164 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Producer threads hand messages to the loop thread, once through a
+ * uv_channel_t and once through the mutex-protected list plus uv_async_t
+ * that it replaces.
+ */
+
+#define NUM_PRODUCERS 4
+#define NUM_MSGS      (500 * 1000) /* Per producer. */
+
+typedef struct msg_s {
+  uv_channel_msg_t msg;
+  struct msg_s* next; /* For the mutex-protected list. */
+} msg_t;
+
+static uv_loop_t* loop;
+static msg_t* msgs;
+static int received;
+static int callbacks;
+
+static uv_channel_t channel;
+
+static uv_async_t async;
+static uv_mutex_t mutex;
+static msg_t* list_head;
+
+
+static void channel_producer(void* arg) {
+  msg_t* m = arg;
+  int i;
+
+  for (i = 0; i < NUM_MSGS; i++)
+    uv_channel_send(&channel, &m[i].msg);
+}
+
+
+static void channel_cb(uv_channel_t* handle, uv_channel_msg_t* msg,
+    int count) {
+  callbacks++;
+  received += count;
+
+  if (received == NUM_PRODUCERS * NUM_MSGS)
+    uv_close((uv_handle_t*)handle, NULL);
+}
+
+
+static void async_producer(void* arg) {
+  msg_t* m = arg;
+  int i;
+
+  for (i = 0; i < NUM_MSGS; i++) {
+    uv_mutex_lock(&mutex);
+    m[i].next = list_head;
+    list_head = &m[i];
+    uv_mutex_unlock(&mutex);
+    uv_async_send(&async);
+  }
+}
+
+
+static void async_cb(uv_async_t* handle, int status) {
+  msg_t* m;
+
+  uv_mutex_lock(&mutex);
+  m = list_head;
+  list_head = NULL;
+  uv_mutex_unlock(&mutex);
+
+  callbacks++;
+
+  for (; m != NULL; m = m->next)
+    received++;
+
+  if (received == NUM_PRODUCERS * NUM_MSGS)
+    uv_close((uv_handle_t*)handle, NULL);
+}
+
+
+static int do_channel(int use_channel) {
+  uv_thread_t threads[NUM_PRODUCERS];
+  uint64_t before;
+  uint64_t duration;
+  int i;
+
+  msgs = malloc(NUM_PRODUCERS * NUM_MSGS * sizeof(msgs[0]));
+  ASSERT(msgs != NULL);
+
+  loop = uv_default_loop();
+  received = 0;
+  callbacks = 0;
+
+  if (use_channel) {
+    ASSERT(0 == uv_channel_init(loop, &channel, channel_cb));
+  } else {
+    ASSERT(0 == uv_mutex_init(&mutex));
+    ASSERT(0 == uv_async_init(loop, &async, async_cb));
+  }
+
+  before = uv_hrtime();
+
+  for (i = 0; i < NUM_PRODUCERS; i++) {
+    ASSERT(0 == uv_thread_create(&threads[i],
+                                 use_channel ? channel_producer
+                                             : async_producer,
+                                 msgs + i * NUM_MSGS));
+  }
+
+  ASSERT(0 == uv_run(loop));
+
+  duration = uv_hrtime() - before;
+
+  for (i = 0; i < NUM_PRODUCERS; i++)
+    ASSERT(0 == uv_thread_join(&threads[i]));
+
+  ASSERT(received == NUM_PRODUCERS * NUM_MSGS);
+
+  if (!use_channel)
+    uv_mutex_destroy(&mutex);
+
+  LOGF("%s_%d: %.0f msgs/s, %.1f msgs per callback\n",
+       use_channel ? "channel" : "async_mutex",
+       NUM_PRODUCERS,
+       received / (duration / 1e9),
+       (double)received / callbacks);
+
+  free(msgs);
+
+  return 0;
+}
+
+
+BENCHMARK_IMPL(channel_4) {
+  return do_channel(1);
+}
+
+
+BENCHMARK_IMPL(async_mutex_4) {
+  return do_channel(0);
+}
@@ -22,14 +22,27 @@
 BENCHMARK_DECLARE (sizes)
 BENCHMARK_DECLARE (ping_pongs)
 BENCHMARK_DECLARE (tcp_write_batch)
+BENCHMARK_DECLARE (tcp_accept)
+BENCHMARK_DECLARE (tcp_write_copy)
+BENCHMARK_DECLARE (tcp_write_zerocopy)
 BENCHMARK_DECLARE (tcp4_pound_100)
 BENCHMARK_DECLARE (tcp4_pound_1000)
+BENCHMARK_DECLARE (tcp4_pound_10000)
+BENCHMARK_DECLARE (tcp4_pound_shards)
 BENCHMARK_DECLARE (pipe_pound_100)
 BENCHMARK_DECLARE (pipe_pound_1000)
+BENCHMARK_DECLARE (tcp4_pound_100_epoll)
+BENCHMARK_DECLARE (pipe_pound_100_epoll)
+BENCHMARK_DECLARE (tcp4_pound_100_io_uring)
+BENCHMARK_DECLARE (pipe_pound_100_io_uring)
 BENCHMARK_DECLARE (tcp_pump100_client)
 BENCHMARK_DECLARE (tcp_pump1_client)
 BENCHMARK_DECLARE (pipe_pump100_client)
 BENCHMARK_DECLARE (pipe_pump1_client)
+BENCHMARK_DECLARE (tcp_pump100_client_epoll)
+BENCHMARK_DECLARE (pipe_pump100_client_epoll)
+BENCHMARK_DECLARE (tcp_pump100_client_io_uring)
+BENCHMARK_DECLARE (pipe_pump100_client_io_uring)
 BENCHMARK_DECLARE (udp_packet_storm_1v1)
 BENCHMARK_DECLARE (udp_packet_storm_1v10)
 BENCHMARK_DECLARE (udp_packet_storm_1v100)
@@ -40,10 +53,28 @@ BENCHMARK_DECLARE (udp_packet_storm_10v1000)
 BENCHMARK_DECLARE (udp_packet_storm_100v100)
 BENCHMARK_DECLARE (udp_packet_storm_100v1000)
 BENCHMARK_DECLARE (udp_packet_storm_1000v1000)
+BENCHMARK_DECLARE (udp_packet_storm_batch_1v1)
+BENCHMARK_DECLARE (udp_packet_storm_batch_10v10)
+BENCHMARK_DECLARE (udp_packet_storm_batch_100v100)
+BENCHMARK_DECLARE (udp_packet_storm_burst_1v1)
+BENCHMARK_DECLARE (udp_packet_storm_burst_10v10)
+BENCHMARK_DECLARE (udp_packet_storm_batch_burst_1v1)
+BENCHMARK_DECLARE (udp_packet_storm_batch_burst_10v10)
 BENCHMARK_DECLARE (gethostbyname)
 BENCHMARK_DECLARE (getaddrinfo)
 BENCHMARK_DECLARE (spawn)
 BENCHMARK_DECLARE (thread_create)
+BENCHMARK_DECLARE (channel_4)
+BENCHMARK_DECLARE (async_pending_10)
+BENCHMARK_DECLARE (async_pending_10k)
+BENCHMARK_DECLARE (async_mutex_4)
+BENCHMARK_DECLARE (million_timers_heap)
+BENCHMARK_DECLARE (million_timers_wheel)
+BENCHMARK_DECLARE (tcp_read_rss_100k)
+BENCHMARK_DECLARE (threadpool_1)
+BENCHMARK_DECLARE (threadpool_4)
+BENCHMARK_DECLARE (threadpool_16)
+BENCHMARK_DECLARE (threadpool_64)
 HELPER_DECLARE    (tcp4_blackhole_server)
 HELPER_DECLARE    (tcp_pump_server)
 HELPER_DECLARE    (pipe_pump_server)
@@ -60,6 +91,14 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (tcp_write_batch)
   BENCHMARK_HELPER (tcp_write_batch, tcp4_blackhole_server)
 
+  BENCHMARK_ENTRY  (tcp_accept)
+
+  BENCHMARK_ENTRY  (tcp_write_copy)
+  BENCHMARK_HELPER (tcp_write_copy, tcp4_blackhole_server)
+
+  BENCHMARK_ENTRY  (tcp_write_zerocopy)
+  BENCHMARK_HELPER (tcp_write_zerocopy, tcp4_blackhole_server)
+
   BENCHMARK_ENTRY  (tcp_pump100_client)
   BENCHMARK_HELPER (tcp_pump100_client, tcp_pump_server)
 
@@ -72,6 +111,11 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (tcp4_pound_1000)
   BENCHMARK_HELPER (tcp4_pound_1000, tcp4_echo_server)
 
+  BENCHMARK_ENTRY  (tcp4_pound_10000)
+  BENCHMARK_HELPER (tcp4_pound_10000, tcp4_echo_server)
+
+  BENCHMARK_ENTRY  (tcp4_pound_shards)
+
   BENCHMARK_ENTRY  (pipe_pump100_client)
   BENCHMARK_HELPER (pipe_pump100_client, pipe_pump_server)
 
@@ -84,6 +128,30 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (pipe_pound_1000)
   BENCHMARK_HELPER (pipe_pound_1000, pipe_echo_server)
 
+  BENCHMARK_ENTRY  (tcp_pump100_client_epoll)
+  BENCHMARK_HELPER (tcp_pump100_client_epoll, tcp_pump_server)
+
+  BENCHMARK_ENTRY  (pipe_pump100_client_epoll)
+  BENCHMARK_HELPER (pipe_pump100_client_epoll, pipe_pump_server)
+
+  BENCHMARK_ENTRY  (tcp4_pound_100_epoll)
+  BENCHMARK_HELPER (tcp4_pound_100_epoll, tcp4_echo_server)
+
+  BENCHMARK_ENTRY  (pipe_pound_100_epoll)
+  BENCHMARK_HELPER (pipe_pound_100_epoll, pipe_echo_server)
+
+  BENCHMARK_ENTRY  (tcp_pump100_client_io_uring)
+  BENCHMARK_HELPER (tcp_pump100_client_io_uring, tcp_pump_server)
+
+  BENCHMARK_ENTRY  (pipe_pump100_client_io_uring)
+  BENCHMARK_HELPER (pipe_pump100_client_io_uring, pipe_pump_server)
+
+  BENCHMARK_ENTRY  (tcp4_pound_100_io_uring)
+  BENCHMARK_HELPER (tcp4_pound_100_io_uring, tcp4_echo_server)
+
+  BENCHMARK_ENTRY  (pipe_pound_100_io_uring)
+  BENCHMARK_HELPER (pipe_pound_100_io_uring, pipe_echo_server)
+
   BENCHMARK_ENTRY  (udp_packet_storm_1v1)
   BENCHMARK_ENTRY  (udp_packet_storm_1v10)
   BENCHMARK_ENTRY  (udp_packet_storm_1v100)
@@ -94,6 +162,13 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (udp_packet_storm_100v100)
   BENCHMARK_ENTRY  (udp_packet_storm_100v1000)
   BENCHMARK_ENTRY  (udp_packet_storm_1000v1000)
+  BENCHMARK_ENTRY  (udp_packet_storm_batch_1v1)
+  BENCHMARK_ENTRY  (udp_packet_storm_batch_10v10)
+  BENCHMARK_ENTRY  (udp_packet_storm_batch_100v100)
+  BENCHMARK_ENTRY  (udp_packet_storm_burst_1v1)
+  BENCHMARK_ENTRY  (udp_packet_storm_burst_10v10)
+  BENCHMARK_ENTRY  (udp_packet_storm_batch_burst_1v1)
+  BENCHMARK_ENTRY  (udp_packet_storm_batch_burst_10v10)
 
   BENCHMARK_ENTRY  (gethostbyname)
   BENCHMARK_HELPER (gethostbyname, dns_server)
@@ -102,4 +177,17 @@ TASK_LIST_START
 
   BENCHMARK_ENTRY  (spawn)
   BENCHMARK_ENTRY  (thread_create)
+  BENCHMARK_ENTRY  (channel_4)
+  BENCHMARK_ENTRY  (async_mutex_4)
+  BENCHMARK_ENTRY  (async_pending_10)
+  BENCHMARK_ENTRY  (async_pending_10k)
+
+  BENCHMARK_ENTRY  (million_timers_heap)
+  BENCHMARK_ENTRY  (million_timers_wheel)
+  BENCHMARK_ENTRY  (tcp_read_rss_100k)
+
+  BENCHMARK_ENTRY  (threadpool_1)
+  BENCHMARK_ENTRY  (threadpool_4)
+  BENCHMARK_ENTRY  (threadpool_16)
+  BENCHMARK_ENTRY  (threadpool_64)
 TASK_LIST_END
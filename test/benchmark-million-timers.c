@@ -0,0 +1,129 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_TIMERS (1000 * 1000)
+
+static int timer_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void timer_cb(uv_timer_t* handle, int status) {
+  ASSERT(status == 0);
+  timer_cb_called++;
+  uv_close((uv_handle_t*)handle, close_cb);
+}
+
+
+static int do_million_timers(const char* name, unsigned int flags) {
+  uv_timer_t* timers;
+  uv_loop_t* loop;
+  uint64_t before;
+  uint64_t start_time;
+  uint64_t restart_time;
+  uint64_t stop_time;
+  uint64_t fire_time;
+  int i;
+  int r;
+
+  timers = malloc(NUM_TIMERS * sizeof(timers[0]));
+  ASSERT(timers != NULL);
+
+  loop = uv_loop_new2(flags);
+  ASSERT(loop != NULL);
+
+  for (i = 0; i < NUM_TIMERS; i++) {
+    r = uv_timer_init(loop, &timers[i]);
+    ASSERT(r == 0);
+  }
+
+  /* Idle timeouts, spread out over a second. */
+  before = uv_hrtime();
+  for (i = 0; i < NUM_TIMERS; i++) {
+    r = uv_timer_start(&timers[i], timer_cb, 30000 + i % 1000, 0);
+    ASSERT(r == 0);
+  }
+  start_time = uv_hrtime() - before;
+
+  /* Push every timeout back, like a server does when a connection sees
+   * activity.
+   */
+  before = uv_hrtime();
+  for (i = 0; i < NUM_TIMERS; i++) {
+    r = uv_timer_stop(&timers[i]);
+    ASSERT(r == 0);
+    r = uv_timer_start(&timers[i], timer_cb, 30000 + (i + 1) % 1000, 0);
+    ASSERT(r == 0);
+  }
+  restart_time = uv_hrtime() - before;
+
+  before = uv_hrtime();
+  for (i = 0; i < NUM_TIMERS; i++) {
+    r = uv_timer_stop(&timers[i]);
+    ASSERT(r == 0);
+  }
+  stop_time = uv_hrtime() - before;
+
+  /* Now let them all expire within 100 ms. */
+  before = uv_hrtime();
+  for (i = 0; i < NUM_TIMERS; i++) {
+    r = uv_timer_start(&timers[i], timer_cb, i % 100, 0);
+    ASSERT(r == 0);
+  }
+  r = uv_run(loop);
+  ASSERT(r == 0);
+  fire_time = uv_hrtime() - before;
+
+  ASSERT(timer_cb_called == NUM_TIMERS);
+  ASSERT(close_cb_called == NUM_TIMERS);
+
+  LOGF("%s: %.2f s start, %.2f s restart, %.2f s stop, %.2f s run\n",
+       name,
+       start_time / 1e9,
+       restart_time / 1e9,
+       stop_time / 1e9,
+       fire_time / 1e9);
+
+  uv_loop_delete(loop);
+  free(timers);
+
+  return 0;
+}
+
+
+BENCHMARK_IMPL(million_timers_heap) {
+  return do_million_timers("million_timers_heap", 0);
+}
+
+
+BENCHMARK_IMPL(million_timers_wheel) {
+  return do_million_timers("million_timers_wheel", UV_LOOP_TIMER_WHEEL);
+}
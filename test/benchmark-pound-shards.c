@@ -0,0 +1,287 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdlib.h>
+
+/* Multi-loop variant of the tcp4_pound benchmarks. The server is made of
+ * uv_tcp_shards_start() shards, one per loop thread, and each shard gets a
+ * client thread that keeps CONCURRENCY connections going. Runs with 1, 2,
+ * 4, ... shards up to the number of CPUs to show how accepts/s scale.
+ */
+
+#define MAX_SHARDS  16
+#define CONCURRENCY 100
+#define DURATION    3000 /* in ms */
+
+typedef struct {
+  uv_tcp_t stream;
+  uv_connect_t connect_req;
+  uv_write_t write_req;
+} client_conn_t;
+
+typedef struct {
+  uv_loop_t* loop;
+  uv_thread_t thread;
+  uint64_t start;
+  int closed_streams;
+  int conns_failed;
+  client_conn_t conns[CONCURRENCY];
+} client_t;
+
+typedef struct {
+  uv_tcp_t stream;
+  uv_write_t write_req;
+  char buf[64];
+} server_conn_t;
+
+static uv_tcp_shard_t shards[MAX_SHARDS];
+static int shard_accepts[MAX_SHARDS];
+static client_t clients[MAX_SHARDS];
+static struct sockaddr_in addr;
+
+static char buffer[] = "QS";
+
+static void client_connect(client_t* client, client_conn_t* conn);
+
+
+static uv_buf_t client_alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  static char slab[MAX_SHARDS][64];
+  client_t* client = handle->loop->data;
+  return uv_buf_init(slab[client - clients], sizeof slab[0]);
+}
+
+
+static void client_close_cb(uv_handle_t* handle) {
+  client_conn_t* conn = handle->data;
+  client_t* client = handle->loop->data;
+
+  client->closed_streams++;
+
+  if (uv_now(client->loop) - client->start < DURATION)
+    client_connect(client, conn);
+}
+
+
+static void client_read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  client_t* client = stream->loop->data;
+
+  if (nread == 0)
+    return;
+
+  if (nread == -1 && uv_last_error(stream->loop).code != UV_EOF)
+    client->conns_failed++;
+
+  uv_close((uv_handle_t*)stream, client_close_cb);
+}
+
+
+static void client_write_cb(uv_write_t* req, int status) {
+  client_t* client = req->handle->loop->data;
+
+  if (status != 0) {
+    client->conns_failed++;
+    uv_close((uv_handle_t*)req->handle, client_close_cb);
+  }
+}
+
+
+static void client_connect_cb(uv_connect_t* req, int status) {
+  client_conn_t* conn = req->data;
+  client_t* client = req->handle->loop->data;
+  uv_buf_t buf;
+
+  if (status != 0) {
+    client->conns_failed++;
+    uv_close((uv_handle_t*)req->handle, client_close_cb);
+    return;
+  }
+
+  ASSERT(0 == uv_read_start(req->handle, client_alloc_cb, client_read_cb));
+
+  buf = uv_buf_init(buffer, sizeof(buffer) - 1);
+  ASSERT(0 == uv_write(&conn->write_req, req->handle, &buf, 1,
+                       client_write_cb));
+}
+
+
+static void client_connect(client_t* client, client_conn_t* conn) {
+  ASSERT(0 == uv_tcp_init(client->loop, &conn->stream));
+  ASSERT(0 == uv_tcp_connect(&conn->connect_req, &conn->stream, addr,
+                             client_connect_cb));
+  conn->stream.data = conn;
+  conn->connect_req.data = conn;
+}
+
+
+static void client_run(void* arg) {
+  client_t* client = arg;
+  int i;
+
+  uv_update_time(client->loop);
+  client->start = uv_now(client->loop);
+
+  for (i = 0; i < CONCURRENCY; i++)
+    client_connect(client, &client->conns[i]);
+
+  uv_run(client->loop);
+}
+
+
+static void server_close_cb(uv_handle_t* handle) {
+  free(handle);
+}
+
+
+static uv_buf_t server_alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  server_conn_t* conn = (server_conn_t*)handle;
+  return uv_buf_init(conn->buf, sizeof conn->buf);
+}
+
+
+static void server_write_cb(uv_write_t* req, int status) {
+}
+
+
+/* Echoes what the client sends and closes on EOF, like tcp4_echo_server. */
+static void server_read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  server_conn_t* conn = (server_conn_t*)stream;
+
+  if (nread == 0)
+    return;
+
+  if (nread == -1) {
+    uv_close((uv_handle_t*)stream, server_close_cb);
+    return;
+  }
+
+  buf.len = nread;
+  if (uv_write(&conn->write_req, stream, &buf, 1, server_write_cb))
+    uv_close((uv_handle_t*)stream, server_close_cb);
+}
+
+
+static void server_connection_cb(uv_stream_t* stream, int status) {
+  uv_tcp_shard_t* shard = stream->data;
+  server_conn_t* conn;
+
+  ASSERT(status == 0);
+
+  conn = malloc(sizeof *conn);
+  ASSERT(conn != NULL);
+
+  ASSERT(0 == uv_tcp_init(shard->loop, &conn->stream));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)&conn->stream));
+  ASSERT(0 == uv_read_start((uv_stream_t*)&conn->stream,
+                            server_alloc_cb,
+                            server_read_cb));
+
+  (*(int*)shard->data)++;
+}
+
+
+static void pound_shards(int nshards) {
+  uint64_t start_time;
+  uint64_t end_time;
+  double secs;
+  int closed_streams;
+  int conns_failed;
+  int min_accepts;
+  int max_accepts;
+  uv_err_t err;
+  int i;
+
+  for (i = 0; i < nshards; i++) {
+    shard_accepts[i] = 0;
+    shards[i].data = &shard_accepts[i];
+  }
+
+  err = uv_tcp_shards_start(shards, nshards, addr, SOMAXCONN,
+                            server_connection_cb);
+  ASSERT(err.code == UV_OK);
+
+  start_time = uv_hrtime();
+
+  for (i = 0; i < nshards; i++) {
+    clients[i].closed_streams = 0;
+    clients[i].conns_failed = 0;
+    clients[i].loop = uv_loop_new();
+    ASSERT(clients[i].loop != NULL);
+    clients[i].loop->data = &clients[i];
+    ASSERT(0 == uv_thread_create(&clients[i].thread, client_run, &clients[i]));
+  }
+
+  closed_streams = 0;
+  conns_failed = 0;
+
+  for (i = 0; i < nshards; i++) {
+    ASSERT(0 == uv_thread_join(&clients[i].thread));
+    uv_loop_delete(clients[i].loop);
+    closed_streams += clients[i].closed_streams;
+    conns_failed += clients[i].conns_failed;
+  }
+
+  end_time = uv_hrtime();
+
+  uv_tcp_shards_stop(shards, nshards);
+
+  min_accepts = max_accepts = shard_accepts[0];
+  for (i = 1; i < nshards; i++) {
+    if (shard_accepts[i] < min_accepts)
+      min_accepts = shard_accepts[i];
+    if (shard_accepts[i] > max_accepts)
+      max_accepts = shard_accepts[i];
+  }
+
+  secs = (double)(end_time - start_time) / 1e9;
+
+  LOGF("tcp-conn-pound-%d-shards-%d: %.0f accepts/s "
+       "(%d failed, %d-%d per shard)\n",
+       CONCURRENCY,
+       nshards,
+       closed_streams / secs,
+       conns_failed,
+       min_accepts,
+       max_accepts);
+}
+
+
+BENCHMARK_IMPL(tcp4_pound_shards) {
+  uv_cpu_info_t* cpu_infos;
+  int ncpus;
+  int n;
+
+  ASSERT(UV_OK == uv_cpu_info(&cpu_infos, &ncpus).code);
+  uv_free_cpu_info(cpu_infos, ncpus);
+
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+
+  /* Every shard comes with a client thread. */
+  for (n = 1; n <= MAX_SHARDS && 2 * n <= ncpus; n *= 2)
+    pound_shards(n);
+
+  if (n == 1)
+    pound_shards(1);
+
+  return 0;
+}
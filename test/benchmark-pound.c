@@ -22,8 +22,8 @@
 #include "task.h"
 #include "uv.h"
 
-/* Update this is you're going to run > 1000 concurrent requests. */
-#define MAX_CONNS 1000
+/* Update this is you're going to run > 10000 concurrent requests. */
+#define MAX_CONNS 10000
 
 #undef NANOSEC
 #define NANOSEC ((uint64_t)10e8)
@@ -263,6 +263,7 @@ static int pipe_do_connect(int num, make_connect_fn make_connect, void* arg) {
 
 static int pound_it(int concurrency,
                     const char* type,
+                    unsigned int loop_flags,
                     setup_fn do_setup,
                     connect_fn do_connect,
                     make_connect_fn make_connect,
@@ -272,7 +273,8 @@ static int pound_it(int concurrency,
   uint64_t start_time; /* in ns */
   uint64_t end_time;
 
-  loop = uv_default_loop();
+  loop = loop_flags ? uv_loop_new2(loop_flags) : uv_default_loop();
+  ASSERT(loop != NULL);
 
   uv_update_time(loop);
   start = uv_now(loop);
@@ -292,31 +294,61 @@ static int pound_it(int concurrency,
   /* Number of fractional seconds it took to run the benchmark. */
   secs = (double)(end_time - start_time) / NANOSEC;
 
-  LOGF("%s-conn-pound-%d: %.0f accepts/s (%d failed)\n",
+  LOGF("%s-conn-pound-%d%s: %.0f accepts/s (%d failed)\n",
        type,
        concurrency,
+       (loop_flags & UV_LOOP_EPOLL) ? "-epoll" :
+         (loop_flags & UV_LOOP_IO_URING_NET) ? "-io_uring" : "",
        closed_streams / secs,
        conns_failed);
 
+  if (loop != uv_default_loop())
+    uv_loop_delete(loop);
+
   return 0;
 }
 
 
 BENCHMARK_IMPL(tcp4_pound_100) {
-  return pound_it(100, "tcp", tcp_do_setup, tcp_do_connect, tcp_make_connect, NULL);
+  return pound_it(100, "tcp", 0, tcp_do_setup, tcp_do_connect, tcp_make_connect, NULL);
 }
 
 
 BENCHMARK_IMPL(tcp4_pound_1000) {
-  return pound_it(1000, "tcp", tcp_do_setup, tcp_do_connect, tcp_make_connect, NULL);
+  return pound_it(1000, "tcp", 0, tcp_do_setup, tcp_do_connect, tcp_make_connect, NULL);
+}
+
+
+BENCHMARK_IMPL(tcp4_pound_10000) {
+  return pound_it(10000, "tcp", 0, tcp_do_setup, tcp_do_connect, tcp_make_connect, NULL);
 }
 
 
 BENCHMARK_IMPL(pipe_pound_100) {
-  return pound_it(100, "pipe", pipe_do_setup, pipe_do_connect, pipe_make_connect, NULL);
+  return pound_it(100, "pipe", 0, pipe_do_setup, pipe_do_connect, pipe_make_connect, NULL);
 }
 
 
 BENCHMARK_IMPL(pipe_pound_1000) {
-  return pound_it(1000, "pipe", pipe_do_setup, pipe_do_connect, pipe_make_connect, NULL);
+  return pound_it(1000, "pipe", 0, pipe_do_setup, pipe_do_connect, pipe_make_connect, NULL);
+}
+
+
+BENCHMARK_IMPL(tcp4_pound_100_epoll) {
+  return pound_it(100, "tcp", UV_LOOP_EPOLL, tcp_do_setup, tcp_do_connect, tcp_make_connect, NULL);
+}
+
+
+BENCHMARK_IMPL(pipe_pound_100_epoll) {
+  return pound_it(100, "pipe", UV_LOOP_EPOLL, pipe_do_setup, pipe_do_connect, pipe_make_connect, NULL);
+}
+
+
+BENCHMARK_IMPL(tcp4_pound_100_io_uring) {
+  return pound_it(100, "tcp", UV_LOOP_IO_URING_NET, tcp_do_setup, tcp_do_connect, tcp_make_connect, NULL);
+}
+
+
+BENCHMARK_IMPL(pipe_pound_100_io_uring) {
+  return pound_it(100, "pipe", UV_LOOP_IO_URING_NET, pipe_do_setup, pipe_do_connect, pipe_make_connect, NULL);
 }
@@ -408,12 +408,13 @@ HELPER_IMPL(pipe_pump_server) {
 }
 
 
-void tcp_pump(int n) {
+void tcp_pump(int n, unsigned int loop_flags) {
   ASSERT(n <= MAX_WRITE_HANDLES);
   TARGET_CONNECTIONS = n;
   type = TCP;
 
-  loop = uv_default_loop();
+  loop = loop_flags ? uv_loop_new2(loop_flags) : uv_default_loop();
+  ASSERT(loop != NULL);
 
   connect_addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
 
@@ -424,12 +425,13 @@ void tcp_pump(int n) {
 }
 
 
-void pipe_pump(int n) {
+void pipe_pump(int n, unsigned int loop_flags) {
   ASSERT(n <= MAX_WRITE_HANDLES);
   TARGET_CONNECTIONS = n;
   type = PIPE;
 
-  loop = uv_default_loop();
+  loop = loop_flags ? uv_loop_new2(loop_flags) : uv_default_loop();
+  ASSERT(loop != NULL);
 
   /* Start making connections */
   maybe_connect_some();
@@ -439,24 +441,48 @@ void pipe_pump(int n) {
 
 
 BENCHMARK_IMPL(tcp_pump100_client) {
-  tcp_pump(100);
+  tcp_pump(100, 0);
   return 0;
 }
 
 
 BENCHMARK_IMPL(tcp_pump1_client) {
-  tcp_pump(1);
+  tcp_pump(1, 0);
   return 0;
 }
 
 
 BENCHMARK_IMPL(pipe_pump100_client) {
-  pipe_pump(100);
+  pipe_pump(100, 0);
   return 0;
 }
 
 
 BENCHMARK_IMPL(pipe_pump1_client) {
-  pipe_pump(1);
+  pipe_pump(1, 0);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(tcp_pump100_client_epoll) {
+  tcp_pump(100, UV_LOOP_EPOLL);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(pipe_pump100_client_epoll) {
+  pipe_pump(100, UV_LOOP_EPOLL);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(tcp_pump100_client_io_uring) {
+  tcp_pump(100, UV_LOOP_IO_URING_NET);
+  return 0;
+}
+
+
+BENCHMARK_IMPL(pipe_pump100_client_io_uring) {
+  pipe_pump(100, UV_LOOP_IO_URING_NET);
   return 0;
 }
@@ -0,0 +1,270 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+/* A chat server: lots of connections that each get a small message every
+ * now and then, the server holds on to the last one. Reports how much the
+ * resident set grows, which is mostly the read buffers.
+ */
+
+#define NUM_CONNS (100 * 1000)
+#define NUM_PORTS 4
+#define NUM_MESSAGES 10
+#define MESSAGE_SIZE 100
+#define MAX_CONNECTING 256
+
+typedef struct {
+  uv_tcp_t handle;
+  uv_connect_t connect_req;
+  uv_write_t write_req;
+} client_t;
+
+typedef struct {
+  uv_tcp_t handle;
+  uv_buf_t last;
+} server_conn_t;
+
+static uv_loop_t* loop;
+static uv_tcp_t servers[NUM_PORTS];
+static client_t* clients;
+static server_conn_t* server_conns;
+static char message[MESSAGE_SIZE];
+
+static int num_conns;
+static int connects_started;
+static int connects_done;
+static int accepts_done;
+static int round_num;
+static int writes_done;
+static size_t bytes_read;
+static size_t rss_before;
+
+
+static size_t rss(void) {
+  size_t rss;
+
+  ASSERT(uv_resident_set_memory(&rss).code == UV_OK);
+  return rss;
+}
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  return uv_buf_init(malloc(suggested_size), suggested_size);
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+}
+
+
+static void write_cb(uv_write_t* req, int status);
+static void connect_next(void);
+
+
+static void finish(void) {
+  size_t growth;
+  int i;
+
+  growth = rss() - rss_before;
+
+  LOGF("tcp_read_rss: %d connections, %d messages of %d bytes each, "
+       "rss grew %.1f MB, %.0f bytes/connection\n",
+       num_conns,
+       NUM_MESSAGES,
+       MESSAGE_SIZE,
+       growth / (1024.0 * 1024.0),
+       (double) growth / num_conns);
+
+  for (i = 0; i < num_conns; i++) {
+    free(server_conns[i].last.base);
+    uv_close((uv_handle_t*)&server_conns[i].handle, close_cb);
+    uv_close((uv_handle_t*)&clients[i].handle, close_cb);
+  }
+
+  for (i = 0; i < NUM_PORTS; i++)
+    uv_close((uv_handle_t*)&servers[i], close_cb);
+}
+
+
+static void send_round(void) {
+  uv_buf_t buf;
+  int i;
+
+  buf = uv_buf_init(message, sizeof message);
+
+  for (i = 0; i < num_conns; i++) {
+    ASSERT(0 == uv_write(&clients[i].write_req,
+                         (uv_stream_t*)&clients[i].handle,
+                         &buf,
+                         1,
+                         write_cb));
+  }
+}
+
+
+/* The next round reuses the write requests, so it waits for their
+ * callbacks as well as for the data.
+ */
+static void maybe_next_round(void) {
+  if (writes_done < num_conns * (round_num + 1))
+    return;
+
+  if (bytes_read < (size_t) num_conns * MESSAGE_SIZE * (round_num + 1))
+    return;
+
+  if (++round_num == NUM_MESSAGES)
+    finish();
+  else
+    send_round();
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  writes_done++;
+  maybe_next_round();
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  server_conn_t* conn;
+
+  conn = (server_conn_t*)stream;
+
+  if (nread <= 0) {
+    ASSERT(nread == 0);
+    free(buf.base);
+    return;
+  }
+
+  free(conn->last.base);
+  conn->last = buf;
+
+  bytes_read += nread;
+  maybe_next_round();
+}
+
+
+static void all_connected(void) {
+  if (connects_done < num_conns || accepts_done < num_conns)
+    return;
+
+  rss_before = rss();
+  send_round();
+}
+
+
+static void connection_cb(uv_stream_t* server, int status) {
+  server_conn_t* conn;
+
+  ASSERT(status == 0);
+  ASSERT(accepts_done < num_conns);
+
+  conn = server_conns + accepts_done++;
+  conn->last = uv_buf_init(NULL, 0);
+
+  ASSERT(0 == uv_tcp_init(loop, &conn->handle));
+  ASSERT(0 == uv_accept(server, (uv_stream_t*)&conn->handle));
+  ASSERT(0 == uv_read_start((uv_stream_t*)&conn->handle, alloc_cb, read_cb));
+
+  all_connected();
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  connects_done++;
+  connect_next();
+  all_connected();
+}
+
+
+static void connect_next(void) {
+  struct sockaddr_in addr;
+  client_t* client;
+  int i;
+
+  if (connects_started == num_conns)
+    return;
+
+  i = connects_started++;
+  client = clients + i;
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT + i % NUM_PORTS);
+
+  ASSERT(0 == uv_tcp_init(loop, &client->handle));
+  ASSERT(0 == uv_tcp_connect(&client->connect_req,
+                             &client->handle,
+                             addr,
+                             connect_cb));
+}
+
+
+BENCHMARK_IMPL(tcp_read_rss_100k) {
+  struct sockaddr_in addr;
+  struct rlimit lim;
+  int i;
+
+  /* Two fds per connection. Run fewer connections if there aren't that
+   * many to be had.
+   */
+  ASSERT(0 == getrlimit(RLIMIT_NOFILE, &lim));
+  lim.rlim_cur = lim.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &lim);
+  ASSERT(0 == getrlimit(RLIMIT_NOFILE, &lim));
+
+  num_conns = NUM_CONNS;
+  if (lim.rlim_cur != RLIM_INFINITY && lim.rlim_cur < 2 * NUM_CONNS + 64)
+    num_conns = (lim.rlim_cur - 64) / 2;
+
+  clients = calloc(num_conns, sizeof(clients[0]));
+  server_conns = calloc(num_conns, sizeof(server_conns[0]));
+  ASSERT(clients != NULL);
+  ASSERT(server_conns != NULL);
+
+  memset(message, 'x', sizeof message);
+  loop = uv_default_loop();
+
+  for (i = 0; i < NUM_PORTS; i++) {
+    addr = uv_ip4_addr("0.0.0.0", TEST_PORT + i);
+    ASSERT(0 == uv_tcp_init(loop, &servers[i]));
+    ASSERT(0 == uv_tcp_bind(&servers[i], addr));
+    ASSERT(0 == uv_listen((uv_stream_t*)&servers[i], 1024, connection_cb));
+  }
+
+  for (i = 0; i < MAX_CONNECTING; i++)
+    connect_next();
+
+  uv_run(loop);
+
+  ASSERT(round_num == NUM_MESSAGES);
+
+  free(clients);
+  free(server_conns);
+
+  return 0;
+}
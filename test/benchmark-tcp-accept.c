@@ -0,0 +1,133 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Short-lived connections against a listener that has TCP_NODELAY and
+ * SO_KEEPALIVE turned on, and that asks for TCP_NODELAY on every accepted
+ * connection. Reports the accept rate. The accepted sockets inherit the
+ * listener's options so opening them takes no setsockopt() calls.
+ */
+
+#define NUM_CONCURRENT  100
+#define NUM_CONNECTIONS 20000
+
+typedef struct {
+  uv_tcp_t handle;
+  uv_connect_t connect_req;
+} client_t;
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static client_t clients[NUM_CONCURRENT];
+static struct sockaddr_in addr;
+
+static int connects_started;
+static int accepted;
+static int closed_conns;
+
+static void do_connect(client_t* c);
+
+
+static void conn_close_cb(uv_handle_t* handle) {
+  free(handle);
+
+  if (++closed_conns == NUM_CONNECTIONS)
+    uv_close((uv_handle_t*)&server, NULL);
+}
+
+
+static void client_close_cb(uv_handle_t* handle) {
+  client_t* c = handle->data;
+
+  if (connects_started < NUM_CONNECTIONS)
+    do_connect(c);
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  client_t* c = req->data;
+
+  ASSERT(status == 0);
+  uv_close((uv_handle_t*)&c->handle, client_close_cb);
+}
+
+
+static void do_connect(client_t* c) {
+  ASSERT(0 == uv_tcp_init(loop, &c->handle));
+  ASSERT(0 == uv_tcp_connect(&c->connect_req, &c->handle, addr, connect_cb));
+  c->handle.data = c;
+  c->connect_req.data = c;
+  connects_started++;
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  uv_tcp_t* conn;
+
+  ASSERT(status == 0);
+
+  conn = malloc(sizeof *conn);
+  ASSERT(conn != NULL);
+
+  ASSERT(0 == uv_tcp_init(loop, conn));
+  ASSERT(0 == uv_tcp_nodelay(conn, 1));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)conn));
+  accepted++;
+
+  uv_close((uv_handle_t*)conn, conn_close_cb);
+}
+
+
+BENCHMARK_IMPL(tcp_accept) {
+  uint64_t start;
+  uint64_t end;
+  int i;
+
+  loop = uv_default_loop();
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_tcp_nodelay(&server, 1));
+  ASSERT(0 == uv_tcp_keepalive(&server, 1, 60));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, SOMAXCONN, connection_cb));
+
+  start = uv_hrtime();
+
+  for (i = 0; i < NUM_CONCURRENT; i++)
+    do_connect(&clients[i]);
+
+  ASSERT(0 == uv_run(loop));
+
+  end = uv_hrtime();
+
+  ASSERT(accepted == NUM_CONNECTIONS);
+
+  LOGF("tcp_accept: %.0f accepts/s\n",
+       accepted / ((double)(end - start) / 1e9));
+
+  return 0;
+}
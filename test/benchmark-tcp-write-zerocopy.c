@@ -0,0 +1,192 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+/* Sends TOTAL_SIZE bytes in WRITE_SIZE writes to the blackhole server and
+ * reports the CPU time the client spent per GB, with and without zero-copy
+ * writes. Note that the kernel copies on loopback connections regardless,
+ * the difference only shows against a remote peer.
+ */
+
+#define WRITE_SIZE      (1024 * 1024)
+#define NUM_INFLIGHT    16
+#define TOTAL_SIZE      ((uint64_t) 4 << 30)
+
+
+static uv_tcp_t tcp_client;
+static uv_connect_t connect_req;
+static uv_shutdown_t shutdown_req;
+static uv_write_t write_reqs[NUM_INFLIGHT];
+static char* buffers[NUM_INFLIGHT];
+
+static uint64_t bytes_queued;
+static uint64_t bytes_written;
+static int shutdown_cb_called;
+static int close_cb_called;
+
+static void write_cb(uv_write_t* req, int status);
+static void shutdown_cb(uv_shutdown_t* req, int status);
+static void close_cb(uv_handle_t* handle);
+
+
+static void do_write(uv_write_t* req) {
+  uv_buf_t buf;
+  int i;
+  int r;
+
+  i = req - write_reqs;
+  buf = uv_buf_init(buffers[i], WRITE_SIZE);
+  r = uv_write(req, (uv_stream_t*)&tcp_client, &buf, 1, write_cb);
+  ASSERT(r == 0);
+
+  bytes_queued += WRITE_SIZE;
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  int i;
+
+  ASSERT(status == 0);
+
+  for (i = 0; i < NUM_INFLIGHT; i++)
+    do_write(&write_reqs[i]);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  int r;
+
+  ASSERT(status == 0);
+  bytes_written += WRITE_SIZE;
+
+  /* The buffer is free again, reuse it. */
+  if (bytes_queued < TOTAL_SIZE) {
+    do_write(req);
+    return;
+  }
+
+  if (bytes_written == TOTAL_SIZE) {
+    r = uv_shutdown(&shutdown_req, (uv_stream_t*)&tcp_client, shutdown_cb);
+    ASSERT(r == 0);
+  }
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(req->handle == (uv_stream_t*)&tcp_client);
+  uv_close((uv_handle_t*)req->handle, close_cb);
+  shutdown_cb_called++;
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  ASSERT(handle == (uv_handle_t*)&tcp_client);
+  close_cb_called++;
+}
+
+
+static uint64_t cpu_usec(void) {
+  struct rusage ru;
+
+  ASSERT(0 == getrusage(RUSAGE_SELF, &ru));
+
+  return (uint64_t) (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+         ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+
+static int tcp_write_large(int zerocopy) {
+  struct sockaddr_in addr;
+  uv_loop_t* loop;
+  uint64_t cpu_start;
+  uint64_t cpu_stop;
+  uint64_t start;
+  uint64_t stop;
+  double gb;
+  int i;
+  int r;
+
+  for (i = 0; i < NUM_INFLIGHT; i++) {
+    buffers[i] = malloc(WRITE_SIZE);
+    ASSERT(buffers[i] != NULL);
+    memset(buffers[i], 'x', WRITE_SIZE);
+  }
+
+  loop = uv_default_loop();
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+
+  r = uv_tcp_init(loop, &tcp_client);
+  ASSERT(r == 0);
+
+  if (zerocopy) {
+    r = uv_tcp_zerocopy(&tcp_client, 1, 0);
+    if (r) {
+      ASSERT(uv_last_error(loop).code == UV_ENOTSUP);
+      LOGF("zero-copy writes not supported\n");
+    }
+  }
+
+  r = uv_tcp_connect(&connect_req, &tcp_client, addr, connect_cb);
+  ASSERT(r == 0);
+
+  start = uv_hrtime();
+  cpu_start = cpu_usec();
+
+  r = uv_run(loop);
+  ASSERT(r == 0);
+
+  cpu_stop = cpu_usec();
+  stop = uv_hrtime();
+
+  ASSERT(bytes_written == TOTAL_SIZE);
+  ASSERT(shutdown_cb_called == 1);
+  ASSERT(close_cb_called == 1);
+
+  gb = (double) TOTAL_SIZE / (1 << 30);
+
+  LOGF("%s: %.2f GB in %.2fs, %.0f ms CPU per GB\n",
+       zerocopy ? "zero-copy" : "copy",
+       gb,
+       (stop - start) / 1e9,
+       (cpu_stop - cpu_start) / 1e3 / gb);
+
+  for (i = 0; i < NUM_INFLIGHT; i++)
+    free(buffers[i]);
+
+  return 0;
+}
+
+
+BENCHMARK_IMPL(tcp_write_copy) {
+  return tcp_write_large(0);
+}
+
+
+BENCHMARK_IMPL(tcp_write_zerocopy) {
+  return tcp_write_large(1);
+}
@@ -0,0 +1,130 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "task.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_REQS (200 * 1000)
+
+/* Roughly a couple of microseconds of CPU time per request. */
+#define WORK_ITERATIONS 2000
+
+struct work_req {
+  uv_work_t req;
+  uint64_t queued;
+};
+
+static int after_work_cb_called;
+static uint64_t latency_total;
+static uint64_t latency_max;
+
+
+static void work_cb(uv_work_t* req) {
+  volatile unsigned int n = 0;
+  int i;
+
+  for (i = 0; i < WORK_ITERATIONS; i++)
+    n += i;
+}
+
+
+static void after_work_cb(uv_work_t* req) {
+  struct work_req* wr = (struct work_req*) req;
+  uint64_t latency;
+
+  latency = uv_hrtime() - wr->queued;
+  latency_total += latency;
+  if (latency > latency_max)
+    latency_max = latency;
+
+  after_work_cb_called++;
+}
+
+
+static int do_threadpool(unsigned int nworkers) {
+  struct work_req* reqs;
+  uv_threadpool_t* pool;
+  uv_loop_t* loop;
+  uint64_t before;
+  uint64_t duration;
+  int i;
+  int r;
+
+  reqs = malloc(NUM_REQS * sizeof(reqs[0]));
+  ASSERT(reqs != NULL);
+
+  pool = uv_threadpool_new(nworkers);
+  ASSERT(pool != NULL);
+
+  loop = uv_loop_new();
+  ASSERT(loop != NULL);
+
+  r = uv_loop_set_threadpool(loop, pool);
+  ASSERT(r == 0);
+
+  before = uv_hrtime();
+  for (i = 0; i < NUM_REQS; i++) {
+    reqs[i].queued = uv_hrtime();
+    r = uv_queue_work(loop, &reqs[i].req, work_cb, after_work_cb);
+    ASSERT(r == 0);
+  }
+
+  r = uv_run(loop);
+  ASSERT(r == 0);
+  duration = uv_hrtime() - before;
+
+  ASSERT(after_work_cb_called == NUM_REQS);
+
+  LOGF("threadpool_%u: %.0f reqs/s, %.2f ms mean latency, %.2f ms max\n",
+       nworkers,
+       NUM_REQS / (duration / 1e9),
+       latency_total / (double) NUM_REQS / 1e6,
+       latency_max / 1e6);
+
+  uv_loop_delete(loop);
+  uv_threadpool_delete(pool);
+  free(reqs);
+
+  return 0;
+}
+
+
+BENCHMARK_IMPL(threadpool_1) {
+  return do_threadpool(1);
+}
+
+
+BENCHMARK_IMPL(threadpool_4) {
+  return do_threadpool(4);
+}
+
+
+BENCHMARK_IMPL(threadpool_16) {
+  return do_threadpool(16);
+}
+
+
+BENCHMARK_IMPL(threadpool_64) {
+  return do_threadpool(64);
+}
@@ -35,6 +35,9 @@
 
 #define BASE_PORT 12345
 
+#define RECV_BATCH 32 /* datagrams per recvmmsg() in the batch variants */
+#define BURST_DEPTH 64 /* in-flight sends per sender in the burst variants */
+
 #define ARRAY_SIZE(a) (sizeof((a)) / sizeof((a)[0]))
 
 static uv_loop_t* loop;
@@ -56,9 +59,9 @@ typedef struct {
 
 
 static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
-  static char slab[65536];
+  static char slab[RECV_BATCH * 65536];
   ASSERT(suggested_size <= sizeof slab);
-  return uv_buf_init(slab, sizeof slab);
+  return uv_buf_init(slab, suggested_size);
 }
 
 
@@ -123,12 +126,16 @@ static void timeout_cb(uv_timer_t* timer, int status) {
 }
 
 
-static int do_packet_storm(int n_senders, int n_receivers) {
+static int do_packet_storm(int n_senders,
+                           int n_receivers,
+                           int recv_batch,
+                           int send_depth) {
   uv_timer_t timeout;
   sender_state_t *ss;
   uv_udp_send_t* req;
   uv_udp_t* handle;
   int i;
+  int j;
   int r;
 
   ASSERT(n_senders <= MAX_SENDERS);
@@ -160,7 +167,10 @@ static int do_packet_storm(int n_senders, int n_receivers) {
     r = uv_udp_bind(handle, addr, 0);
     ASSERT(r == 0);
 
-    r = uv_udp_recv_start(handle, alloc_cb, recv_cb);
+    if (recv_batch)
+      r = uv_udp_recv_start_batch(handle, alloc_cb, recv_cb, RECV_BATCH);
+    else
+      r = uv_udp_recv_start(handle, alloc_cb, recv_cb);
     ASSERT(r == 0);
   }
 
@@ -176,20 +186,24 @@ static int do_packet_storm(int n_senders, int n_receivers) {
     r = uv_udp_init(loop, handle);
     ASSERT(r == 0);
 
-    req = malloc(sizeof(*req) + sizeof(*ss));
-
-    ss = (void*)(req + 1);
+    ss = malloc(sizeof(*ss));
     ss->addr = uv_ip4_addr("127.0.0.1", BASE_PORT + (i % n_receivers));
 
-    r = uv_udp_send(req, handle, bufs, ARRAY_SIZE(bufs), ss->addr, send_cb);
-    ASSERT(r == 0);
+    for (j = 0; j < send_depth; j++) {
+      req = malloc(sizeof(*req));
+
+      r = uv_udp_send(req, handle, bufs, ARRAY_SIZE(bufs), ss->addr, send_cb);
+      ASSERT(r == 0);
 
-    req->data = ss;
+      req->data = ss;
+    }
   }
 
   uv_run(loop);
 
-  printf("udp_packet_storm_%dv%d: %.0f/s received, %.0f/s sent\n",
+  printf("udp_packet_storm_%s%s%dv%d: %.0f/s received, %.0f/s sent\n",
+         recv_batch ? "batch_" : "",
+         send_depth > 1 ? "burst_" : "",
          n_receivers,
          n_senders,
          recv_cb_called / (TEST_DURATION / 1000.0),
@@ -200,50 +214,85 @@ static int do_packet_storm(int n_senders, int n_receivers) {
 
 
 BENCHMARK_IMPL(udp_packet_storm_1v1) {
-  return do_packet_storm(1, 1);
+  return do_packet_storm(1, 1, 0, 1);
 }
 
 
 BENCHMARK_IMPL(udp_packet_storm_1v10) {
-  return do_packet_storm(1, 10);
+  return do_packet_storm(1, 10, 0, 1);
 }
 
 
 BENCHMARK_IMPL(udp_packet_storm_1v100) {
-  return do_packet_storm(1, 100);
+  return do_packet_storm(1, 100, 0, 1);
 }
 
 
 BENCHMARK_IMPL(udp_packet_storm_1v1000) {
-  return do_packet_storm(1, 1000);
+  return do_packet_storm(1, 1000, 0, 1);
 }
 
 
 BENCHMARK_IMPL(udp_packet_storm_10v10) {
-  return do_packet_storm(10, 10);
+  return do_packet_storm(10, 10, 0, 1);
 }
 
 
 BENCHMARK_IMPL(udp_packet_storm_10v100) {
-  return do_packet_storm(10, 100);
+  return do_packet_storm(10, 100, 0, 1);
 }
 
 
 BENCHMARK_IMPL(udp_packet_storm_10v1000) {
-  return do_packet_storm(10, 1000);
+  return do_packet_storm(10, 1000, 0, 1);
 }
 
 
 BENCHMARK_IMPL(udp_packet_storm_100v100) {
-  return do_packet_storm(100, 100);
+  return do_packet_storm(100, 100, 0, 1);
 }
 
 
 BENCHMARK_IMPL(udp_packet_storm_100v1000) {
-  return do_packet_storm(100, 1000);
+  return do_packet_storm(100, 1000, 0, 1);
 }
 
 
 BENCHMARK_IMPL(udp_packet_storm_1000v1000) {
-  return do_packet_storm(1000, 1000);
+  return do_packet_storm(1000, 1000, 0, 1);
+}
+
+
+BENCHMARK_IMPL(udp_packet_storm_batch_1v1) {
+  return do_packet_storm(1, 1, 1, 1);
+}
+
+
+BENCHMARK_IMPL(udp_packet_storm_batch_10v10) {
+  return do_packet_storm(10, 10, 1, 1);
+}
+
+
+BENCHMARK_IMPL(udp_packet_storm_batch_100v100) {
+  return do_packet_storm(100, 100, 1, 1);
+}
+
+
+BENCHMARK_IMPL(udp_packet_storm_burst_1v1) {
+  return do_packet_storm(1, 1, 0, BURST_DEPTH);
+}
+
+
+BENCHMARK_IMPL(udp_packet_storm_burst_10v10) {
+  return do_packet_storm(10, 10, 0, BURST_DEPTH);
+}
+
+
+BENCHMARK_IMPL(udp_packet_storm_batch_burst_1v1) {
+  return do_packet_storm(1, 1, 1, BURST_DEPTH);
+}
+
+
+BENCHMARK_IMPL(udp_packet_storm_batch_burst_10v10) {
+  return do_packet_storm(10, 10, 1, BURST_DEPTH);
 }
@@ -0,0 +1,73 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+/* Handles that are closed while they're pending don't get their callback,
+ * the other pending handles on the loop still do, once per wakeup.
+ */
+
+static uv_async_t handles[3];
+static int async_cb_called[3];
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void async_cb(uv_async_t* handle, int status) {
+  int i = (int)(handle - handles);
+
+  ASSERT(i != 1);
+  async_cb_called[i]++;
+
+  uv_close((uv_handle_t*)handle, close_cb);
+}
+
+
+TEST_IMPL(async_close_pending) {
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_default_loop();
+
+  for (i = 0; i < 3; i++)
+    ASSERT(0 == uv_async_init(loop, &handles[i], async_cb));
+
+  for (i = 0; i < 3; i++) {
+    ASSERT(0 == uv_async_send(&handles[i]));
+    ASSERT(0 == uv_async_send(&handles[i]));
+  }
+
+  uv_close((uv_handle_t*)&handles[1], close_cb);
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(async_cb_called[0] == 1);
+  ASSERT(async_cb_called[1] == 0);
+  ASSERT(async_cb_called[2] == 1);
+  ASSERT(close_cb_called == 3);
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifndef _WIN32
+
+#define NUM_PRODUCERS 4
+#define NUM_MESSAGES  10000
+
+typedef struct {
+  uv_channel_msg_t msg;
+  int producer;
+  int seq;
+} test_msg_t;
+
+static uv_channel_t channel;
+static uv_thread_t threads[NUM_PRODUCERS];
+static test_msg_t msgs[NUM_PRODUCERS][NUM_MESSAGES];
+static int next_seq[NUM_PRODUCERS];
+
+static int channel_cb_called;
+static int received;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  ASSERT(handle == (uv_handle_t*)&channel);
+  close_cb_called++;
+}
+
+
+static void producer(void* arg) {
+  int producer = (int)(long)arg;
+  test_msg_t* m;
+  int i;
+
+  for (i = 0; i < NUM_MESSAGES; i++) {
+    m = &msgs[producer][i];
+    m->producer = producer;
+    m->seq = i;
+    ASSERT(0 == uv_channel_send(&channel, &m->msg));
+  }
+}
+
+
+static void channel_cb(uv_channel_t* handle, uv_channel_msg_t* msg,
+    int count) {
+  test_msg_t* m;
+  int n;
+
+  ASSERT(handle == &channel);
+  ASSERT(count > 0);
+  channel_cb_called++;
+
+  for (n = 0; msg != NULL; n++, msg = msg->next) {
+    m = (test_msg_t*)msg;
+    /* Messages from one producer come in the order they were sent. */
+    ASSERT(m->seq == next_seq[m->producer]);
+    next_seq[m->producer]++;
+  }
+
+  ASSERT(n == count);
+  received += count;
+
+  if (received == NUM_PRODUCERS * NUM_MESSAGES)
+    uv_close((uv_handle_t*)handle, close_cb);
+}
+
+
+TEST_IMPL(channel) {
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == uv_channel_init(loop, &channel, channel_cb));
+
+  for (i = 0; i < NUM_PRODUCERS; i++)
+    ASSERT(0 == uv_thread_create(&threads[i], producer, (void*)(long)i));
+
+  ASSERT(0 == uv_run(loop));
+
+  for (i = 0; i < NUM_PRODUCERS; i++)
+    ASSERT(0 == uv_thread_join(&threads[i]));
+
+  ASSERT(received == NUM_PRODUCERS * NUM_MESSAGES);
+  ASSERT(close_cb_called == 1);
+
+  /* Sends are batched, there's far less than one callback per message. */
+  ASSERT(channel_cb_called < received);
+
+  return 0;
+}
+
+
+static void close_pending_cb(uv_channel_t* handle, uv_channel_msg_t* msg,
+    int count) {
+  ASSERT(close_cb_called == 0);
+  ASSERT(count == 3);
+  ASSERT(msg->data == (void*)1);
+  ASSERT(msg->next->data == (void*)2);
+  ASSERT(msg->next->next->data == (void*)3);
+  ASSERT(msg->next->next->next == NULL);
+  channel_cb_called++;
+}
+
+
+TEST_IMPL(channel_close_pending) {
+  uv_channel_msg_t pending[3];
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == uv_channel_init(loop, &channel, close_pending_cb));
+
+  for (i = 0; i < 3; i++) {
+    pending[i].data = (void*)(long)(i + 1);
+    ASSERT(0 == uv_channel_send(&channel, &pending[i]));
+  }
+
+  /* Queued messages are still delivered, before the close callback. */
+  uv_close((uv_handle_t*)&channel, close_cb);
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(channel_cb_called == 1);
+  ASSERT(close_cb_called == 1);
+
+  return 0;
+}
+
+#else
+
+TEST_IMPL(channel) {
+  /* Not implemented on Windows yet. */
+  return 0;
+}
+
+
+TEST_IMPL(channel_close_pending) {
+  return 0;
+}
+
+#endif
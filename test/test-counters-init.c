@@ -93,6 +93,7 @@ static void create_cb(uv_fs_t* req) {
 TEST_IMPL(counters_init) {
   int r;
   int eio_init_prev;
+  int threadpool_init_prev;
   int req_init_prev;
   int handle_init_prev;
   int stream_init_prev;
@@ -108,17 +109,22 @@ TEST_IMPL(counters_init) {
   int process_init_prev;
   int fs_event_init_prev;
 
-  /* req_init and eio_init test by uv_fs_open() */
+  /* req_init and threadpool_init test by uv_fs_open(). fs requests run on
+   * the thread pool, they don't set up eio.
+   */
   unlink("test_file");
   req_init_prev = uv_default_loop()->counters.req_init;
   eio_init_prev = uv_default_loop()->counters.eio_init;
+  threadpool_init_prev = uv_default_loop()->counters.threadpool_init;
   r = uv_fs_open(uv_default_loop(), &open_req, "test_file", O_WRONLY | O_CREAT,
                  S_IREAD | S_IWRITE, create_cb);
   ASSERT(r == 0);
   ASSERT(open_req.result == 0);
   ASSERT(uv_default_loop()->counters.req_init == ++req_init_prev);
 #ifndef _WIN32
-  ASSERT(uv_default_loop()->counters.eio_init == ++eio_init_prev);
+  ASSERT(uv_default_loop()->counters.threadpool_init ==
+         ++threadpool_init_prev);
+  ASSERT(uv_default_loop()->counters.eio_init == eio_init_prev);
 #endif
 
   /* tcp_init, stream_init and handle_init test by uv_tcp_init() */
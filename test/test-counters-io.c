@@ -0,0 +1,154 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#define CHUNK_SIZE (64 * 1024)
+#define WRITE_SIZE (1024 * 1024)
+
+static uv_pipe_t writer;
+static uv_pipe_t reader;
+static uv_write_t write_req;
+static uv_work_t work_req;
+static char chunk[CHUNK_SIZE];
+static char slab[CHUNK_SIZE];
+static char* data;
+static size_t nwritten;
+static size_t nread;
+static int write_cb_called;
+static int after_work_cb_called;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  return uv_buf_init(slab, sizeof slab);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t n, uv_buf_t buf) {
+  ASSERT(n >= 0);
+  nread += n;
+
+  if (nread == nwritten) {
+    uv_close((uv_handle_t*)&reader, NULL);
+    uv_close((uv_handle_t*)&writer, NULL);
+  }
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  write_cb_called++;
+}
+
+
+static void work_cb(uv_work_t* req) {
+}
+
+
+static void after_work_cb(uv_work_t* req) {
+  ASSERT(req->loop->counters.work_pending == 0);
+  after_work_cb_called++;
+}
+
+
+TEST_IMPL(counters_io) {
+  uv_counters_t before;
+  uv_counters_t* after;
+  uv_loop_t* loop;
+  uv_buf_t buf;
+  int fds[2];
+  int r;
+
+  loop = uv_default_loop();
+  after = &loop->counters;
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == fcntl(fds[0], F_SETFL, O_NONBLOCK));
+  ASSERT(0 == fcntl(fds[1], F_SETFL, O_NONBLOCK));
+
+  ASSERT(0 == uv_pipe_init(loop, &writer, 0));
+  ASSERT(0 == uv_pipe_init(loop, &reader, 0));
+  uv_pipe_open(&writer, fds[0]);
+  uv_pipe_open(&reader, fds[1]);
+
+  before = *after;
+
+  /* Fill the socket until the kernel pushes back. */
+  buf = uv_buf_init(chunk, sizeof chunk);
+  while ((r = uv_try_write((uv_stream_t*)&writer, &buf, 1)) > 0)
+    nwritten += r;
+
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(loop).code == UV_EAGAIN);
+  ASSERT(nwritten > 0);
+  ASSERT(after->eagain == before.eagain + 1);
+  ASSERT(after->write_bytes == before.write_bytes + nwritten);
+  ASSERT(after->write_syscalls > before.write_syscalls);
+
+  /* Only drains as the reader makes room, a bit at a time. */
+  data = malloc(WRITE_SIZE);
+  ASSERT(data != NULL);
+  memset(data, 'x', WRITE_SIZE);
+  buf = uv_buf_init(data, WRITE_SIZE);
+  ASSERT(0 == uv_write(&write_req, (uv_stream_t*)&writer, &buf, 1, write_cb));
+  nwritten += WRITE_SIZE;
+
+  ASSERT(0 == uv_read_start((uv_stream_t*)&reader, alloc_cb, read_cb));
+
+  ASSERT(0 == uv_run(loop));
+  ASSERT(write_cb_called == 1);
+  ASSERT(nread == nwritten);
+
+  ASSERT(after->write_bytes == before.write_bytes + nwritten);
+  ASSERT(after->read_bytes == before.read_bytes + nread);
+  ASSERT(after->read_syscalls > before.read_syscalls);
+  ASSERT(after->partial_writes > before.partial_writes);
+  ASSERT(after->eagain > before.eagain + 1);
+
+  free(data);
+
+  /* The thread pool depth goes up on submit and down before the callback. */
+  ASSERT(0 == uv_queue_work(loop, &work_req, work_cb, after_work_cb));
+  ASSERT(after->work_pending == 1);
+  ASSERT(after->work_pending_max >= 1);
+
+  ASSERT(0 == uv_run(loop));
+  ASSERT(after_work_cb_called == 1);
+  ASSERT(after->work_pending == 0);
+
+  return 0;
+}
+
+#else
+
+TEST_IMPL(counters_io) {
+  /* Windows doesn't maintain the I/O counters yet. */
+  return 0;
+}
+
+#endif
@@ -0,0 +1,152 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+# include <io.h>
+# define unlink _unlink
+#else
+# include <unistd.h>
+#endif
+
+/* Runs a chain of fs requests on a loop that submits them through its own
+ * io_uring. Where that isn't available the requests go to the thread pool
+ * and this exercises the regular code path.
+ */
+
+#define TEST_FILE "test_file_io_uring"
+#define DATA "hello, io_uring\n"
+
+static uv_loop_t* loop;
+static uv_fs_t req;
+static uv_file file;
+static char buf[64];
+static int step;
+
+
+static void fs_cb(uv_fs_t* r);
+
+
+static void next(void) {
+  int rc;
+
+  switch (step++) {
+    case 0:
+      rc = uv_fs_open(loop, &req, "does_not_exist_io_uring", O_RDONLY, 0,
+          fs_cb);
+      break;
+    case 1:
+      rc = uv_fs_open(loop, &req, TEST_FILE, O_RDWR | O_CREAT | O_TRUNC,
+          S_IREAD | S_IWRITE, fs_cb);
+      break;
+    case 2:
+      rc = uv_fs_write(loop, &req, file, DATA, sizeof(DATA) - 1, -1, fs_cb);
+      break;
+    case 3:
+      rc = uv_fs_fsync(loop, &req, file, fs_cb);
+      break;
+    case 4:
+      rc = uv_fs_fstat(loop, &req, file, fs_cb);
+      break;
+    case 5:
+      rc = uv_fs_read(loop, &req, file, buf, sizeof(buf), 0, fs_cb);
+      break;
+    case 6:
+      rc = uv_fs_stat(loop, &req, TEST_FILE, fs_cb);
+      break;
+    case 7:
+      rc = uv_fs_lstat(loop, &req, TEST_FILE, fs_cb);
+      break;
+    case 8:
+      rc = uv_fs_close(loop, &req, file, fs_cb);
+      break;
+    case 9:
+      rc = uv_fs_unlink(loop, &req, TEST_FILE, fs_cb);
+      break;
+    default:
+      return;
+  }
+
+  ASSERT(rc == 0);
+}
+
+
+static void fs_cb(uv_fs_t* r) {
+  struct stat* s;
+
+  ASSERT(r == &req);
+
+  switch (step) {
+    case 1:
+      ASSERT(req.result == -1);
+      ASSERT(req.errorno == UV_ENOENT);
+      break;
+    case 2:
+      ASSERT(req.result >= 0);
+      file = req.result;
+      break;
+    case 3:
+      ASSERT(req.result == sizeof(DATA) - 1);
+      break;
+    case 5:
+    case 7:
+    case 8:
+      ASSERT(req.result == 0);
+      s = req.ptr;
+      ASSERT(s != NULL);
+      ASSERT((s->st_mode & S_IFMT) == S_IFREG);
+      ASSERT(s->st_size == sizeof(DATA) - 1);
+      ASSERT(s->st_nlink == 1);
+      break;
+    case 6:
+      ASSERT(req.result == sizeof(DATA) - 1);
+      ASSERT(memcmp(buf, DATA, sizeof(DATA) - 1) == 0);
+      break;
+    default:
+      ASSERT(req.result == 0);
+      break;
+  }
+
+  uv_fs_req_cleanup(&req);
+  next();
+}
+
+
+TEST_IMPL(fs_io_uring) {
+  unlink(TEST_FILE);
+
+  loop = uv_loop_new2(UV_LOOP_IO_URING);
+  ASSERT(loop != NULL);
+
+  next();
+  uv_run(loop);
+
+  ASSERT(step == 11);
+
+  uv_loop_delete(loop);
+  return 0;
+}
@@ -30,6 +30,31 @@ TEST_DECLARE   (pipe_ping_pong)
 TEST_DECLARE   (delayed_accept)
 TEST_DECLARE   (multiple_listen)
 TEST_DECLARE   (tcp_writealot)
+TEST_DECLARE   (tcp_write_coalesce)
+TEST_DECLARE   (pipe_write_coalesce)
+TEST_DECLARE   (tcp_write_file)
+TEST_DECLARE   (tcp_write_file_short)
+TEST_DECLARE   (tcp_zerocopy)
+TEST_DECLARE   (tcp_watermarks)
+TEST_DECLARE   (tcp_try_write)
+TEST_DECLARE   (tcp_accept_batch)
+TEST_DECLARE   (tcp_accept_emfile)
+TEST_DECLARE   (tcp_accept_options)
+TEST_DECLARE   (tcp_reuseport)
+TEST_DECLARE   (udp_reuseport)
+TEST_DECLARE   (tcp_shards)
+TEST_DECLARE   (loop_metrics)
+TEST_DECLARE   (loop_metrics_between_runs)
+TEST_DECLARE   (loop_epoll)
+TEST_DECLARE   (loop_epoll_file)
+TEST_DECLARE   (loop_io_uring)
+TEST_DECLARE   (loop_io_uring_close)
+TEST_DECLARE   (read_pool)
+TEST_DECLARE   (read_pool_io_uring)
+TEST_DECLARE   (read_pool_no_alloc_cb)
+TEST_DECLARE   (tcp_splice)
+TEST_DECLARE   (tcp_splice_close)
+TEST_DECLARE   (tcp_splice_write)
 TEST_DECLARE   (tcp_bind_error_addrinuse)
 TEST_DECLARE   (tcp_bind_error_addrnotavail_1)
 TEST_DECLARE   (tcp_bind_error_addrnotavail_2)
@@ -47,6 +72,8 @@ TEST_DECLARE   (tcp_bind6_error_fault)
 TEST_DECLARE   (tcp_bind6_error_inval)
 TEST_DECLARE   (tcp_bind6_localhost_ok)
 TEST_DECLARE   (udp_send_and_recv)
+TEST_DECLARE   (udp_try_send)
+TEST_DECLARE   (udp_recv_batch)
 TEST_DECLARE   (udp_multicast_join)
 TEST_DECLARE   (udp_dgram_too_big)
 TEST_DECLARE   (udp_dual_stack)
@@ -63,6 +90,7 @@ TEST_DECLARE   (callback_stack)
 TEST_DECLARE   (error_message)
 TEST_DECLARE   (timer)
 TEST_DECLARE   (timer_again)
+TEST_DECLARE   (timer_wheel)
 TEST_DECLARE   (idle_starvation)
 TEST_DECLARE   (loop_handles)
 TEST_DECLARE   (get_loadavg)
@@ -86,6 +114,9 @@ TEST_DECLARE   (pipe_ref2)
 TEST_DECLARE   (pipe_ref3)
 TEST_DECLARE   (process_ref)
 TEST_DECLARE   (async)
+TEST_DECLARE   (async_close_pending)
+TEST_DECLARE   (channel)
+TEST_DECLARE   (channel_close_pending)
 TEST_DECLARE   (get_currentexe)
 TEST_DECLARE   (process_title)
 TEST_DECLARE   (cwd_and_chdir)
@@ -107,6 +138,7 @@ TEST_DECLARE   (spawn_and_ping)
 TEST_DECLARE   (kill)
 TEST_DECLARE   (fs_file_noent)
 TEST_DECLARE   (fs_file_async)
+TEST_DECLARE   (fs_io_uring)
 TEST_DECLARE   (fs_file_sync)
 TEST_DECLARE   (fs_async_dir)
 TEST_DECLARE   (fs_async_sendfile)
@@ -130,6 +162,10 @@ TEST_DECLARE   (fs_open_dir)
 TEST_DECLARE   (fs_rename_to_existing_file)
 TEST_DECLARE   (threadpool_queue_work_simple)
 TEST_DECLARE   (threadpool_multiple_event_loops)
+TEST_DECLARE   (threadpool_per_loop)
+TEST_DECLARE   (threadpool_cancel)
+TEST_DECLARE   (threadpool_lanes)
+TEST_DECLARE   (threadpool_lanes_stall)
 TEST_DECLARE   (eio_overflow)
 TEST_DECLARE   (thread_mutex)
 TEST_DECLARE   (thread_rwlock)
@@ -137,6 +173,7 @@ TEST_DECLARE   (thread_create)
 TEST_DECLARE   (strlcpy)
 TEST_DECLARE   (strlcat)
 TEST_DECLARE   (counters_init)
+TEST_DECLARE   (counters_io)
 #ifdef _WIN32
 TEST_DECLARE   (spawn_detect_pipe_name_collisions_on_windows)
 TEST_DECLARE   (argument_escaping)
@@ -175,6 +212,42 @@ TASK_LIST_START
   TEST_ENTRY  (tcp_writealot)
   TEST_HELPER (tcp_writealot, tcp4_echo_server)
 
+  TEST_ENTRY  (tcp_write_coalesce)
+  TEST_HELPER (tcp_write_coalesce, tcp4_echo_server)
+
+  TEST_ENTRY  (pipe_write_coalesce)
+
+  TEST_ENTRY  (tcp_write_file)
+  TEST_ENTRY  (tcp_write_file_short)
+
+  TEST_ENTRY  (tcp_zerocopy)
+  TEST_ENTRY  (tcp_watermarks)
+  TEST_ENTRY  (tcp_try_write)
+  TEST_ENTRY  (tcp_accept_batch)
+  TEST_ENTRY  (tcp_accept_emfile)
+  TEST_ENTRY  (tcp_accept_options)
+  TEST_ENTRY  (tcp_reuseport)
+  TEST_ENTRY  (udp_reuseport)
+  TEST_ENTRY  (tcp_shards)
+
+  TEST_ENTRY  (loop_metrics)
+  TEST_ENTRY  (loop_metrics_between_runs)
+
+  TEST_ENTRY  (loop_epoll)
+  TEST_HELPER (loop_epoll, tcp4_echo_server)
+  TEST_ENTRY  (loop_epoll_file)
+
+  TEST_ENTRY  (loop_io_uring)
+  TEST_ENTRY  (loop_io_uring_close)
+
+  TEST_ENTRY  (read_pool)
+  TEST_ENTRY  (read_pool_io_uring)
+  TEST_ENTRY  (read_pool_no_alloc_cb)
+
+  TEST_ENTRY  (tcp_splice)
+  TEST_ENTRY  (tcp_splice_close)
+  TEST_ENTRY  (tcp_splice_write)
+
   TEST_ENTRY  (tcp_bind_error_addrinuse)
   TEST_ENTRY  (tcp_bind_error_addrnotavail_1)
   TEST_ENTRY  (tcp_bind_error_addrnotavail_2)
@@ -194,6 +267,8 @@ TASK_LIST_START
   TEST_ENTRY  (tcp_bind6_localhost_ok)
 
   TEST_ENTRY  (udp_send_and_recv)
+  TEST_ENTRY  (udp_try_send)
+  TEST_ENTRY  (udp_recv_batch)
   TEST_ENTRY  (udp_dgram_too_big)
   TEST_ENTRY  (udp_dual_stack)
   TEST_ENTRY  (udp_ipv6_only)
@@ -217,6 +292,7 @@ TASK_LIST_START
 
   TEST_ENTRY  (timer)
   TEST_ENTRY  (timer_again)
+  TEST_ENTRY  (timer_wheel)
 
   TEST_ENTRY  (idle_starvation)
 
@@ -246,6 +322,9 @@ TASK_LIST_START
   TEST_ENTRY  (loop_handles)
 
   TEST_ENTRY  (async)
+  TEST_ENTRY  (async_close_pending)
+  TEST_ENTRY  (channel)
+  TEST_ENTRY  (channel_close_pending)
 
   TEST_ENTRY  (get_currentexe)
 
@@ -285,6 +364,7 @@ TASK_LIST_START
 
   TEST_ENTRY  (fs_file_noent)
   TEST_ENTRY  (fs_file_async)
+  TEST_ENTRY  (fs_io_uring)
   TEST_ENTRY  (fs_file_sync)
   TEST_ENTRY  (fs_async_dir)
   TEST_ENTRY  (fs_async_sendfile)
@@ -307,6 +387,10 @@ TASK_LIST_START
   TEST_ENTRY  (fs_rename_to_existing_file)
   TEST_ENTRY  (threadpool_queue_work_simple)
   TEST_ENTRY  (threadpool_multiple_event_loops)
+  TEST_ENTRY  (threadpool_per_loop)
+  TEST_ENTRY  (threadpool_cancel)
+  TEST_ENTRY  (threadpool_lanes)
+  TEST_ENTRY  (threadpool_lanes_stall)
   TEST_ENTRY  (eio_overflow)
   TEST_ENTRY  (thread_mutex)
   TEST_ENTRY  (thread_rwlock)
@@ -314,6 +398,7 @@ TASK_LIST_START
   TEST_ENTRY  (strlcpy)
   TEST_ENTRY  (strlcat)
   TEST_ENTRY  (counters_init)
+  TEST_ENTRY  (counters_io)
 #if 0
   /* These are for testing the test runner. */
   TEST_ENTRY  (fail_always)
@@ -0,0 +1,212 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Runs a ping-pong against the echo server on a loop that polls its streams
+ * through its own epoll set. On other platforms the flag is ignored and this
+ * exercises the regular code path.
+ */
+
+#define PING "PING"
+#define NUM_PINGS 100
+
+static uv_loop_t* loop;
+static uv_tcp_t client;
+static uv_connect_t connect_req;
+static uv_write_t write_req;
+static uv_buf_t ping_buf;
+
+static char pong[sizeof(PING) - 1];
+static size_t pong_len;
+static int pongs;
+static int close_cb_called;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t size) {
+  return uv_buf_init(malloc(size), size);
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  ASSERT(handle == (uv_handle_t*)&client);
+  close_cb_called++;
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(req == &write_req);
+  ASSERT(status == 0);
+}
+
+
+static void send_ping(void) {
+  int r;
+
+  ping_buf = uv_buf_init(PING, sizeof(PING) - 1);
+  r = uv_write(&write_req, (uv_stream_t*)&client, &ping_buf, 1, write_cb);
+  ASSERT(r == 0);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  ssize_t i;
+
+  ASSERT(stream == (uv_stream_t*)&client);
+  ASSERT(nread >= 0);
+
+  for (i = 0; i < nread; i++) {
+    pong[pong_len++] = buf.base[i];
+
+    if (pong_len == sizeof pong) {
+      ASSERT(memcmp(pong, PING, sizeof pong) == 0);
+      pong_len = 0;
+
+      if (++pongs == NUM_PINGS)
+        uv_close((uv_handle_t*)&client, close_cb);
+      else
+        send_ping();
+    }
+  }
+
+  free(buf.base);
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  int r;
+
+  ASSERT(req == &connect_req);
+  ASSERT(status == 0);
+
+  r = uv_read_start((uv_stream_t*)&client, alloc_cb, read_cb);
+  ASSERT(r == 0);
+
+  send_ping();
+}
+
+
+TEST_IMPL(loop_epoll) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  int r;
+
+  loop = uv_loop_new2(UV_LOOP_EPOLL);
+  ASSERT(loop != NULL);
+
+  r = uv_tcp_init(loop, &client);
+  ASSERT(r == 0);
+
+  r = uv_tcp_connect(&connect_req, &client, addr, connect_cb);
+  ASSERT(r == 0);
+
+  r = uv_run(loop);
+  ASSERT(r == 0);
+
+  ASSERT(pongs == NUM_PINGS);
+  ASSERT(close_cb_called == 1);
+  ASSERT(uv_loop_refcount(loop) == 0);
+
+  uv_loop_delete(loop);
+
+  return 0;
+}
+
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/* epoll refuses regular files, the stream has to be read regardless. */
+
+#define FILE_NAME "test_file_loop_epoll"
+#define FILE_DATA "hello"
+
+static uv_pipe_t file_pipe;
+static char file_read[sizeof(FILE_DATA) - 1];
+static size_t file_nread;
+static int file_eof;
+
+
+static void file_close_cb(uv_handle_t* handle) {
+  ASSERT(handle == (uv_handle_t*)&file_pipe);
+  close_cb_called++;
+}
+
+
+static void file_read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  if (nread == -1) {
+    ASSERT(uv_last_error(loop).code == UV_EOF);
+    file_eof++;
+    uv_close((uv_handle_t*)stream, file_close_cb);
+  } else if (nread > 0) {
+    ASSERT(file_nread + nread <= sizeof file_read);
+    memcpy(file_read + file_nread, buf.base, nread);
+    file_nread += nread;
+  }
+
+  free(buf.base);
+}
+
+
+TEST_IMPL(loop_epoll_file) {
+  int fd;
+
+  unlink(FILE_NAME);
+  fd = open(FILE_NAME, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  ASSERT(fd != -1);
+  ASSERT(write(fd, FILE_DATA, sizeof(FILE_DATA) - 1) ==
+         sizeof(FILE_DATA) - 1);
+  ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+
+  loop = uv_loop_new2(UV_LOOP_EPOLL);
+  ASSERT(loop != NULL);
+
+  ASSERT(0 == uv_pipe_init(loop, &file_pipe, 0));
+  uv_pipe_open(&file_pipe, fd);
+  ASSERT(0 == uv_read_start((uv_stream_t*)&file_pipe, alloc_cb, file_read_cb));
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(file_eof == 1);
+  ASSERT(close_cb_called == 1);
+  ASSERT(file_nread == sizeof file_read);
+  ASSERT(0 == memcmp(file_read, FILE_DATA, sizeof file_read));
+  ASSERT(uv_loop_refcount(loop) == 0);
+
+  uv_loop_delete(loop);
+  unlink(FILE_NAME);
+
+  return 0;
+}
+
+#else
+
+TEST_IMPL(loop_epoll_file) {
+  /* uv_pipe_open() doesn't take files on Windows. */
+  return 0;
+}
+
+#endif
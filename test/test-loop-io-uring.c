@@ -0,0 +1,336 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Streams data from a few clients to a server that live on the same loop,
+ * which does its stream I/O through an io_uring. The writes are large
+ * enough not to go out in one go and the server pauses reading every now
+ * and then. Where io_uring isn't available the flag is ignored and this
+ * exercises the regular code path.
+ */
+
+#define NUM_CLIENTS 8
+#define NUM_WRITES 32
+#define WRITE_SIZE (256 * 1024)
+#define TOTAL_SIZE (NUM_WRITES * WRITE_SIZE)
+
+typedef struct {
+  uv_tcp_t handle;
+  size_t nread;
+  int nreads;
+  int paused;
+} conn_t;
+
+typedef struct {
+  uv_tcp_t handle;
+  uv_connect_t connect_req;
+  uv_write_t write_reqs[NUM_WRITES];
+  uv_shutdown_t shutdown_req;
+} client_t;
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_idle_t idle;
+static conn_t conns[NUM_CLIENTS];
+static client_t clients[NUM_CLIENTS];
+static char data[WRITE_SIZE];
+
+static int num_conns;
+static int write_cb_called;
+static int shutdown_cb_called;
+static int eof_cb_called;
+static int close_cb_called;
+static int pauses;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t size) {
+  return uv_buf_init(malloc(size), size);
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void conn_close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+
+  if (++eof_cb_called == NUM_CLIENTS) {
+    uv_close((uv_handle_t*)&server, close_cb);
+    uv_close((uv_handle_t*)&idle, close_cb);
+  }
+}
+
+
+static void idle_cb(uv_idle_t* handle, int status);
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  conn_t* conn;
+  ssize_t i;
+
+  conn = (conn_t*)stream;
+
+  if (nread == -1) {
+    ASSERT(uv_last_error(loop).code == UV_EOF);
+    ASSERT(conn->nread == TOTAL_SIZE);
+    uv_close((uv_handle_t*)stream, conn_close_cb);
+    free(buf.base);
+    return;
+  }
+
+  for (i = 0; i < nread; i++)
+    ASSERT((unsigned char)buf.base[i] == ((conn->nread + i) & 255));
+
+  conn->nread += nread;
+  free(buf.base);
+
+  /* Leave whatever comes in meanwhile to be picked up after the restart. */
+  if (nread > 0 && ++conn->nreads % 10 == 0) {
+    ASSERT(0 == uv_read_stop(stream));
+    conn->paused = 1;
+    pauses++;
+    ASSERT(0 == uv_idle_start(&idle, idle_cb));
+  }
+}
+
+
+static void idle_cb(uv_idle_t* handle, int status) {
+  int i;
+
+  ASSERT(0 == uv_idle_stop(handle));
+
+  for (i = 0; i < num_conns; i++) {
+    if (conns[i].paused) {
+      conns[i].paused = 0;
+      ASSERT(0 == uv_read_start((uv_stream_t*)&conns[i].handle,
+                                alloc_cb,
+                                read_cb));
+    }
+  }
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  conn_t* conn;
+
+  ASSERT(stream == (uv_stream_t*)&server);
+  ASSERT(status == 0);
+  ASSERT(num_conns < NUM_CLIENTS);
+
+  conn = conns + num_conns++;
+  ASSERT(0 == uv_tcp_init(loop, &conn->handle));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)&conn->handle));
+  ASSERT(0 == uv_read_start((uv_stream_t*)&conn->handle, alloc_cb, read_cb));
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+  shutdown_cb_called++;
+  uv_close((uv_handle_t*)req->handle, close_cb);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  write_cb_called++;
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  client_t* client;
+  uv_buf_t buf;
+  int i;
+
+  ASSERT(status == 0);
+  client = (client_t*)req->handle;
+
+  buf = uv_buf_init(data, sizeof data);
+
+  for (i = 0; i < NUM_WRITES; i++) {
+    ASSERT(0 == uv_write(&client->write_reqs[i],
+                         (uv_stream_t*)&client->handle,
+                         &buf,
+                         1,
+                         write_cb));
+  }
+
+  ASSERT(0 == uv_shutdown(&client->shutdown_req,
+                          (uv_stream_t*)&client->handle,
+                          shutdown_cb));
+}
+
+
+TEST_IMPL(loop_io_uring) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  int i;
+
+  for (i = 0; i < WRITE_SIZE; i++)
+    data[i] = i & 255;
+
+  loop = uv_loop_new2(UV_LOOP_IO_URING_NET);
+  ASSERT(loop != NULL);
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, connection_cb));
+
+  ASSERT(0 == uv_idle_init(loop, &idle));
+
+  for (i = 0; i < NUM_CLIENTS; i++) {
+    ASSERT(0 == uv_tcp_init(loop, &clients[i].handle));
+    ASSERT(0 == uv_tcp_connect(&clients[i].connect_req,
+                               &clients[i].handle,
+                               addr,
+                               connect_cb));
+  }
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(num_conns == NUM_CLIENTS);
+  ASSERT(write_cb_called == NUM_CLIENTS * NUM_WRITES);
+  ASSERT(shutdown_cb_called == NUM_CLIENTS);
+  ASSERT(eof_cb_called == NUM_CLIENTS);
+  ASSERT(close_cb_called == 2 * NUM_CLIENTS + 2);
+  ASSERT(pauses > 0);
+  ASSERT(uv_loop_refcount(loop) == 0);
+
+  uv_loop_delete(loop);
+
+  return 0;
+}
+
+
+/* Closes a client while its write is stuck in a send op because the peer
+ * doesn't read. The write callback has to come before the close callback,
+ * with the send either cancelled or failed by the close.
+ */
+
+#define CLOSE_WRITE_SIZE (8 * 1024 * 1024)
+
+static uv_tcp_t close_client;
+static uv_tcp_t close_conn;
+static uv_connect_t close_connect_req;
+static uv_write_t close_write_reqs[2];
+static char* close_data;
+static int close_connected;
+static int close_write_cb_called;
+static int close_close_cb_called;
+
+
+static void close_close_cb(uv_handle_t* handle) {
+  if (handle == (uv_handle_t*)&close_client) {
+    ASSERT(close_write_cb_called == 2);
+    uv_close((uv_handle_t*)&server, close_close_cb);
+    uv_close((uv_handle_t*)&close_conn, close_close_cb);
+  }
+
+  close_close_cb_called++;
+}
+
+
+static void close_write_cb(uv_write_t* req, int status) {
+  uv_err_code code;
+
+  ASSERT(req == &close_write_reqs[close_write_cb_called]);
+  ASSERT(close_close_cb_called == 0);
+  ASSERT(status == -1);
+
+  code = uv_last_error(loop).code;
+  ASSERT(code == UV_ECANCELED || code == UV_EINTR);
+
+  close_write_cb_called++;
+}
+
+
+/* Called by both ends once they're connected, the second call writes. */
+static void close_start(void) {
+  uv_buf_t buf;
+  int i;
+
+  if (++close_connected < 2)
+    return;
+
+  buf = uv_buf_init(close_data, CLOSE_WRITE_SIZE);
+
+  for (i = 0; i < 2; i++) {
+    ASSERT(0 == uv_write(&close_write_reqs[i],
+                         (uv_stream_t*)&close_client,
+                         &buf,
+                         1,
+                         close_write_cb));
+  }
+
+  uv_close((uv_handle_t*)&close_client, close_close_cb);
+}
+
+
+static void close_connection_cb(uv_stream_t* stream, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(loop, &close_conn));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)&close_conn));
+  close_start();
+}
+
+
+static void close_connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  close_start();
+}
+
+
+TEST_IMPL(loop_io_uring_close) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+
+  close_data = calloc(1, CLOSE_WRITE_SIZE);
+  ASSERT(close_data != NULL);
+
+  loop = uv_loop_new2(UV_LOOP_IO_URING_NET);
+  ASSERT(loop != NULL);
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, close_connection_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &close_client));
+  ASSERT(0 == uv_tcp_connect(&close_connect_req,
+                             &close_client,
+                             addr,
+                             close_connect_cb));
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(close_write_cb_called == 2);
+  ASSERT(close_close_cb_called == 3);
+  ASSERT(uv_loop_refcount(loop) == 0);
+
+  uv_loop_delete(loop);
+  free(close_data);
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifndef _WIN32
+
+#define NUM_TICKS 5
+#define BUSY_TIME (5 * 1000 * 1000) /* 5 ms in ns */
+
+static uv_timer_t timer;
+static int timer_cb_called;
+
+
+static void timer_cb(uv_timer_t* handle, int status) {
+  uint64_t start;
+
+  ASSERT(status == 0);
+
+  /* One slow callback. */
+  if (++timer_cb_called == 2) {
+    start = uv_hrtime();
+    while (uv_hrtime() - start < BUSY_TIME);
+  }
+
+  if (timer_cb_called == NUM_TICKS)
+    uv_close((uv_handle_t*)handle, NULL);
+}
+
+
+TEST_IMPL(loop_metrics) {
+  uv_loop_metrics_t before;
+  uv_loop_metrics_t after;
+  uint64_t buckets;
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_default_loop();
+  uv_loop_metrics(loop, &before);
+
+  ASSERT(0 == uv_timer_init(loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer, timer_cb, 10, 10));
+
+  ASSERT(0 == uv_run(loop));
+  ASSERT(timer_cb_called == NUM_TICKS);
+
+  uv_loop_metrics(loop, &after);
+
+  ASSERT(after.iterations >= before.iterations + NUM_TICKS);
+  ASSERT(after.events >= before.events + NUM_TICKS);
+  ASSERT(after.max_events >= 1);
+
+  /* Most of the time is spent waiting for the timer. */
+  ASSERT(after.poll_time - before.poll_time >= 30 * 1000 * 1000);
+  ASSERT(after.run_time - before.run_time >= BUSY_TIME);
+  ASSERT(after.max_callback_time >= BUSY_TIME);
+
+  /* The slow iteration is in the 4-8 ms bucket or above. */
+  buckets = 0;
+  for (i = 13; i < UV_LOOP_LAG_BUCKETS; i++)
+    buckets += after.lag_hist[i] - before.lag_hist[i];
+  ASSERT(buckets >= 1);
+
+  buckets = 0;
+  for (i = 0; i < UV_LOOP_LAG_BUCKETS; i++)
+    buckets += after.lag_hist[i];
+  ASSERT(buckets <= after.iterations);
+
+  return 0;
+}
+
+
+
+static void idle_cb(uv_idle_t* handle, int status) {
+  uv_close((uv_handle_t*)handle, NULL);
+}
+
+
+/* The time between two runs of the loop is neither run time nor lag. */
+TEST_IMPL(loop_metrics_between_runs) {
+  uv_loop_metrics_t before;
+  uv_loop_metrics_t after;
+  uv_idle_t idle;
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_loop_new();
+  ASSERT(loop != NULL);
+
+  ASSERT(0 == uv_idle_init(loop, &idle));
+  ASSERT(0 == uv_idle_start(&idle, idle_cb));
+  ASSERT(0 == uv_run(loop));
+
+  uv_loop_metrics(loop, &before);
+  uv_sleep(200);
+  ASSERT(0 == uv_run(loop));
+  uv_loop_metrics(loop, &after);
+
+  ASSERT(after.run_time - before.run_time < 100 * 1000 * 1000);
+
+  /* Nothing in the 64 ms and up buckets. */
+  for (i = 17; i < UV_LOOP_LAG_BUCKETS; i++)
+    ASSERT(after.lag_hist[i] == before.lag_hist[i]);
+
+  uv_loop_delete(loop);
+
+  return 0;
+}
+
+#else
+
+TEST_IMPL(loop_metrics) {
+  /* Windows doesn't collect metrics yet. */
+  return 0;
+}
+
+
+TEST_IMPL(loop_metrics_between_runs) {
+  return 0;
+}
+
+#endif
@@ -0,0 +1,245 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+/* A client streams data to a server on the same loop that reads into the
+ * loop's read pool. The server holds on to the buffers it gets and only
+ * releases them from a timer, so the pool runs dry in between.
+ */
+
+#define POOL_NBUFS 4
+#define POOL_SIZE 4096
+#define WRITE_SIZE (256 * 1024)
+#define MAX_HELD 1024
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_tcp_t conn;
+static uv_tcp_t client;
+static uv_timer_t timer;
+static uv_connect_t connect_req;
+static uv_write_t write_req;
+static uv_shutdown_t shutdown_req;
+static char data[WRITE_SIZE];
+
+static uv_buf_t held[MAX_HELD];
+static int nheld;
+static int max_held;
+static size_t nread_total;
+static int releases;
+static int check_busy;
+static int eof_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void release_all(void) {
+  int i;
+
+  for (i = 0; i < nheld; i++)
+    uv_read_release(loop, held[i]);
+
+  nheld = 0;
+}
+
+
+static void timer_cb(uv_timer_t* handle, int status) {
+  ASSERT(status == 0);
+
+  if (nheld > 0) {
+    releases++;
+
+    if (check_busy) {
+      ASSERT(-1 == uv_loop_set_read_pool(loop, POOL_NBUFS, POOL_SIZE));
+      ASSERT(uv_last_error(loop).code == UV_EBUSY);
+    }
+  }
+
+  release_all();
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  ssize_t i;
+
+  if (nread == -1) {
+    ASSERT(uv_last_error(loop).code == UV_EOF);
+    ASSERT(buf.base == NULL);
+    eof_cb_called++;
+    release_all();
+    uv_close((uv_handle_t*)stream, close_cb);
+    uv_close((uv_handle_t*)&server, close_cb);
+    uv_close((uv_handle_t*)&timer, close_cb);
+    return;
+  }
+
+  if (nread == 0) {
+    ASSERT(buf.base == NULL);
+    return;
+  }
+
+  ASSERT((size_t) nread <= buf.len);
+
+  for (i = 0; i < nread; i++)
+    ASSERT((unsigned char)buf.base[i] == ((nread_total + i) & 255));
+
+  nread_total += nread;
+
+  ASSERT(nheld < MAX_HELD);
+  held[nheld++] = buf;
+
+  if (nheld > max_held)
+    max_held = nheld;
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(loop, &conn));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)&conn));
+  ASSERT(0 == uv_read_start_pool((uv_stream_t*)&conn, read_cb));
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+  uv_close((uv_handle_t*)req->handle, close_cb);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t buf;
+
+  ASSERT(status == 0);
+
+  buf = uv_buf_init(data, sizeof data);
+  ASSERT(0 == uv_write(&write_req, req->handle, &buf, 1, write_cb));
+  ASSERT(0 == uv_shutdown(&shutdown_req, req->handle, shutdown_cb));
+}
+
+
+static void read_pool(unsigned int flags) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  int i;
+
+  for (i = 0; i < WRITE_SIZE; i++)
+    data[i] = i & 255;
+
+  loop = uv_loop_new2(flags);
+  ASSERT(loop != NULL);
+
+  ASSERT(-1 == uv_loop_set_read_pool(loop, 0, POOL_SIZE));
+  ASSERT(uv_last_error(loop).code == UV_EINVAL);
+  ASSERT(0 == uv_loop_set_read_pool(loop, POOL_NBUFS, POOL_SIZE));
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, connection_cb));
+
+  ASSERT(0 == uv_timer_init(loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer, timer_cb, 1, 1));
+
+  ASSERT(0 == uv_tcp_init(loop, &client));
+  ASSERT(0 == uv_tcp_connect(&connect_req, &client, addr, connect_cb));
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(nread_total == WRITE_SIZE);
+  ASSERT(eof_cb_called == 1);
+  ASSERT(close_cb_called == 4);
+  ASSERT(uv_loop_refcount(loop) == 0);
+
+  uv_loop_delete(loop);
+}
+
+
+TEST_IMPL(read_pool) {
+  check_busy = 1;
+  read_pool(0);
+
+  /* The pool ran dry, but never more buffers were out than it has. */
+  ASSERT(releases > 0);
+  ASSERT(max_held <= POOL_NBUFS);
+
+  return 0;
+}
+
+
+/* Where io_uring isn't available the flag is ignored and the buffers come
+ * from the pool like above.
+ */
+TEST_IMPL(read_pool_io_uring) {
+  read_pool(UV_LOOP_IO_URING_NET);
+  return 0;
+}
+
+
+static void no_alloc_read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  ASSERT(0 && "no_alloc_read_cb should not be called");
+}
+
+
+static void no_alloc_read2_cb(uv_pipe_t* pipe,
+                              ssize_t nread,
+                              uv_buf_t buf,
+                              uv_handle_type pending) {
+  ASSERT(0 && "no_alloc_read2_cb should not be called");
+}
+
+
+/* Only uv_read_start_pool() reads without an alloc callback. */
+TEST_IMPL(read_pool_no_alloc_cb) {
+  uv_loop_t* loop;
+  uv_tcp_t tcp;
+  uv_pipe_t pipe;
+
+  loop = uv_loop_new();
+  ASSERT(loop != NULL);
+
+  ASSERT(0 == uv_tcp_init(loop, &tcp));
+  ASSERT(-1 == uv_read_start((uv_stream_t*)&tcp, NULL, no_alloc_read_cb));
+  ASSERT(uv_last_error(loop).code == UV_EINVAL);
+
+  ASSERT(0 == uv_pipe_init(loop, &pipe, 1));
+  ASSERT(-1 == uv_read2_start((uv_stream_t*)&pipe, NULL, no_alloc_read2_cb));
+  ASSERT(uv_last_error(loop).code == UV_EINVAL);
+
+  uv_close((uv_handle_t*)&tcp, NULL);
+  uv_close((uv_handle_t*)&pipe, NULL);
+  ASSERT(0 == uv_run(loop));
+
+  uv_loop_delete(loop);
+
+  return 0;
+}
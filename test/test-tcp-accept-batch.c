@@ -0,0 +1,129 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+/* Connections that are pending at the same time are accepted one per loop
+ * iteration when the accept batch is 1.
+ */
+
+#define NUM_CLIENTS 3
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_tcp_t conns[NUM_CLIENTS];
+static uv_tcp_t clients[NUM_CLIENTS];
+static uv_connect_t connect_reqs[NUM_CLIENTS];
+static uv_prepare_t prepare;
+
+static int iteration;
+static int accept_iterations[NUM_CLIENTS];
+static int connection_cb_called;
+static int connect_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void prepare_cb(uv_prepare_t* handle, int status) {
+  iteration++;
+}
+
+
+static void close_all(void) {
+  int i;
+
+  for (i = 0; i < NUM_CLIENTS; i++) {
+    uv_close((uv_handle_t*)&conns[i], close_cb);
+    uv_close((uv_handle_t*)&clients[i], close_cb);
+  }
+
+  uv_close((uv_handle_t*)&server, close_cb);
+  uv_close((uv_handle_t*)&prepare, close_cb);
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  uv_tcp_t* conn;
+
+  ASSERT(status == 0);
+  ASSERT(connection_cb_called < NUM_CLIENTS);
+
+  conn = &conns[connection_cb_called];
+  ASSERT(0 == uv_tcp_init(loop, conn));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)conn));
+
+  accept_iterations[connection_cb_called++] = iteration;
+
+  if (connection_cb_called == NUM_CLIENTS && connect_cb_called == NUM_CLIENTS)
+    close_all();
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  connect_cb_called++;
+
+  if (connection_cb_called == NUM_CLIENTS && connect_cb_called == NUM_CLIENTS)
+    close_all();
+}
+
+
+TEST_IMPL(tcp_accept_batch) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  int i;
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == uv_prepare_init(loop, &prepare));
+  ASSERT(0 == uv_prepare_start(&prepare, prepare_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_stream_set_accept_batch((uv_stream_t*)&server, 1));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, connection_cb));
+
+  for (i = 0; i < NUM_CLIENTS; i++) {
+    ASSERT(0 == uv_tcp_init(loop, &clients[i]));
+    ASSERT(0 == uv_tcp_connect(&connect_reqs[i], &clients[i], addr,
+                               connect_cb));
+  }
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(connection_cb_called == NUM_CLIENTS);
+  ASSERT(connect_cb_called == NUM_CLIENTS);
+  ASSERT(close_cb_called == 2 * NUM_CLIENTS + 2);
+
+#ifndef _WIN32
+  /* Windows doesn't limit or count its accepts. */
+  ASSERT(loop->counters.accept == NUM_CLIENTS);
+
+  for (i = 1; i < NUM_CLIENTS; i++)
+    ASSERT(accept_iterations[i] > accept_iterations[i - 1]);
+#endif
+
+  return 0;
+}
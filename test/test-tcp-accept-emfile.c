@@ -0,0 +1,153 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+/* The process runs out of descriptors while a connection is pending. The
+ * listener gives up its reserve descriptor to accept the connection and
+ * close it, the client sees it go away and connection_cb gets EMFILE.
+ */
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_tcp_t client;
+static uv_connect_t connect_req;
+
+static int* fillers;
+static int nfillers;
+
+static int connection_cb_called;
+static int connect_cb_called;
+static int read_cb_called;
+static int close_cb_called;
+
+
+static void release_fillers(void) {
+  while (nfillers > 0)
+    close(fillers[--nfillers]);
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  static char slab[64];
+  return uv_buf_init(slab, sizeof slab);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  uv_err_code code;
+
+  if (nread == 0)
+    return;
+
+  ASSERT(nread == -1);
+  code = uv_last_error(loop).code;
+  ASSERT(code == UV_EOF || code == UV_ECONNRESET);
+  read_cb_called++;
+
+  uv_close((uv_handle_t*)&client, close_cb);
+  uv_close((uv_handle_t*)&server, close_cb);
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  ASSERT(stream == (uv_stream_t*)&server);
+  ASSERT(status == -1);
+  ASSERT(uv_last_error(loop).code == UV_EMFILE);
+  connection_cb_called++;
+
+  release_fillers();
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  connect_cb_called++;
+
+  ASSERT(0 == uv_read_start((uv_stream_t*)&client, alloc_cb, read_cb));
+}
+
+
+TEST_IMPL(tcp_accept_emfile) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  struct rlimit limits;
+  int fd;
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &client));
+  ASSERT(0 == uv_tcp_connect(&connect_req, &client, addr, connect_cb));
+
+  /* Use up the remaining descriptors. */
+  ASSERT(0 == getrlimit(RLIMIT_NOFILE, &limits));
+  fillers = malloc(limits.rlim_cur * sizeof(fillers[0]));
+  ASSERT(fillers != NULL);
+
+  for (;;) {
+    fd = open("/dev/null", O_RDONLY);
+    if (fd == -1)
+      break;
+    fillers[nfillers++] = fd;
+  }
+
+  ASSERT(errno == EMFILE);
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(connection_cb_called == 1);
+  ASSERT(connect_cb_called == 1);
+  ASSERT(read_cb_called == 1);
+  ASSERT(close_cb_called == 2);
+  ASSERT(loop->counters.accept == 0);
+  ASSERT(loop->counters.accept_error == 1);
+  ASSERT(loop->counters.accept_dropped == 1);
+
+  free(fillers);
+
+  return 0;
+}
+
+#else
+
+TEST_IMPL(tcp_accept_emfile) {
+  /* There's no reserve descriptor on Windows. */
+  return 0;
+}
+
+#endif
@@ -0,0 +1,125 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifndef _WIN32
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/* The listener has TCP_NODELAY and SO_KEEPALIVE turned on, the accepted
+ * connection must end up with both whether they are inherited or set.
+ */
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_tcp_t conn;
+static uv_tcp_t client;
+static uv_connect_t connect_req;
+
+static int connection_cb_called;
+static int connect_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static int get_option(int fd, int level, int name) {
+  socklen_t len;
+  int val;
+
+  len = sizeof val;
+  ASSERT(0 == getsockopt(fd, level, name, &val, &len));
+
+  return val;
+}
+
+
+static void maybe_close(void) {
+  if (connection_cb_called == 0 || connect_cb_called == 0)
+    return;
+
+  uv_close((uv_handle_t*)&server, close_cb);
+  uv_close((uv_handle_t*)&conn, close_cb);
+  uv_close((uv_handle_t*)&client, close_cb);
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  ASSERT(status == 0);
+  connection_cb_called++;
+
+  ASSERT(0 == uv_tcp_init(loop, &conn));
+  ASSERT(0 == uv_tcp_nodelay(&conn, 1));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)&conn));
+
+  ASSERT(get_option(conn.fd, IPPROTO_TCP, TCP_NODELAY) != 0);
+  ASSERT(get_option(conn.fd, SOL_SOCKET, SO_KEEPALIVE) != 0);
+
+  maybe_close();
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  connect_cb_called++;
+
+  maybe_close();
+}
+
+
+TEST_IMPL(tcp_accept_options) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_tcp_nodelay(&server, 1));
+  ASSERT(0 == uv_tcp_keepalive(&server, 1, 60));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &client));
+  ASSERT(0 == uv_tcp_connect(&connect_req, &client, addr, connect_cb));
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(connection_cb_called == 1);
+  ASSERT(connect_cb_called == 1);
+  ASSERT(close_cb_called == 3);
+
+  return 0;
+}
+
+#else
+
+TEST_IMPL(tcp_accept_options) {
+  /* Checks the unix sockets directly. */
+  return 0;
+}
+
+#endif
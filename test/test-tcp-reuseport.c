@@ -0,0 +1,213 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+
+#ifndef _WIN32
+
+#define NUM_SHARDS  4
+#define NUM_CLIENTS 32
+
+static uv_loop_t* loop;
+static uv_tcp_shard_t shards[NUM_SHARDS];
+static int shard_accepts[NUM_SHARDS];
+static uv_tcp_t clients[NUM_CLIENTS];
+static uv_connect_t connect_reqs[NUM_CLIENTS];
+
+static int connect_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void free_close_cb(uv_handle_t* handle) {
+  free(handle);
+}
+
+
+TEST_IMPL(tcp_reuseport) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  uv_tcp_t server1;
+  uv_tcp_t server2;
+  uv_tcp_t server3;
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == uv_tcp_init(loop, &server1));
+  ASSERT(0 == uv_tcp_reuseport(&server1, 1));
+  ASSERT(0 == uv_tcp_bind(&server1, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server1, 128, NULL));
+
+  ASSERT(0 == uv_tcp_init(loop, &server2));
+  ASSERT(0 == uv_tcp_reuseport(&server2, 1));
+  ASSERT(0 == uv_tcp_bind(&server2, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server2, 128, NULL));
+
+  /* Without the option the port is taken. */
+  ASSERT(0 == uv_tcp_init(loop, &server3));
+  ASSERT(0 == uv_tcp_bind(&server3, addr));
+  ASSERT(-1 == uv_listen((uv_stream_t*)&server3, 128, NULL));
+  ASSERT(uv_last_error(loop).code == UV_EADDRINUSE);
+
+  uv_close((uv_handle_t*)&server1, close_cb);
+  uv_close((uv_handle_t*)&server2, close_cb);
+  uv_close((uv_handle_t*)&server3, close_cb);
+
+  ASSERT(0 == uv_run(loop));
+  ASSERT(close_cb_called == 3);
+
+  return 0;
+}
+
+
+TEST_IMPL(udp_reuseport) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  uv_udp_t handle1;
+  uv_udp_t handle2;
+  uv_udp_t handle3;
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == uv_udp_init(loop, &handle1));
+  ASSERT(0 == uv_udp_bind(&handle1, addr, UV_UDP_REUSEPORT));
+
+  ASSERT(0 == uv_udp_init(loop, &handle2));
+  ASSERT(0 == uv_udp_bind(&handle2, addr, UV_UDP_REUSEPORT));
+
+  ASSERT(0 == uv_udp_init(loop, &handle3));
+  ASSERT(-1 == uv_udp_bind(&handle3, addr, 0));
+  ASSERT(uv_last_error(loop).code == UV_EADDRINUSE);
+
+  uv_close((uv_handle_t*)&handle1, close_cb);
+  uv_close((uv_handle_t*)&handle2, close_cb);
+  uv_close((uv_handle_t*)&handle3, close_cb);
+
+  ASSERT(0 == uv_run(loop));
+  ASSERT(close_cb_called == 3);
+
+  return 0;
+}
+
+
+/* Runs on the shard's thread. */
+static void shard_connection_cb(uv_stream_t* stream, int status) {
+  uv_tcp_shard_t* shard;
+  uv_tcp_t* conn;
+
+  ASSERT(status == 0);
+
+  shard = stream->data;
+  ASSERT(shard->loop == stream->loop);
+
+  conn = malloc(sizeof *conn);
+  ASSERT(conn != NULL);
+  ASSERT(0 == uv_tcp_init(shard->loop, conn));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)conn));
+
+  (*(int*)shard->data)++;
+
+  uv_close((uv_handle_t*)conn, free_close_cb);
+}
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  static char slab[64];
+  return uv_buf_init(slab, sizeof slab);
+}
+
+
+/* The server closes the connection right after accepting it. */
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  ASSERT(nread == -1);
+  uv_close((uv_handle_t*)stream, close_cb);
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  connect_cb_called++;
+  ASSERT(0 == uv_read_start(req->handle, alloc_cb, read_cb));
+}
+
+
+TEST_IMPL(tcp_shards) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  uv_err_t err;
+  int total;
+  int i;
+
+  loop = uv_default_loop();
+
+  for (i = 0; i < NUM_SHARDS; i++)
+    shards[i].data = &shard_accepts[i];
+
+  err = uv_tcp_shards_start(shards, NUM_SHARDS, addr, 128,
+                            shard_connection_cb);
+  ASSERT(err.code == UV_OK);
+
+  for (i = 0; i < NUM_CLIENTS; i++) {
+    ASSERT(0 == uv_tcp_init(loop, &clients[i]));
+    ASSERT(0 == uv_tcp_connect(&connect_reqs[i], &clients[i], addr,
+                               connect_cb));
+  }
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(connect_cb_called == NUM_CLIENTS);
+  ASSERT(close_cb_called == NUM_CLIENTS);
+
+  uv_tcp_shards_stop(shards, NUM_SHARDS);
+
+  total = 0;
+  for (i = 0; i < NUM_SHARDS; i++) {
+    ASSERT(shards[i].loop == NULL);
+    total += shard_accepts[i];
+  }
+
+  ASSERT(total == NUM_CLIENTS);
+
+  return 0;
+}
+
+#else
+
+TEST_IMPL(tcp_reuseport) {
+  /* Windows has no SO_REUSEPORT. */
+  return 0;
+}
+
+
+TEST_IMPL(udp_reuseport) {
+  return 0;
+}
+
+
+TEST_IMPL(tcp_shards) {
+  return 0;
+}
+
+#endif
@@ -0,0 +1,328 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Two clients connect to a server on the same loop. The server splices
+ * the first connection into the second, the first client writes and the
+ * second one checks that everything arrives in order.
+ */
+
+#define WRITE_SIZE (1024 * 1024)
+
+/* Enough to fill the socket buffers of a sink that doesn't read. */
+#define STALL_SIZE (32 * 1024 * 1024)
+
+/* Never part of the data, which is made of values below 251. */
+#define MARKER_CHAR ((char)0xff)
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_tcp_t conns[2];
+static uv_tcp_t sender;
+static uv_tcp_t sink;
+static uv_connect_t sender_connect_req;
+static uv_connect_t sink_connect_req;
+static uv_write_t write_req;
+static uv_shutdown_t sender_shutdown_req;
+static uv_shutdown_t conn_shutdown_req;
+static uv_splice_t splice_req;
+static uv_timer_t write_timer;
+static uv_write_t marker_req;
+static char marker[16];
+static char* data;
+static size_t data_size;
+
+static int nconns;
+static int close_on_splice;
+static int write_on_splice;
+static size_t nread_total;
+static size_t nmarker;
+static size_t marker_min_pos;
+static size_t marker_pos;
+static int splice_cb_called;
+static int eof_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void close_all(void) {
+  uv_close((uv_handle_t*)&server, close_cb);
+  uv_close((uv_handle_t*)&conns[0], close_cb);
+  uv_close((uv_handle_t*)&conns[1], close_cb);
+  uv_close((uv_handle_t*)&sender, close_cb);
+  uv_close((uv_handle_t*)&sink, close_cb);
+}
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  return uv_buf_init(malloc(suggested_size), suggested_size);
+}
+
+
+static void sink_read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  ssize_t i;
+
+  if (nread < 0) {
+    ASSERT(uv_last_error(loop).code == UV_EOF);
+    ASSERT(nread_total == data_size);
+    ASSERT(nmarker == (write_on_splice ? sizeof marker : 0));
+    eof_cb_called++;
+    free(buf.base);
+    close_all();
+    return;
+  }
+
+  for (i = 0; i < nread; i++) {
+    if (buf.base[i] == MARKER_CHAR) {
+      /* The marker comes in one piece. */
+      if (nmarker == 0)
+        marker_pos = nread_total;
+      ASSERT(marker_pos == nread_total);
+      nmarker++;
+    } else {
+      ASSERT(buf.base[i] == data[nread_total]);
+      nread_total++;
+    }
+  }
+
+  free(buf.base);
+}
+
+
+static void conn_shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void splice_cb(uv_splice_t* req, int status) {
+  ASSERT(req == &splice_req);
+  ASSERT(req->src == (uv_stream_t*)&conns[0]);
+  ASSERT(req->dst == (uv_stream_t*)&conns[1]);
+  splice_cb_called++;
+
+  if (close_on_splice) {
+    ASSERT(status == -1);
+    ASSERT(uv_last_error(loop).code == UV_ECANCELED);
+    return;
+  }
+
+  ASSERT(status == 0);
+  ASSERT(req->nbytes == data_size);
+
+  /* The splice leaves dst open, pass the EOF on. */
+  ASSERT(0 == uv_shutdown(&conn_shutdown_req, req->dst, conn_shutdown_cb));
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  uv_tcp_t* conn;
+  int r;
+
+  ASSERT(status == 0);
+  ASSERT(nconns < 2);
+
+  conn = &conns[nconns++];
+  r = uv_tcp_init(loop, conn);
+  ASSERT(r == 0);
+  r = uv_accept(stream, (uv_stream_t*)conn);
+  ASSERT(r == 0);
+
+  if (nconns < 2)
+    return;
+
+  r = uv_stream_splice(&splice_req,
+                       (uv_stream_t*)&conns[0],
+                       (uv_stream_t*)&conns[1],
+                       splice_cb);
+  ASSERT(r == 0);
+
+  /* One splice per direction. */
+  r = uv_stream_splice(&splice_req,
+                       (uv_stream_t*)&conns[0],
+                       (uv_stream_t*)&conns[1],
+                       splice_cb);
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(loop).code == UV_EBUSY);
+
+  /* The splice does the reading. */
+  r = uv_read_start((uv_stream_t*)&conns[0], alloc_cb, sink_read_cb);
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(loop).code == UV_EBUSY);
+
+  if (close_on_splice)
+    close_all();
+}
+
+
+static void sender_shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_shutdown(&sender_shutdown_req,
+                          (uv_stream_t*)&sender,
+                          sender_shutdown_cb));
+}
+
+
+static void marker_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+/* The sink didn't read so far, so the splice is stuck with bytes that it
+ * took from the sender. The marker has to go out after those.
+ */
+static void write_timer_cb(uv_timer_t* handle, int status) {
+  uv_buf_t buf;
+
+  ASSERT(splice_req.nbytes < data_size);
+  marker_min_pos = splice_req.nbytes + 1;
+
+  buf = uv_buf_init(marker, sizeof marker);
+  ASSERT(-1 == uv_try_write((uv_stream_t*)&conns[1], &buf, 1));
+  ASSERT(uv_last_error(loop).code == UV_EAGAIN);
+  ASSERT(0 == uv_write(&marker_req,
+                       (uv_stream_t*)&conns[1],
+                       &buf,
+                       1,
+                       marker_write_cb));
+
+  ASSERT(0 == uv_read_start((uv_stream_t*)&sink, alloc_cb, sink_read_cb));
+  uv_close((uv_handle_t*)handle, close_cb);
+}
+
+
+static void sink_connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t buf;
+
+  ASSERT(status == 0);
+
+  if (write_on_splice) {
+    ASSERT(0 == uv_timer_init(loop, &write_timer));
+    ASSERT(0 == uv_timer_start(&write_timer, write_timer_cb, 100, 0));
+  } else {
+    ASSERT(0 == uv_read_start((uv_stream_t*)&sink, alloc_cb, sink_read_cb));
+  }
+
+  if (close_on_splice)
+    return;
+
+  buf = uv_buf_init(data, data_size);
+  ASSERT(0 == uv_write(&write_req, (uv_stream_t*)&sender, &buf, 1, write_cb));
+}
+
+
+static void sender_connect_cb(uv_connect_t* req, int status) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+
+  ASSERT(status == 0);
+
+  /* Connect the sink once the sender is in the accept queue, so that it's
+   * accepted second.
+   */
+  ASSERT(0 == uv_tcp_init(loop, &sink));
+  ASSERT(0 == uv_tcp_connect(&sink_connect_req, &sink, addr, sink_connect_cb));
+}
+
+
+static void run_splice_test(void) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  size_t i;
+
+  loop = uv_default_loop();
+
+  data_size = write_on_splice ? STALL_SIZE : WRITE_SIZE;
+  data = malloc(data_size);
+  ASSERT(data != NULL);
+  for (i = 0; i < data_size; i++)
+    data[i] = (char)(i % 251);
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &sender));
+  ASSERT(0 == uv_tcp_connect(&sender_connect_req,
+                             &sender,
+                             addr,
+                             sender_connect_cb));
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(splice_cb_called == 1);
+  ASSERT(close_cb_called == 5 + write_on_splice);
+
+  free(data);
+}
+
+
+TEST_IMPL(tcp_splice) {
+  uv_counters_t before;
+
+  before = uv_default_loop()->counters;
+  run_splice_test();
+
+  ASSERT(eof_cb_called == 1);
+  ASSERT(nread_total == data_size);
+
+  /* Everything is read and written twice, once by the splice. */
+  ASSERT(loop->counters.read_bytes == before.read_bytes + 2 * data_size);
+  ASSERT(loop->counters.write_bytes == before.write_bytes + 2 * data_size);
+
+  return 0;
+}
+
+
+TEST_IMPL(tcp_splice_close) {
+  close_on_splice = 1;
+  run_splice_test();
+
+  ASSERT(eof_cb_called == 0);
+  ASSERT(nread_total == 0);
+
+  return 0;
+}
+
+
+TEST_IMPL(tcp_splice_write) {
+  memset(marker, MARKER_CHAR, sizeof marker);
+  write_on_splice = 1;
+  run_splice_test();
+
+  ASSERT(eof_cb_called == 1);
+  ASSERT(nread_total == data_size);
+  ASSERT(nmarker == sizeof marker);
+  ASSERT(marker_pos >= marker_min_pos);
+
+  return 0;
+}
@@ -0,0 +1,173 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* The client writes with uv_try_write() until the socket is full, queues
+ * one more chunk with uv_write() and checks that uv_try_write() won't jump
+ * the queue. The server starts reading after that and checks that it got
+ * every byte.
+ */
+
+#define CHUNK_SIZE (64 * 1024)
+#define MAX_TRIES 4096
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_tcp_t conn;
+static uv_tcp_t client;
+static uv_connect_t connect_req;
+static uv_write_t write_req;
+static uv_shutdown_t shutdown_req;
+static char chunk[CHUNK_SIZE];
+
+static size_t nwritten;
+static size_t nread_total;
+static int accepted;
+static int connected;
+static int write_cb_called;
+static int eof_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  return uv_buf_init(malloc(suggested_size), suggested_size);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  if (nread < 0) {
+    free(buf.base);
+    ASSERT(uv_last_error(loop).code == UV_EOF);
+    eof_cb_called++;
+    uv_close((uv_handle_t*)&server, close_cb);
+    uv_close((uv_handle_t*)&conn, close_cb);
+    uv_close((uv_handle_t*)&client, close_cb);
+    return;
+  }
+
+  if (nread_total == 0 && nread >= 4)
+    ASSERT(memcmp(buf.base, "PING", 4) == 0);
+
+  nread_total += nread;
+  free(buf.base);
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  write_cb_called++;
+  ASSERT(0 == uv_shutdown(&shutdown_req, (uv_stream_t*)&client, shutdown_cb));
+}
+
+
+static void start_test(void) {
+  uv_buf_t buf;
+  int tries;
+  int r;
+
+  buf = uv_buf_init("PING", 4);
+  r = uv_try_write((uv_stream_t*)&client, &buf, 1);
+  ASSERT(r == 4);
+  nwritten += r;
+
+  /* Fill the socket. */
+  for (tries = 0; tries < MAX_TRIES; tries++) {
+    buf = uv_buf_init(chunk, sizeof(chunk));
+    r = uv_try_write((uv_stream_t*)&client, &buf, 1);
+    if (r == -1)
+      break;
+    ASSERT(r > 0);
+    nwritten += r;
+  }
+
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(loop).code == UV_EAGAIN);
+
+  buf = uv_buf_init(chunk, sizeof(chunk));
+  ASSERT(0 == uv_write(&write_req, (uv_stream_t*)&client, &buf, 1, write_cb));
+  ASSERT(client.write_queue_size > 0);
+  nwritten += sizeof(chunk);
+
+  /* The queued chunk goes first. */
+  buf = uv_buf_init("PONG", 4);
+  ASSERT(-1 == uv_try_write((uv_stream_t*)&client, &buf, 1));
+  ASSERT(uv_last_error(loop).code == UV_EAGAIN);
+
+  ASSERT(0 == uv_read_start((uv_stream_t*)&conn, alloc_cb, read_cb));
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(loop, &conn));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)&conn));
+  accepted = 1;
+
+  if (connected)
+    start_test();
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  connected = 1;
+
+  if (accepted)
+    start_test();
+}
+
+
+TEST_IMPL(tcp_try_write) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &client));
+  ASSERT(0 == uv_tcp_connect(&connect_req, &client, addr, connect_cb));
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(write_cb_called == 1);
+  ASSERT(eof_cb_called == 1);
+  ASSERT(close_cb_called == 3);
+  ASSERT(nread_total == nwritten);
+
+  return 0;
+}
@@ -0,0 +1,187 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+
+/* A client writes to a server on the same loop that doesn't read until
+ * the client's write queue goes above the high watermark. The client
+ * stops writing then and shuts down once the queue has drained to the low
+ * watermark.
+ */
+
+#define CHUNK_SIZE (64 * 1024)
+#define MAX_WRITES 1024
+#define LOW_WATERMARK (64 * 1024)
+#define HIGH_WATERMARK (256 * 1024)
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_tcp_t conn;
+static uv_tcp_t client;
+static uv_connect_t connect_req;
+static uv_shutdown_t shutdown_req;
+static char chunk[CHUNK_SIZE];
+
+static size_t nwritten;
+static size_t nread_total;
+static int writes;
+static int accepted;
+static int write_cb_called;
+static int above_cb_called;
+static int below_cb_called;
+static int eof_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  return uv_buf_init(malloc(suggested_size), suggested_size);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  free(buf.base);
+
+  if (nread < 0) {
+    ASSERT(uv_last_error(loop).code == UV_EOF);
+    eof_cb_called++;
+    uv_close((uv_handle_t*)&server, close_cb);
+    uv_close((uv_handle_t*)&conn, close_cb);
+    uv_close((uv_handle_t*)&client, close_cb);
+    return;
+  }
+
+  nread_total += nread;
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(loop, &conn));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)&conn));
+  accepted = 1;
+
+  if (above_cb_called)
+    ASSERT(0 == uv_read_start((uv_stream_t*)&conn, alloc_cb, read_cb));
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  free(req);
+  write_cb_called++;
+}
+
+
+static void watermark_cb(uv_stream_t* stream, int above) {
+  ASSERT(stream == (uv_stream_t*)&client);
+
+  if (above) {
+    ASSERT(above_cb_called == 0);
+    ASSERT(stream->write_queue_size > HIGH_WATERMARK);
+    above_cb_called++;
+
+    /* Let the data flow, or have connection_cb do it if the connection
+     * hasn't been accepted yet.
+     */
+    if (accepted)
+      ASSERT(0 == uv_read_start((uv_stream_t*)&conn, alloc_cb, read_cb));
+    return;
+  }
+
+  ASSERT(above_cb_called == 1);
+  ASSERT(below_cb_called == 0);
+  ASSERT(stream->write_queue_size <= LOW_WATERMARK);
+  below_cb_called++;
+
+  ASSERT(0 == uv_shutdown(&shutdown_req, stream, shutdown_cb));
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  uv_write_t* write_req;
+  uv_buf_t buf;
+
+  ASSERT(status == 0);
+
+  /* Write until the queue backs up. */
+  while (above_cb_called == 0) {
+    ASSERT(writes < MAX_WRITES);
+
+    write_req = malloc(sizeof(*write_req));
+    ASSERT(write_req != NULL);
+
+    buf = uv_buf_init(chunk, sizeof(chunk));
+    ASSERT(0 == uv_write(write_req, (uv_stream_t*)&client, &buf, 1, write_cb));
+
+    nwritten += sizeof(chunk);
+    writes++;
+  }
+}
+
+
+TEST_IMPL(tcp_watermarks) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &client));
+
+  ASSERT(-1 == uv_stream_set_watermarks((uv_stream_t*)&client,
+                                        HIGH_WATERMARK,
+                                        LOW_WATERMARK,
+                                        watermark_cb));
+  ASSERT(uv_last_error(loop).code == UV_EINVAL);
+
+  ASSERT(0 == uv_stream_set_watermarks((uv_stream_t*)&client,
+                                       LOW_WATERMARK,
+                                       HIGH_WATERMARK,
+                                       watermark_cb));
+
+  ASSERT(0 == uv_tcp_connect(&connect_req, &client, addr, connect_cb));
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(above_cb_called == 1);
+  ASSERT(below_cb_called == 1);
+  ASSERT(write_cb_called == writes);
+  ASSERT(eof_cb_called == 1);
+  ASSERT(close_cb_called == 3);
+  ASSERT(nread_total == nwritten);
+
+  return 0;
+}
@@ -0,0 +1,242 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+/* Queues a burst of small writes before the loop gets a chance to flush any
+ * of them. The writes must still hit the wire in order and complete in
+ * order, no matter how many of them are coalesced into a single writev().
+ */
+
+#define NUM_WRITES  2000
+
+
+static uv_tcp_t tcp_client;
+static uv_connect_t connect_req;
+static uv_shutdown_t shutdown_req;
+static uv_write_t write_reqs[NUM_WRITES];
+static unsigned int send_data[NUM_WRITES];
+static char recv_data[NUM_WRITES * sizeof(unsigned int)];
+
+static int connect_cb_called = 0;
+static int write_cb_called = 0;
+static int shutdown_cb_called = 0;
+static int close_cb_called = 0;
+static size_t bytes_received = 0;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t size) {
+  uv_buf_t buf;
+  buf.base = (char*)malloc(size);
+  buf.len = size;
+  return buf;
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  ASSERT(handle == (uv_handle_t*)&tcp_client);
+  close_cb_called++;
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(req == &shutdown_req);
+  ASSERT(status == 0);
+  ASSERT(tcp_client.write_queue_size == 0);
+  ASSERT(write_cb_called == NUM_WRITES);
+  shutdown_cb_called++;
+}
+
+
+static void read_cb(uv_stream_t* tcp, ssize_t nread, uv_buf_t buf) {
+  if (nread < 0) {
+    ASSERT(uv_last_error(uv_default_loop()).code == UV_EOF);
+    free(buf.base);
+    uv_close((uv_handle_t*)tcp, close_cb);
+    return;
+  }
+
+  ASSERT(bytes_received + nread <= sizeof recv_data);
+  memcpy(recv_data + bytes_received, buf.base, nread);
+  bytes_received += nread;
+
+  free(buf.base);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+
+  /* Callbacks must fire in the order the writes were issued. */
+  ASSERT(req == &write_reqs[write_cb_called]);
+  write_cb_called++;
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t buf;
+  int i, r;
+
+  ASSERT(req == &connect_req);
+  ASSERT(status == 0);
+  connect_cb_called++;
+
+  for (i = 0; i < NUM_WRITES; i++) {
+    send_data[i] = i;
+    buf = uv_buf_init((char*)&send_data[i], sizeof send_data[i]);
+    r = uv_write(&write_reqs[i], req->handle, &buf, 1, write_cb);
+    ASSERT(r == 0);
+  }
+
+  r = uv_shutdown(&shutdown_req, req->handle, shutdown_cb);
+  ASSERT(r == 0);
+
+  r = uv_read_start(req->handle, alloc_cb, read_cb);
+  ASSERT(r == 0);
+}
+
+
+TEST_IMPL(tcp_write_coalesce) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  int r;
+
+  r = uv_tcp_init(uv_default_loop(), &tcp_client);
+  ASSERT(r == 0);
+
+  r = uv_tcp_connect(&connect_req, &tcp_client, addr, connect_cb);
+  ASSERT(r == 0);
+
+  uv_run(uv_default_loop());
+
+  ASSERT(connect_cb_called == 1);
+  ASSERT(write_cb_called == NUM_WRITES);
+  ASSERT(shutdown_cb_called == 1);
+  ASSERT(close_cb_called == 1);
+  ASSERT(bytes_received == sizeof recv_data);
+  ASSERT(memcmp(recv_data, send_data, sizeof recv_data) == 0);
+
+  return 0;
+}
+
+
+/* Queues small writes behind a full socket. Once the peer has drained it,
+ * all of them must go out in one writev(): every write callback then runs
+ * with the queue already empty. Written one at a time, the queue would
+ * still hold the later writes when the first callbacks run.
+ */
+
+#ifndef _WIN32
+
+#define NUM_PIPE_WRITES 64
+
+static uv_pipe_t pipe_writer;
+static uv_write_t pipe_write_reqs[NUM_PIPE_WRITES];
+static unsigned int pipe_send_data[NUM_PIPE_WRITES];
+static int pipe_write_cb_called = 0;
+
+
+static void pipe_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(req == &pipe_write_reqs[pipe_write_cb_called]);
+  ASSERT(pipe_writer.write_queue_size == 0);
+
+  if (++pipe_write_cb_called == NUM_PIPE_WRITES)
+    uv_close((uv_handle_t*)&pipe_writer, NULL);
+}
+
+
+TEST_IMPL(pipe_write_coalesce) {
+  unsigned int recv_data[NUM_PIPE_WRITES];
+  char chunk[65536];
+  uv_buf_t buf;
+  size_t nread;
+  ssize_t n;
+  int fds[2];
+  int i, r;
+
+  r = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+  ASSERT(r == 0);
+  ASSERT(fcntl(fds[0], F_SETFL, O_NONBLOCK) == 0);
+  ASSERT(fcntl(fds[1], F_SETFL, O_NONBLOCK) == 0);
+
+  /* Fill the socket, even a single byte must not fit anymore. */
+  memset(chunk, 0, sizeof chunk);
+  while (write(fds[0], chunk, sizeof chunk) > 0);
+  ASSERT(errno == EAGAIN);
+  while (write(fds[0], chunk, 1) > 0);
+  ASSERT(errno == EAGAIN);
+
+  r = uv_pipe_init(uv_default_loop(), &pipe_writer, 0);
+  ASSERT(r == 0);
+  uv_pipe_open(&pipe_writer, fds[0]);
+
+  for (i = 0; i < NUM_PIPE_WRITES; i++) {
+    pipe_send_data[i] = i;
+    buf = uv_buf_init((char*)&pipe_send_data[i], sizeof pipe_send_data[i]);
+    r = uv_write(&pipe_write_reqs[i],
+                 (uv_stream_t*)&pipe_writer,
+                 &buf,
+                 1,
+                 pipe_write_cb);
+    ASSERT(r == 0);
+  }
+
+  ASSERT(pipe_writer.write_queue_size == sizeof pipe_send_data);
+
+  /* Make room for all of them at once. */
+  while (read(fds[1], chunk, sizeof chunk) > 0);
+  ASSERT(errno == EAGAIN);
+
+  uv_run(uv_default_loop());
+  ASSERT(pipe_write_cb_called == NUM_PIPE_WRITES);
+
+  nread = 0;
+  while (nread < sizeof recv_data) {
+    n = read(fds[1], (char*)recv_data + nread, sizeof recv_data - nread);
+    ASSERT(n > 0);
+    nread += n;
+  }
+  ASSERT(memcmp(recv_data, pipe_send_data, sizeof recv_data) == 0);
+
+  close(fds[1]);
+
+  return 0;
+}
+
+#else
+
+TEST_IMPL(pipe_write_coalesce) {
+  /* No socketpair() on Windows. */
+  return 0;
+}
+
+#endif
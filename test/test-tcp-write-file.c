@@ -0,0 +1,240 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* A client sends a header, a file and a trailer to a server on the same
+ * loop. The file is dropped from the page cache first so that it has to be
+ * read in on the thread pool.
+ */
+
+#define FILE_NAME "test_file_write_file"
+#define FILE_SIZE (3 * 1024 * 1024 + 123)
+#define FILE_OFFSET 4097
+#define HEADER "header"
+#define TRAILER "trailer"
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_tcp_t conn;
+static uv_tcp_t client;
+static uv_connect_t connect_req;
+static uv_write_t header_req;
+static uv_write_t file_req;
+static uv_write_t trailer_req;
+static uv_shutdown_t shutdown_req;
+static char* data;
+static char* received;
+static size_t file_length;
+static size_t expected;
+static size_t nread_total;
+static int file;
+static int short_file;
+
+static int write_cb_called;
+static int file_cb_called;
+static int eof_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  return uv_buf_init(malloc(suggested_size), suggested_size);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  if (nread < 0) {
+    ASSERT(uv_last_error(loop).code == UV_EOF);
+    eof_cb_called++;
+    free(buf.base);
+    uv_close((uv_handle_t*)&server, close_cb);
+    uv_close((uv_handle_t*)&conn, close_cb);
+    uv_close((uv_handle_t*)&client, close_cb);
+    return;
+  }
+
+  ASSERT(nread_total + nread <= expected);
+  memcpy(received + nread_total, buf.base, nread);
+  nread_total += nread;
+  free(buf.base);
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(loop, &conn));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)&conn));
+  ASSERT(0 == uv_read_start((uv_stream_t*)&conn, alloc_cb, read_cb));
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  write_cb_called++;
+}
+
+
+static void file_cb(uv_write_t* req, int status) {
+  ASSERT(req == &file_req);
+  ASSERT(write_cb_called == 1);
+
+  if (short_file) {
+    ASSERT(status == -1);
+    ASSERT(uv_last_error(loop).code == UV_EINVAL);
+  } else {
+    ASSERT(status == 0);
+  }
+
+  file_cb_called++;
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  uv_stream_t* stream = (uv_stream_t*)&client;
+  uv_buf_t buf;
+
+  ASSERT(status == 0);
+
+  buf = uv_buf_init(HEADER, sizeof(HEADER) - 1);
+  ASSERT(0 == uv_write(&header_req, stream, &buf, 1, write_cb));
+
+  ASSERT(0 == uv_write_file(&file_req,
+                            stream,
+                            file,
+                            FILE_OFFSET,
+                            file_length,
+                            file_cb));
+
+  buf = uv_buf_init(TRAILER, sizeof(TRAILER) - 1);
+  ASSERT(0 == uv_write(&trailer_req, stream, &buf, 1, write_cb));
+
+  ASSERT(0 == uv_shutdown(&shutdown_req, stream, shutdown_cb));
+}
+
+
+static void run_write_file_test(void) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  uint64_t write_bytes;
+  size_t i;
+  ssize_t n;
+
+  loop = uv_default_loop();
+
+  data = malloc(FILE_SIZE);
+  ASSERT(data != NULL);
+  for (i = 0; i < FILE_SIZE; i++)
+    data[i] = (char)(i % 251);
+
+  unlink(FILE_NAME);
+  file = open(FILE_NAME, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  ASSERT(file != -1);
+  n = write(file, data, FILE_SIZE);
+  ASSERT(n == FILE_SIZE);
+  ASSERT(0 == fsync(file));
+#if defined(POSIX_FADV_DONTNEED)
+  ASSERT(0 == posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED));
+#endif
+
+  /* A short file sends what there is and then fails the request. */
+  file_length = FILE_SIZE - FILE_OFFSET;
+  if (short_file)
+    file_length += 1000;
+
+  expected = sizeof(HEADER) - 1 + file_length + sizeof(TRAILER) - 1;
+  received = malloc(expected);
+  ASSERT(received != NULL);
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &client));
+  ASSERT(0 == uv_tcp_connect(&connect_req, &client, addr, connect_cb));
+
+  write_bytes = loop->counters.write_bytes;
+
+  ASSERT(0 == uv_run(loop));
+
+  /* The part that went out with sendfile() is counted too. */
+  ASSERT(loop->counters.write_bytes == write_bytes + nread_total);
+
+  ASSERT(file_cb_called == 1);
+  ASSERT(write_cb_called == 2);
+  ASSERT(eof_cb_called == 1);
+  ASSERT(close_cb_called == 3);
+
+  close(file);
+  unlink(FILE_NAME);
+}
+
+
+TEST_IMPL(tcp_write_file) {
+  run_write_file_test();
+
+  ASSERT(nread_total == expected);
+  ASSERT(0 == memcmp(received, HEADER, sizeof(HEADER) - 1));
+  ASSERT(0 == memcmp(received + sizeof(HEADER) - 1,
+                     data + FILE_OFFSET,
+                     file_length));
+  ASSERT(0 == memcmp(received + expected - (sizeof(TRAILER) - 1),
+                     TRAILER,
+                     sizeof(TRAILER) - 1));
+
+  free(data);
+  free(received);
+
+  return 0;
+}
+
+
+TEST_IMPL(tcp_write_file_short) {
+  short_file = 1;
+  run_write_file_test();
+
+  /* The trailer still goes out after the failed request. */
+  ASSERT(nread_total <= expected - 1000);
+  ASSERT(0 == memcmp(received, HEADER, sizeof(HEADER) - 1));
+  ASSERT(0 == memcmp(received + nread_total - (sizeof(TRAILER) - 1),
+                     TRAILER,
+                     sizeof(TRAILER) - 1));
+
+  free(data);
+  free(received);
+
+  return 0;
+}
@@ -0,0 +1,176 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* A client with zero-copy writes turned on sends large and small writes
+ * to a server on the same loop. The data must arrive intact and the write
+ * callbacks must be made in order.
+ */
+
+#define NUM_WRITES 16
+#define LARGE_SIZE (1024 * 1024)
+#define SMALL_SIZE 100
+
+static uv_loop_t* loop;
+static uv_tcp_t server;
+static uv_tcp_t conn;
+static uv_tcp_t client;
+static uv_connect_t connect_req;
+static uv_write_t write_reqs[NUM_WRITES];
+static uv_shutdown_t shutdown_req;
+static char* data;
+static char* received;
+static size_t total;
+static size_t nread_total;
+
+static int write_cb_called;
+static int eof_cb_called;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  return uv_buf_init(malloc(suggested_size), suggested_size);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  if (nread < 0) {
+    ASSERT(uv_last_error(loop).code == UV_EOF);
+    eof_cb_called++;
+    free(buf.base);
+    uv_close((uv_handle_t*)&server, close_cb);
+    uv_close((uv_handle_t*)&conn, close_cb);
+    return;
+  }
+
+  ASSERT(nread_total + nread <= total);
+  memcpy(received + nread_total, buf.base, nread);
+  nread_total += nread;
+  free(buf.base);
+}
+
+
+static void connection_cb(uv_stream_t* stream, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(loop, &conn));
+  ASSERT(0 == uv_accept(stream, (uv_stream_t*)&conn));
+  ASSERT(0 == uv_read_start((uv_stream_t*)&conn, alloc_cb, read_cb));
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(req == &write_reqs[write_cb_called]);
+  write_cb_called++;
+
+  /* Closing earlier would cancel the writes whose buffers the kernel
+   * hasn't released yet.
+   */
+  if (write_cb_called == NUM_WRITES)
+    uv_close((uv_handle_t*)&client, close_cb);
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t buf;
+  size_t off;
+  size_t len;
+  int i;
+
+  ASSERT(status == 0);
+
+  off = 0;
+  for (i = 0; i < NUM_WRITES; i++) {
+    len = (i % 4 == 3) ? SMALL_SIZE : LARGE_SIZE;
+    buf = uv_buf_init(data + off, len);
+    ASSERT(0 == uv_write(&write_reqs[i],
+                         (uv_stream_t*)&client,
+                         &buf,
+                         1,
+                         write_cb));
+    off += len;
+  }
+
+  ASSERT(off == total);
+  ASSERT(0 == uv_shutdown(&shutdown_req, (uv_stream_t*)&client, shutdown_cb));
+}
+
+
+TEST_IMPL(tcp_zerocopy) {
+  struct sockaddr_in addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  size_t i;
+  int r;
+
+  loop = uv_default_loop();
+
+  total = (NUM_WRITES / 4) * (3 * LARGE_SIZE + SMALL_SIZE);
+  data = malloc(total);
+  received = malloc(total);
+  ASSERT(data != NULL);
+  ASSERT(received != NULL);
+  for (i = 0; i < total; i++)
+    data[i] = (char)(i % 251);
+
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*)&server, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &client));
+
+  /* Turned on before there's a socket, applied when it's created. */
+  r = uv_tcp_zerocopy(&client, 1, 64 * 1024);
+  if (r == -1) {
+    ASSERT(uv_last_error(loop).code == UV_ENOTSUP);
+    free(data);
+    free(received);
+    return 0;
+  }
+
+  ASSERT(0 == uv_tcp_connect(&connect_req, &client, addr, connect_cb));
+
+  ASSERT(0 == uv_run(loop));
+
+  ASSERT(write_cb_called == NUM_WRITES);
+  ASSERT(eof_cb_called == 1);
+  ASSERT(close_cb_called == 3);
+  ASSERT(nread_total == total);
+  ASSERT(0 == memcmp(received, data, total));
+
+  free(data);
+  free(received);
+
+  return 0;
+}
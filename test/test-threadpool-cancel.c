@@ -0,0 +1,162 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#define NUM_REQS 8
+
+static uv_mutex_t blocker_mutex;
+static uv_work_t blocker_req;
+static uv_work_t work_reqs[NUM_REQS];
+static uv_fs_t fs_reqs[NUM_REQS];
+static uv_getaddrinfo_t getaddrinfo_reqs[NUM_REQS];
+
+static int blocker_cb_called;
+static int work_cb_called;
+static int after_work_cb_called;
+static int fs_cb_called;
+static int getaddrinfo_cb_called;
+
+
+/* Occupies the pool's only thread until the test lets go of the mutex. */
+static void blocker_work_cb(uv_work_t* req) {
+  uv_mutex_lock(&blocker_mutex);
+  uv_mutex_unlock(&blocker_mutex);
+}
+
+
+static void blocker_after_work_cb(uv_work_t* req) {
+  int r;
+
+  blocker_cb_called++;
+
+  /* Too late to cancel now. */
+  r = uv_cancel((uv_req_t*) req);
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(req->loop).code == UV_EBUSY);
+}
+
+
+static void work_cb(uv_work_t* req) {
+  work_cb_called++;
+}
+
+
+static void after_work_cb(uv_work_t* req) {
+  ASSERT(uv_last_error(req->loop).code == UV_ECANCELED);
+  after_work_cb_called++;
+}
+
+
+static void fs_cb(uv_fs_t* req) {
+  ASSERT(req->result == -1);
+  ASSERT(req->errorno == UV_ECANCELED);
+  uv_fs_req_cleanup(req);
+  fs_cb_called++;
+}
+
+
+static void getaddrinfo_cb(uv_getaddrinfo_t* req,
+                           int status,
+                           struct addrinfo* res) {
+  ASSERT(status == UV_ECANCELED);
+  ASSERT(res == NULL);
+  getaddrinfo_cb_called++;
+}
+
+
+TEST_IMPL(threadpool_cancel) {
+  uv_shutdown_t shutdown_req;
+  uv_threadpool_t* pool;
+  uv_tcp_t tcp;
+  uv_loop_t* loop;
+  int i;
+  int r;
+
+  pool = uv_threadpool_new(1);
+  ASSERT(pool != NULL);
+
+  loop = uv_loop_new();
+  ASSERT(loop != NULL);
+
+  r = uv_loop_set_threadpool(loop, pool);
+  ASSERT(r == 0);
+
+  r = uv_mutex_init(&blocker_mutex);
+  ASSERT(r == 0);
+  uv_mutex_lock(&blocker_mutex);
+
+  r = uv_queue_work(loop, &blocker_req, blocker_work_cb,
+      blocker_after_work_cb);
+  ASSERT(r == 0);
+
+  for (i = 0; i < NUM_REQS; i++) {
+    r = uv_queue_work(loop, work_reqs + i, work_cb, after_work_cb);
+    ASSERT(r == 0);
+    r = uv_fs_stat(loop, fs_reqs + i, ".", fs_cb);
+    ASSERT(r == 0);
+    r = uv_getaddrinfo(loop, getaddrinfo_reqs + i, getaddrinfo_cb,
+        "localhost", NULL, NULL);
+    ASSERT(r == 0);
+  }
+
+  for (i = 0; i < NUM_REQS; i++) {
+    r = uv_cancel((uv_req_t*) (work_reqs + i));
+    ASSERT(r == 0);
+    r = uv_cancel((uv_req_t*) (fs_reqs + i));
+    ASSERT(r == 0);
+    r = uv_cancel((uv_req_t*) (getaddrinfo_reqs + i));
+    ASSERT(r == 0);
+  }
+
+  /* Already cancelled. */
+  r = uv_cancel((uv_req_t*) work_reqs);
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(loop).code == UV_EBUSY);
+
+  /* Not a thread pool request. */
+  r = uv_tcp_init(loop, &tcp);
+  ASSERT(r == 0);
+  shutdown_req.type = UV_SHUTDOWN;
+  shutdown_req.handle = (uv_stream_t*) &tcp;
+  r = uv_cancel((uv_req_t*) &shutdown_req);
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(loop).code == UV_EINVAL);
+  uv_close((uv_handle_t*) &tcp, NULL);
+
+  uv_mutex_unlock(&blocker_mutex);
+
+  r = uv_run(loop);
+  ASSERT(r == 0);
+
+  ASSERT(blocker_cb_called == 1);
+  ASSERT(work_cb_called == 0);
+  ASSERT(after_work_cb_called == NUM_REQS);
+  ASSERT(fs_cb_called == NUM_REQS);
+  ASSERT(getaddrinfo_cb_called == NUM_REQS);
+
+  uv_loop_delete(loop);
+  uv_threadpool_delete(pool);
+  uv_mutex_destroy(&blocker_mutex);
+
+  return 0;
+}
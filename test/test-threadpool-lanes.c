@@ -0,0 +1,174 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#define NUM_BULK 8
+#define NUM_STALL_REQS 64
+
+static uv_mutex_t blocker_mutex;
+static uv_work_t blocker_req;
+static uv_work_t bulk_reqs[NUM_BULK];
+static uv_work_t interactive_req;
+
+/* Only touched by the pool's single thread until uv_run() returns. */
+static uv_work_t* run_order[NUM_BULK + 2];
+static int run_count;
+static int after_work_cb_called;
+
+
+static void blocker_work_cb(uv_work_t* req) {
+  uv_mutex_lock(&blocker_mutex);
+  uv_mutex_unlock(&blocker_mutex);
+  run_order[run_count++] = req;
+}
+
+
+static void work_cb(uv_work_t* req) {
+  run_order[run_count++] = req;
+}
+
+
+static void after_work_cb(uv_work_t* req) {
+  after_work_cb_called++;
+}
+
+
+TEST_IMPL(threadpool_lanes) {
+  uv_threadpool_t* pool;
+  uv_loop_t* loop;
+  int i;
+  int r;
+
+  pool = uv_threadpool_new2(1, 1);
+  ASSERT(pool != NULL);
+
+  loop = uv_loop_new();
+  ASSERT(loop != NULL);
+
+  r = uv_loop_set_threadpool(loop, pool);
+  ASSERT(r == 0);
+
+  r = uv_mutex_init(&blocker_mutex);
+  ASSERT(r == 0);
+  uv_mutex_lock(&blocker_mutex);
+
+  r = uv_queue_work(loop, &blocker_req, blocker_work_cb, after_work_cb);
+  ASSERT(r == 0);
+
+  uv_loop_set_lane(loop, UV_LANE_BULK);
+  for (i = 0; i < NUM_BULK; i++) {
+    r = uv_queue_work(loop, bulk_reqs + i, work_cb, after_work_cb);
+    ASSERT(r == 0);
+  }
+
+  /* Queued last but must overtake all bulk requests. */
+  uv_loop_set_lane(loop, UV_LANE_INTERACTIVE);
+  r = uv_queue_work(loop, &interactive_req, work_cb, after_work_cb);
+  ASSERT(r == 0);
+
+  uv_mutex_unlock(&blocker_mutex);
+
+  r = uv_run(loop);
+  ASSERT(r == 0);
+
+  ASSERT(after_work_cb_called == NUM_BULK + 2);
+  ASSERT(run_count == NUM_BULK + 2);
+  ASSERT(run_order[0] == &blocker_req);
+  ASSERT(run_order[1] == &interactive_req);
+
+  /* Bulk requests keep their order. */
+  for (i = 0; i < NUM_BULK; i++)
+    ASSERT(run_order[i + 2] == bulk_reqs + i);
+
+  uv_loop_delete(loop);
+  uv_threadpool_delete(pool);
+  uv_mutex_destroy(&blocker_mutex);
+
+  return 0;
+}
+
+
+static uv_work_t stall_reqs[NUM_STALL_REQS];
+static uv_timer_t stall_timer;
+static int stall_after_work_cb_called;
+
+
+static void stall_work_cb(uv_work_t* req) {
+  uv_sleep(1);
+}
+
+
+static void stall_after_work_cb(uv_work_t* req) {
+  if (++stall_after_work_cb_called == NUM_STALL_REQS)
+    uv_close((uv_handle_t*) &stall_timer, NULL);
+}
+
+
+static void stall_timer_cb(uv_timer_t* handle, int status) {
+  /* Bulk requests are stuck waiting for a slot that was freed. */
+  ASSERT(0 && "bulk requests weren't picked up");
+}
+
+
+/*
+ * More bulk requests than bulk slots, spread over all workers and mixed
+ * with interactive ones, and no submits after the first batch to wake
+ * anyone up. Workers whose bulk lane stalls must be woken up when a slot
+ * frees up.
+ */
+TEST_IMPL(threadpool_lanes_stall) {
+  uv_threadpool_t* pool;
+  uv_loop_t* loop;
+  int i;
+  int r;
+
+  pool = uv_threadpool_new2(4, 1);
+  ASSERT(pool != NULL);
+
+  loop = uv_loop_new();
+  ASSERT(loop != NULL);
+
+  r = uv_loop_set_threadpool(loop, pool);
+  ASSERT(r == 0);
+
+  for (i = 0; i < NUM_STALL_REQS; i++) {
+    uv_loop_set_lane(loop, i % 3 ? UV_LANE_BULK : UV_LANE_INTERACTIVE);
+    r = uv_queue_work(loop, stall_reqs + i, stall_work_cb,
+        stall_after_work_cb);
+    ASSERT(r == 0);
+  }
+
+  r = uv_timer_init(loop, &stall_timer);
+  ASSERT(r == 0);
+  r = uv_timer_start(&stall_timer, stall_timer_cb, 3000, 0);
+  ASSERT(r == 0);
+
+  r = uv_run(loop);
+  ASSERT(r == 0);
+  ASSERT(stall_after_work_cb_called == NUM_STALL_REQS);
+
+  uv_loop_delete(loop);
+  uv_threadpool_delete(pool);
+
+  return 0;
+}
@@ -55,3 +55,70 @@ TEST_IMPL(threadpool_queue_work_simple) {
 
   return 0;
 }
+
+
+static uv_loop_t* pool_loops[2];
+static uv_work_t pool_reqs[2][8];
+static int pool_after_work_cb_count[2];
+
+
+static void pool_work_cb(uv_work_t* req) {
+}
+
+
+static void pool_after_work_cb(uv_work_t* req) {
+  int n = (int)(long) req->data;
+
+  /* Completions are delivered to the loop that queued the work. */
+  ASSERT(req->loop == pool_loops[n]);
+  pool_after_work_cb_count[n]++;
+}
+
+
+TEST_IMPL(threadpool_per_loop) {
+  uv_threadpool_t* pool;
+  uv_threadpool_t* shared;
+  int i;
+  int n;
+  int r;
+
+  pool = uv_threadpool_new(1);
+  ASSERT(pool != NULL);
+
+  pool_loops[0] = uv_loop_new();
+  ASSERT(pool_loops[0] != NULL);
+  r = uv_loop_set_threadpool(pool_loops[0], pool);
+  ASSERT(r == 0);
+
+  /* The second loop picks up the default pool on its first request. */
+  pool_loops[1] = uv_loop_new();
+  ASSERT(pool_loops[1] != NULL);
+
+  for (n = 0; n < 2; n++) {
+    for (i = 0; i < 8; i++) {
+      pool_reqs[n][i].data = (void*)(long) n;
+      r = uv_queue_work(pool_loops[n],
+                        &pool_reqs[n][i],
+                        pool_work_cb,
+                        pool_after_work_cb);
+      ASSERT(r == 0);
+    }
+  }
+
+  shared = uv_threadpool_new(2);
+  ASSERT(shared != NULL);
+  r = uv_loop_set_threadpool(pool_loops[1], shared);
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(pool_loops[1]).code == UV_EBUSY);
+  uv_threadpool_delete(shared);
+
+  for (n = 0; n < 2; n++) {
+    uv_run(pool_loops[n]);
+    ASSERT(pool_after_work_cb_count[n] == 8);
+    uv_loop_delete(pool_loops[n]);
+  }
+
+  uv_threadpool_delete(pool);
+
+  return 0;
+}
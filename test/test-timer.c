@@ -130,3 +130,109 @@ TEST_IMPL(timer) {
 
   return 0;
 }
+
+
+#define ARRAY_SIZE(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+static uv_loop_t* wheel_loop;
+static int64_t wheel_start_time;
+static int64_t wheel_last_timeout;
+static int wheel_once_cb_called;
+static int wheel_repeat_cb_called;
+static int wheel_close_cb_called;
+
+
+static void wheel_close_cb(uv_handle_t* handle) {
+  ASSERT(handle != NULL);
+  wheel_close_cb_called++;
+  free(handle);
+}
+
+
+static void wheel_once_cb(uv_timer_t* handle, int status) {
+  int64_t timeout = *(int64_t*)handle->data;
+
+  ASSERT(status == 0);
+  ASSERT(!uv_is_active((uv_handle_t*)handle));
+
+  /* Timers fire in order and never early. */
+  ASSERT(timeout >= wheel_last_timeout);
+  ASSERT(uv_now(wheel_loop) - wheel_start_time >= timeout);
+  wheel_last_timeout = timeout;
+
+  wheel_once_cb_called++;
+  uv_close((uv_handle_t*)handle, wheel_close_cb);
+}
+
+
+static void wheel_repeat_cb(uv_timer_t* handle, int status) {
+  ASSERT(status == 0);
+  ASSERT(uv_is_active((uv_handle_t*)handle));
+  ASSERT(uv_timer_get_repeat(handle) == 100);
+
+  wheel_repeat_cb_called++;
+  ASSERT(uv_now(wheel_loop) - wheel_start_time >= 100 * wheel_repeat_cb_called);
+
+  if (wheel_repeat_cb_called == 5)
+    uv_close((uv_handle_t*)handle, wheel_close_cb);
+}
+
+
+TEST_IMPL(timer_wheel) {
+  /* Spans several first-level buckets and a cascade from the next level. */
+  static int64_t timeouts[] = { 0, 1, 10, 50, 255, 256, 257, 300, 600 };
+  uv_timer_t* timer;
+  uv_timer_t never;
+  int i, r;
+
+  wheel_loop = uv_loop_new2(UV_LOOP_TIMER_WHEEL);
+  ASSERT(wheel_loop != NULL);
+
+  wheel_start_time = uv_now(wheel_loop);
+
+  /* Start them in reverse to make sure they don't fire in start order. */
+  for (i = ARRAY_SIZE(timeouts) - 1; i >= 0; i--) {
+    timer = malloc(sizeof(*timer));
+    ASSERT(timer != NULL);
+    r = uv_timer_init(wheel_loop, timer);
+    ASSERT(r == 0);
+    timer->data = &timeouts[i];
+    r = uv_timer_start(timer, wheel_once_cb, timeouts[i], 0);
+    ASSERT(r == 0);
+    ASSERT(uv_is_active((uv_handle_t*)timer));
+
+    /* Can't start an active timer. */
+    r = uv_timer_start(timer, wheel_once_cb, timeouts[i], 0);
+    ASSERT(r == -1);
+  }
+
+  timer = malloc(sizeof(*timer));
+  ASSERT(timer != NULL);
+  r = uv_timer_init(wheel_loop, timer);
+  ASSERT(r == 0);
+  r = uv_timer_start(timer, wheel_repeat_cb, 100, 100);
+  ASSERT(r == 0);
+
+  r = uv_timer_init(wheel_loop, &never);
+  ASSERT(r == 0);
+  r = uv_timer_start(&never, never_cb, 100, 100);
+  ASSERT(r == 0);
+  r = uv_timer_stop(&never);
+  ASSERT(r == 0);
+  ASSERT(!uv_is_active((uv_handle_t*)&never));
+  r = uv_timer_again(&never);
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(wheel_loop).code == UV_EINVAL);
+  uv_unref(wheel_loop);
+
+  uv_run(wheel_loop);
+
+  ASSERT(wheel_once_cb_called == ARRAY_SIZE(timeouts));
+  ASSERT(wheel_repeat_cb_called == 5);
+  ASSERT(wheel_close_cb_called == ARRAY_SIZE(timeouts) + 1);
+  ASSERT(600 <= uv_now(wheel_loop) - wheel_start_time);
+
+  uv_loop_delete(wheel_loop);
+
+  return 0;
+}
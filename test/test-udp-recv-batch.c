@@ -0,0 +1,151 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_DGRAMS  16
+#define BATCH_SIZE  4
+
+static uv_udp_t server;
+static uv_udp_t client;
+static uv_udp_send_t send_reqs[NUM_DGRAMS];
+static unsigned int send_data[NUM_DGRAMS];
+
+static int alloc_cb_called;
+static int free_called;
+static int recv_cb_called;
+static int send_cb_called;
+static int close_cb_called;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  uv_buf_t buf;
+
+  ASSERT(handle == (uv_handle_t*)&server);
+  ASSERT(suggested_size >= 65536);
+
+  buf.base = malloc(suggested_size);
+  buf.len = suggested_size;
+  ASSERT(buf.base != NULL);
+
+  alloc_cb_called++;
+
+  return buf;
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  ASSERT(handle == (uv_handle_t*)&server || handle == (uv_handle_t*)&client);
+  close_cb_called++;
+}
+
+
+static void recv_cb(uv_udp_t* handle,
+                    ssize_t nread,
+                    uv_buf_t buf,
+                    struct sockaddr* addr,
+                    unsigned flags) {
+  ASSERT(handle == &server);
+  ASSERT(nread >= 0);
+
+  if (nread == 0) {
+    /* Buffer is handed back, either unused or at the end of a batch. */
+    ASSERT(addr == NULL);
+    ASSERT(flags == 0);
+    free(buf.base);
+    free_called++;
+    return;
+  }
+
+  ASSERT(addr != NULL);
+  ASSERT(nread == sizeof(unsigned int));
+  ASSERT(!(flags & UV_UDP_PARTIAL));
+
+  /* Datagrams on the loopback interface arrive in order. */
+  ASSERT(*(unsigned int*)buf.base == send_data[recv_cb_called]);
+  recv_cb_called++;
+
+  /* Chunks point into the batch buffer, which is released later on. */
+  if (!(flags & UV_UDP_MMSG_CHUNK)) {
+    free(buf.base);
+    free_called++;
+  }
+
+  if (recv_cb_called == NUM_DGRAMS) {
+    uv_close((uv_handle_t*)&server, close_cb);
+    uv_close((uv_handle_t*)&client, close_cb);
+  }
+}
+
+
+static void send_cb(uv_udp_send_t* req, int status) {
+  ASSERT(status == 0);
+  send_cb_called++;
+}
+
+
+TEST_IMPL(udp_recv_batch) {
+  struct sockaddr_in addr;
+  uv_buf_t buf;
+  int i, r;
+
+  r = uv_udp_init(uv_default_loop(), &server);
+  ASSERT(r == 0);
+
+  addr = uv_ip4_addr("0.0.0.0", TEST_PORT);
+  r = uv_udp_bind(&server, addr, 0);
+  ASSERT(r == 0);
+
+  r = uv_udp_recv_start_batch(&server, alloc_cb, recv_cb, 0);
+  ASSERT(r == -1);
+  ASSERT(uv_last_error(uv_default_loop()).code == UV_EINVAL);
+
+  r = uv_udp_recv_start_batch(&server, alloc_cb, recv_cb, BATCH_SIZE);
+  ASSERT(r == 0);
+
+  r = uv_udp_init(uv_default_loop(), &client);
+  ASSERT(r == 0);
+
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+
+  for (i = 0; i < NUM_DGRAMS; i++) {
+    send_data[i] = 0xC0DE0000 + i;
+    buf = uv_buf_init((char*)&send_data[i], sizeof send_data[i]);
+    r = uv_udp_send(&send_reqs[i], &client, &buf, 1, addr, send_cb);
+    ASSERT(r == 0);
+  }
+
+  uv_run(uv_default_loop());
+
+  ASSERT(send_cb_called == NUM_DGRAMS);
+  ASSERT(recv_cb_called == NUM_DGRAMS);
+  ASSERT(close_cb_called == 2);
+
+  /* Every buffer that was allocated has been freed exactly once. */
+  ASSERT(alloc_cb_called == free_called);
+
+  return 0;
+}
@@ -0,0 +1,100 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+static uv_udp_t server;
+static uv_udp_t client;
+
+static int sv_recv_cb_called;
+static int close_cb_called;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  static char slab[65536];
+
+  ASSERT((uv_udp_t*)handle == &server);
+  ASSERT(suggested_size <= sizeof slab);
+
+  return uv_buf_init(slab, sizeof slab);
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void sv_recv_cb(uv_udp_t* handle,
+                       ssize_t nread,
+                       uv_buf_t buf,
+                       struct sockaddr* addr,
+                       unsigned flags) {
+  ASSERT(handle == &server);
+  ASSERT(flags == 0);
+  ASSERT(nread >= 0);
+
+  if (nread == 0) {
+    /* Returning unused buffer */
+    ASSERT(addr == NULL);
+    return;
+  }
+
+  ASSERT(addr != NULL);
+  ASSERT(nread == 4);
+  ASSERT(memcmp("PING", buf.base, nread) == 0);
+  sv_recv_cb_called++;
+
+  uv_close((uv_handle_t*)&server, close_cb);
+  uv_close((uv_handle_t*)&client, close_cb);
+}
+
+
+TEST_IMPL(udp_try_send) {
+  struct sockaddr_in addr;
+  uv_buf_t buf;
+  int r;
+
+  addr = uv_ip4_addr("0.0.0.0", TEST_PORT);
+
+  ASSERT(0 == uv_udp_init(uv_default_loop(), &server));
+  ASSERT(0 == uv_udp_bind(&server, addr, 0));
+  ASSERT(0 == uv_udp_recv_start(&server, alloc_cb, sv_recv_cb));
+
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+
+  ASSERT(0 == uv_udp_init(uv_default_loop(), &client));
+
+  /* The client socket is bound on first use. */
+  buf = uv_buf_init("PING", 4);
+  r = uv_udp_try_send(&client, &buf, 1, addr);
+  ASSERT(r == 4);
+
+  ASSERT(0 == uv_run(uv_default_loop()));
+
+  ASSERT(sv_recv_cb_called == 1);
+  ASSERT(close_cb_called == 2);
+
+  return 0;
+}
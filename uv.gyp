@@ -176,6 +176,7 @@
             'include/uv-private/ngx-queue.h',
             'include/uv-private/uv-unix.h',
             'src/unix/core.c',
+            'src/unix/channel.c',
             'src/unix/uv-eio.c',
             'src/unix/uv-eio.h',
             'src/unix/fs.c',
@@ -184,6 +185,10 @@
             'src/unix/pipe.c',
             'src/unix/tty.c',
             'src/unix/stream.c',
+            'src/unix/splice.c',
+            'src/unix/timer-wheel.c',
+            'src/unix/metrics.c',
+            'src/unix/threadpool.c',
             'src/unix/cares.c',
             'src/unix/dl.c',
             'src/unix/error.c',
@@ -279,6 +284,9 @@
         'test/task.h',
         'test/test-util.c',
         'test/test-async.c',
+        'test/test-loop-metrics.c',
+        'test/test-async-pending.c',
+        'test/test-channel.c',
         'test/test-error.c',
         'test/test-callback-stack.c',
         'test/test-connection-fail.c',
@@ -287,6 +295,7 @@
         'test/test-eio-overflow.c',
         'test/test-fail-always.c',
         'test/test-fs.c',
+        'test/test-fs-io-uring.c',
         'test/test-fs-event.c',
         'test/test-get-currentexe.c',
         'test/test-get-memory.c',
@@ -298,6 +307,8 @@
         'test/test-ipc.c',
         'test/test-list.h',
         'test/test-loop-handles.c',
+        'test/test-loop-epoll.c',
+        'test/test-loop-io-uring.c',
         'test/test-multiple-listen.c',
         'test/test-pass-always.c',
         'test/test-ping-pong.c',
@@ -305,6 +316,7 @@
         'test/test-pipe-connect-error.c',
         'test/test-platform-output.c',
         'test/test-process-title.c',
+        'test/test-read-pool.c',
         'test/test-ref.c',
         'test/test-shutdown-eof.c',
         'test/test-spawn.c',
@@ -312,13 +324,25 @@
         'test/test-tcp-bind-error.c',
         'test/test-tcp-bind6-error.c',
         'test/test-tcp-close.c',
+        'test/test-tcp-splice.c',
         'test/test-tcp-flags.c',
         'test/test-tcp-connect-error.c',
         'test/test-tcp-connect6-error.c',
         'test/test-tcp-write-error.c',
         'test/test-tcp-write-to-half-open-connection.c',
         'test/test-tcp-writealot.c',
+        'test/test-tcp-write-coalesce.c',
+        'test/test-tcp-write-file.c',
+        'test/test-tcp-zerocopy.c',
+        'test/test-tcp-watermarks.c',
+        'test/test-tcp-try-write.c',
+        'test/test-tcp-accept-batch.c',
+        'test/test-tcp-accept-emfile.c',
+        'test/test-tcp-accept-options.c',
+        'test/test-tcp-reuseport.c',
         'test/test-threadpool.c',
+        'test/test-threadpool-cancel.c',
+        'test/test-threadpool-lanes.c',
         'test/test-mutexes.c',
         'test/test-thread.c',
         'test/test-timer-again.c',
@@ -327,8 +351,11 @@
         'test/test-udp-dgram-too-big.c',
         'test/test-udp-ipv6.c',
         'test/test-udp-send-and-recv.c',
+        'test/test-udp-try-send.c',
+        'test/test-udp-recv-batch.c',
         'test/test-udp-multicast-join.c',
         'test/test-counters-init.c',
+        'test/test-counters-io.c',
       ],
       'conditions': [
         [ 'OS=="win"', {
@@ -366,13 +393,21 @@
         'test/benchmark-ares.c',
         'test/benchmark-getaddrinfo.c',
         'test/benchmark-list.h',
+        'test/benchmark-million-timers.c',
         'test/benchmark-ping-pongs.c',
         'test/benchmark-pound.c',
+        'test/benchmark-pound-shards.c',
         'test/benchmark-pump.c',
+        'test/benchmark-read-rss.c',
         'test/benchmark-sizes.c',
         'test/benchmark-spawn.c',
         'test/benchmark-thread.c',
+        'test/benchmark-channel.c',
+        'test/benchmark-async-pending.c',
+        'test/benchmark-threadpool.c',
+        'test/benchmark-tcp-accept.c',
         'test/benchmark-tcp-write-batch.c',
+        'test/benchmark-tcp-write-zerocopy.c',
         'test/benchmark-udp-packet-storm.c',
         'test/dns-server.c',
         'test/echo-server.c',